@@ -100,6 +100,8 @@ SOURCES += \
     compiler/runner.cpp \
     customfileiconprovider.cpp \
     gdbmiresultparser.cpp \
+    compiler/compilecache.cpp \
+    compiler/compilerprobecache.cpp \
     compiler/compiler.cpp \
     compiler/compilermanager.cpp \
     compiler/executablerunner.cpp \
@@ -160,6 +162,7 @@ SOURCES += \
     debugger.cpp \
     editor.cpp \
     editorlist.cpp \
+    filesearcher.cpp \
     iconsmanager.cpp \
     main.cpp \
     mainwindow.cpp \
@@ -218,6 +221,8 @@ HEADERS += \
     caretlist.h \
     codesnippetsmanager.h \
     colorscheme.h \
+    compiler/compilecache.h \
+    compiler/compilerprobecache.h \
     compiler/compiler.h \
     compiler/compilerinfo.h \
     compiler/compilermanager.h \
@@ -284,6 +289,7 @@ HEADERS += \
     debugger.h \
     editor.h \
     editorlist.h \
+    filesearcher.h \
     iconsmanager.h \
     mainwindow.h \
     settingsdialog/compilersetdirectorieswidget.h \
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "compilecache.h"
+#include "utils.h"
+#include "../systemconsts.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QSaveFile>
+#include <algorithm>
+
+#define PREPROCESS_TIMEOUT 60000
+
+static bool copyCacheFile(const QString& source, const QString& target)
+{
+    QFile in(source);
+    if (!in.open(QFile::ReadOnly))
+        return false;
+    // write to a temporary file and rename it, so other compiles never see a half written file
+    QSaveFile out(target);
+    if (!out.open(QFile::WriteOnly))
+        return false;
+    while (!in.atEnd()) {
+        QByteArray buffer = in.read(1024*1024);
+        if (buffer.isEmpty() || out.write(buffer)!=buffer.length()) {
+            out.cancelWriting();
+            return false;
+        }
+    }
+    if (!out.commit())
+        return false;
+    // keep the executable bit of executables
+    QFile::setPermissions(target, in.permissions());
+    return true;
+}
+
+CompileCache::CompileCache(const QString &cacheDir, qint64 maxSize):
+    mCacheDir(cacheDir),
+    mMaxSize(maxSize)
+{
+
+}
+
+bool CompileCache::preprocess(const QString &compiler, const QString &arguments,
+                              const QString &workingDir, QByteArray &output)
+{
+    QProcess process;
+    process.setProgram(compiler);
+    QString cmdDir = extractFileDir(compiler);
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    if (!cmdDir.isEmpty()) {
+        QString path = env.value("PATH");
+        if (path.isEmpty()) {
+            path = cmdDir;
+        } else {
+            path = cmdDir + PATH_SEPARATOR + path;
+        }
+        env.insert("PATH",path);
+    }
+    env.insert("CFLAGS","");
+    env.insert("CXXFLAGS","");
+    process.setProcessEnvironment(env);
+    process.setArguments(splitProcessCommand(arguments));
+    process.setWorkingDirectory(workingDir);
+    // errors will be reported by the real compile
+    process.setStandardErrorFile(QProcess::nullDevice());
+    process.start();
+    if (!process.waitForStarted(5000))
+        return false;
+    process.closeWriteChannel();
+    if (!process.waitForFinished(PREPROCESS_TIMEOUT)) {
+        process.kill();
+        process.waitForFinished(1000);
+        return false;
+    }
+    if (process.exitStatus()!=QProcess::NormalExit || process.exitCode()!=0)
+        return false;
+    output = process.readAllStandardOutput();
+    return true;
+}
+
+QString CompileCache::compilerIdentity(const QString &compiler, const QString &version)
+{
+    // the same path may be a different compiler after an upgrade
+    QFileInfo info(compiler);
+    return QString("%1|%2|%3|%4")
+            .arg(info.absoluteFilePath(),version)
+            .arg(info.size())
+            .arg(info.lastModified().toMSecsSinceEpoch());
+}
+
+QByteArray CompileCache::makeKey(const QByteArray &preprocessed, const QString &compilerIdentity, const QString &arguments)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(compilerIdentity.toUtf8());
+    hash.addData("\n",1);
+    hash.addData(arguments.toUtf8());
+    hash.addData("\n",1);
+    hash.addData(preprocessed);
+    return hash.result().toHex();
+}
+
+bool CompileCache::fetch(const QByteArray &key, const QString &suffix, const QString &target)
+{
+    QString path = entryPath(key, suffix);
+    if (!fileExists(path))
+        return false;
+    if (!copyCacheFile(path,target))
+        return false;
+    // mark the entry as recently used
+    QFile entry(path);
+    if (entry.open(QFile::ReadWrite))
+        entry.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    return true;
+}
+
+bool CompileCache::store(const QByteArray &key, const QString &suffix, const QString &source)
+{
+    QString path = entryPath(key, suffix);
+    if (!QDir().mkpath(extractFileDir(path)))
+        return false;
+    return copyCacheFile(source, path);
+}
+
+bool CompileCache::fetchData(const QByteArray &key, const QString &suffix, QByteArray &data)
+{
+    QFile entry(entryPath(key, suffix));
+    if (!entry.open(QFile::ReadWrite))
+        return false;
+    data = entry.readAll();
+    // mark the entry as recently used
+    entry.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    return true;
+}
+
+bool CompileCache::storeData(const QByteArray &key, const QString &suffix, const QByteArray &data)
+{
+    QString path = entryPath(key, suffix);
+    if (!QDir().mkpath(extractFileDir(path)))
+        return false;
+    QSaveFile out(path);
+    if (!out.open(QFile::WriteOnly))
+        return false;
+    if (out.write(data)!=data.length()) {
+        out.cancelWriting();
+        return false;
+    }
+    return out.commit();
+}
+
+void CompileCache::trim()
+{
+    QList<QFileInfo> entries;
+    qint64 totalSize = 0;
+    QDirIterator iter(mCacheDir, QDir::Files, QDirIterator::Subdirectories);
+    while (iter.hasNext()) {
+        iter.next();
+        QFileInfo info = iter.fileInfo();
+        totalSize += info.size();
+        entries.append(info);
+    }
+    if (totalSize <= mMaxSize)
+        return;
+    std::sort(entries.begin(),entries.end(),[](const QFileInfo& a, const QFileInfo& b){
+        return a.lastModified() < b.lastModified();
+    });
+    // leave some room, so we don't have to trim after each compile
+    qint64 limit = mMaxSize / 10 * 9;
+    foreach (const QFileInfo& info, entries) {
+        if (totalSize <= limit)
+            break;
+        if (QFile::remove(info.absoluteFilePath()))
+            totalSize -= info.size();
+    }
+}
+
+bool CompileCache::contains(const QByteArray &key, const QString &suffix) const
+{
+    return fileExists(entryPath(key, suffix));
+}
+
+QString CompileCache::entryPath(const QByteArray &key, const QString &suffix) const
+{
+    return QString("%1%2/%3.%4")
+            .arg(includeTrailingPathDelimiter(mCacheDir),
+                 QString::fromLatin1(key.left(2)),
+                 QString::fromLatin1(key.mid(2)),
+                 suffix);
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef COMPILECACHE_H
+#define COMPILECACHE_H
+
+#include <QByteArray>
+#include <QString>
+
+/*
+ * A content addressed cache of compiler outputs.
+ *
+ * The key of an entry is the hash of the preprocessed source, the identity of
+ * the compiler and the full command line, so a hit is only possible when the
+ * compiler would see exactly the same input. Entries are plain files in the
+ * cache dir; the oldest used ones are removed when the cache grows too big.
+ *
+ * fetch() and store() only touch the files of the given key, so they can be
+ * called from several threads at the same time.
+ */
+class CompileCache
+{
+public:
+    explicit CompileCache(const QString& cacheDir, qint64 maxSize);
+
+    static bool preprocess(const QString& compiler, const QString& arguments,
+                           const QString& workingDir, QByteArray& output);
+    static QString compilerIdentity(const QString& compiler, const QString& version);
+    static QByteArray makeKey(const QByteArray& preprocessed,
+                              const QString& compilerIdentity,
+                              const QString& arguments);
+
+    // copy the cached file to target, returns false if it's not in the cache
+    bool fetch(const QByteArray& key, const QString& suffix, const QString& target);
+    bool store(const QByteArray& key, const QString& suffix, const QString& source);
+    bool fetchData(const QByteArray& key, const QString& suffix, QByteArray& data);
+    bool storeData(const QByteArray& key, const QString& suffix, const QByteArray& data);
+    // remove the least recently used entries until the cache fits in maxSize
+    void trim();
+    bool contains(const QByteArray& key, const QString& suffix) const;
+private:
+    QString entryPath(const QByteArray& key, const QString& suffix) const;
+private:
+    QString mCacheDir;
+    qint64 mMaxSize;
+};
+
+#endif // COMPILECACHE_H
@@ -15,12 +15,16 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 #include "compiler.h"
+#include "compilecache.h"
 #include "utils.h"
 #include "compilermanager.h"
 #include "../systemconsts.h"
 
 #include <cmath>
 #include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QProcess>
 #include <QString>
 #include <QTextCodec>
@@ -34,14 +38,20 @@
 #include "qt_utils/charsetinfo.h"
 #include "../project.h"
 
-#define COMPILE_PROCESS_END "---//END//----"
+// at most one batch of issues is sent to the gui in this interval (ms)
+#define COMPILE_ISSUES_FLUSH_INTERVAL 100
+#define MAX_JSON_DIAGNOSTICS_SIZE (64*1024*1024)
 
 Compiler::Compiler(const QString &filename, bool onlyCheckSyntax):
     QThread(),
     mOnlyCheckSyntax(onlyCheckSyntax),
     mFilename(filename),
     mRebuild(false),
-    mParserForFile()
+    mParserForFile(),
+    mCacheHits(0),
+    mCacheMisses(0),
+    mRecordDiagnostics(false),
+    mJsonDiagnostics(false)
 {
     getParserForFile(filename);
 }
@@ -50,6 +60,7 @@ void Compiler::run()
 {
     emit compileStarted();
     auto action = finally([this]{
+        flushIssues(true);
         emit compileFinished(mFilename);
     });
     try {
@@ -63,7 +74,15 @@ void Compiler::run()
         mWarningCount = 0;
         QElapsedTimer timer;
         timer.start();
-        runCommand(mCompiler, mArguments, mDirectory, pipedText());
+        mCacheHits = 0;
+        mCacheMisses = 0;
+        bool restored = restoreFromCompileCache();
+        if (!restored) {
+            mDiagnostics.clear();
+            mRecordDiagnostics = true;
+            runCommand(mCompiler, mArguments, mDirectory, pipedText());
+            mRecordDiagnostics = false;
+        }
         for(int i=0;i<mExtraArgumentsList.count();i++) {
             if (!beforeRunExtraCommand(i))
                 break;
@@ -74,11 +93,15 @@ void Compiler::run()
             }
             runCommand(mExtraCompilersList[i],mExtraArgumentsList[i],mDirectory, pipedText(),mExtraOutputFilesList[i]);
         }
+        if (!restored)
+            saveToCompileCache();
         log("");
         log(tr("Compile Result:"));
         log("------------------");
         log(tr("- Errors: %1").arg(mErrorCount));
         log(tr("- Warnings: %1").arg(mWarningCount));
+        if (mCacheHits + mCacheMisses > 0)
+            log(tr("- Compile Cache: %1 hits, %2 misses").arg(mCacheHits).arg(mCacheMisses));
         if (!mOutputFile.isEmpty()) {
             log(tr("- Output Filename: %1").arg(mOutputFile));
             QLocale locale = QLocale::system();
@@ -221,15 +244,43 @@ bool Compiler::beforeRunExtraCommand(int idx)
     return true;
 }
 
+bool Compiler::restoreFromCompileCache()
+{
+    return false;
+}
+
+void Compiler::saveToCompileCache()
+{
+
+}
+
+std::shared_ptr<CompileCache> Compiler::createCompileCache()
+{
+    if (!pSettings->environment().enableCompileCache())
+        return std::shared_ptr<CompileCache>();
+    return std::make_shared<CompileCache>(
+                pSettings->dirs().config(Settings::Dirs::DataType::CompileCache),
+                (qint64)pSettings->environment().compileCacheMaxSize()*1024*1024);
+}
+
 void Compiler::processOutput(QString &line)
 {
     if (line == COMPILE_PROCESS_END) {
+        if (!mJsonBuffer.isEmpty()) {
+            // not a complete json document, show it as is
+            QString text = mJsonBuffer;
+            mJsonBuffer.clear();
+            processTextDiagnostics(text);
+        }
         if (mLastIssue) {
-            emit compileIssue(mLastIssue);
+            addIssue(mLastIssue);
             mLastIssue.reset();
         }
+        flushIssues(true);
         return;
     }
+    if (processJsonDiagnostics(line))
+        return;
     if (line.startsWith(">>>"))
         line.remove(0,3);
     QString referencePrefix = QString(" referenced by ");
@@ -238,7 +289,7 @@ void Compiler::processOutput(QString &line)
             mLastIssue->filename = getFileNameFromOutputLine(line);
             //qDebug()<<line;
             mLastIssue->line = getLineNumberFromOutputLine(line);
-            emit compileIssue(mLastIssue);
+            addIssue(mLastIssue);
             mLastIssue.reset();
             return;
     }
@@ -255,7 +306,7 @@ void Compiler::processOutput(QString &line)
             issue->column = getColunmnFromOutputLine(line);
         issue->type = getIssueTypeFromOutputLine(line);
         issue->description = inFilePrefix + issue->filename;
-        emit compileIssue(issue);
+        addIssue(issue);
         return;
     } else if(line.startsWith(fromPrefix)) {
         line.remove(0,fromPrefix.length());
@@ -265,7 +316,7 @@ void Compiler::processOutput(QString &line)
             issue->column = getColunmnFromOutputLine(line);
         issue->type = getIssueTypeFromOutputLine(line);
         issue->description = "                 from " + issue->filename;
-        emit compileIssue(issue);
+        addIssue(issue);
         return;
     }
 
@@ -290,7 +341,7 @@ void Compiler::processOutput(QString &line)
                     i++;
                 }
                 mLastIssue->endColumn = mLastIssue->column+i-pos;
-                emit compileIssue(mLastIssue);
+                addIssue(mLastIssue);
                 mLastIssue.reset();
             }
         }
@@ -298,7 +349,7 @@ void Compiler::processOutput(QString &line)
     }
 
     if (mLastIssue) {
-        emit compileIssue(mLastIssue);
+        addIssue(mLastIssue);
         mLastIssue.reset();
     }
 
@@ -320,11 +371,141 @@ void Compiler::processOutput(QString &line)
     if (issue->line<=0 && (issue->filename=="ld" || issue->filename=="lld")) {
         mLastIssue = issue;
     } else if (issue->line<=0) {
-        emit compileIssue(issue);
+        addIssue(issue);
     } else
         mLastIssue = issue;
 }
 
+void Compiler::addIssue(PCompileIssue issue)
+{
+    mPendingIssues.append(issue);
+    flushIssues(false);
+}
+
+void Compiler::flushIssues(bool force)
+{
+    if (mPendingIssues.isEmpty())
+        return;
+    if (!force && mIssuesFlushTimer.isValid()
+            && mIssuesFlushTimer.elapsed() < COMPILE_ISSUES_FLUSH_INTERVAL)
+        return;
+    QList<PCompileIssue> issues;
+    issues.swap(mPendingIssues);
+    emit compileIssues(issues);
+    mIssuesFlushTimer.start();
+}
+
+bool Compiler::processJsonDiagnostics(const QString &line)
+{
+    if (!mJsonDiagnostics)
+        return false;
+    if (mJsonBuffer.isEmpty() && !line.startsWith('['))
+        return false;
+    // the document may be split into several reads
+    mJsonBuffer += line;
+    if (!mJsonBuffer.trimmed().endsWith(']')) {
+        if (mJsonBuffer.length() > MAX_JSON_DIAGNOSTICS_SIZE) {
+            QString text = mJsonBuffer;
+            mJsonBuffer.clear();
+            processTextDiagnostics(text);
+        }
+        return true;
+    }
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(mJsonBuffer.toUtf8(), &parseError);
+    if (parseError.error != QJsonParseError::NoError) {
+        // a ']' inside the document, wait for more
+        if (parseError.error == QJsonParseError::UnterminatedArray
+                || parseError.error == QJsonParseError::UnterminatedObject
+                || parseError.error == QJsonParseError::UnterminatedString)
+            return true;
+        // not diagnostics, let the text parser handle it
+        QString text = mJsonBuffer;
+        mJsonBuffer.clear();
+        processTextDiagnostics(text);
+        return true;
+    }
+    mJsonBuffer.clear();
+    QStringList logLines;
+    foreach (const QJsonValue& value, doc.array()) {
+        processJsonDiagnostic(value.toObject(), logLines);
+    }
+    if (!logLines.isEmpty())
+        log(logLines.join('\n'));
+    return true;
+}
+
+void Compiler::processTextDiagnostics(const QString &text)
+{
+    emit compileOutput(text);
+    bool oldJsonDiagnostics = mJsonDiagnostics;
+    mJsonDiagnostics = false;
+    for (QString& s:text.split("\n")) {
+        if (!s.isEmpty())
+            processOutput(s);
+    }
+    mJsonDiagnostics = oldJsonDiagnostics;
+}
+
+void Compiler::processJsonDiagnostic(const QJsonObject &diagnostic, QStringList& logLines)
+{
+    PCompileIssue issue = std::make_shared<CompileIssue>();
+    QString kind = diagnostic["kind"].toString();
+    QString message = diagnostic["message"].toString();
+    QString option = diagnostic["option"].toString();
+    if (!option.isEmpty())
+        message += QString(" [%1]").arg(option);
+    if (kind.contains("error") || kind.startsWith("sorry")) {
+        mErrorCount += 1;
+        issue->type = CompileIssueType::Error;
+        issue->description = tr("[Error] ")+message;
+    } else if (kind.contains("warning") || kind == "anachronism") {
+        mWarningCount += 1;
+        issue->type = CompileIssueType::Warning;
+        issue->description = tr("[Warning] ")+message;
+    } else if (kind == "note") {
+        mWarningCount += 1;
+        issue->type = CompileIssueType::Note;
+        issue->description = tr("[Note] ")+message;
+    } else {
+        issue->type = CompileIssueType::Other;
+        issue->description = message;
+    }
+    issue->line = 0;
+    issue->column = -1;
+    issue->endColumn = -1;
+    QJsonArray locations = diagnostic["locations"].toArray();
+    if (!locations.isEmpty()) {
+        QJsonObject location = locations.first().toObject();
+        QJsonObject caret = location["caret"].toObject();
+        QString filename = caret["file"].toString();
+        if (filename.compare("<stdin>", Qt::CaseInsensitive)==0) {
+            issue->filename = mFilename;
+        } else if (!mDirectory.isEmpty()) {
+            QFileInfo info(filename);
+            issue->filename = info.isRelative()?generateAbsolutePath(mDirectory,filename):cleanPath(filename);
+        } else {
+            issue->filename = filename;
+        }
+        issue->line = caret["line"].toInt();
+        // display-column counts tabs and wide chars like the editor does
+        QString columnKey = caret.contains("display-column")?"display-column":"column";
+        issue->column = caret[columnKey].toInt();
+        if (location.contains("finish")) {
+            issue->endColumn = location["finish"].toObject()[columnKey].toInt() + 1;
+        } else if (issue->column > 0) {
+            issue->endColumn = issue->column + 1;
+        }
+        logLines.append(QString("%1:%2:%3: %4: %5").arg(filename).arg(issue->line).arg(issue->column).arg(kind, message));
+    } else {
+        logLines.append(QString("%1: %2").arg(kind, message));
+    }
+    addIssue(issue);
+    foreach (const QJsonValue& child, diagnostic["children"].toArray()) {
+        processJsonDiagnostic(child.toObject(), logLines);
+    }
+}
+
 void Compiler::stopCompile()
 {
     mStop = true;
@@ -512,6 +693,17 @@ QString Compiler::getCppIncludeArguments()
     return result;
 }
 
+QString Compiler::getDiagnosticsFormatArgument()
+{
+    // gcc 9 and later can report diagnostics as json, which is much cheaper to parse than the text
+    mJsonDiagnostics = (compilerSet()->compilerType()==CompilerType::GCC
+                        || compilerSet()->compilerType()==CompilerType::GCC_UTF8)
+            && compilerSet()->mainVersion()>=9;
+    if (mJsonDiagnostics)
+        return " -fdiagnostics-format=json";
+    return QString();
+}
+
 QString Compiler::getLibraryArguments(FileType fileType)
 {
     QString result;
@@ -739,6 +931,7 @@ void Compiler::runCommand(const QString &cmd, const QString  &arguments, const Q
         if (process.state()!=QProcess::Running) {
             break;
         }
+        flushIssues(false);
         if (mStop) {
             process.terminate();
         }
@@ -815,10 +1008,31 @@ void Compiler::log(const QString &msg)
 
 void Compiler::error(const QString &msg)
 {
-    if (msg != COMPILE_PROCESS_END)
-        emit compileOutput(msg);
+    if (mRecordDiagnostics && msg != COMPILE_PROCESS_END)
+        mDiagnostics += msg;
+    if (!mJsonDiagnostics || msg == COMPILE_PROCESS_END) {
+        if (msg != COMPILE_PROCESS_END)
+            emit compileOutput(msg);
+        for (QString& s:msg.split("\n")) {
+            if (!s.isEmpty())
+                processOutput(s);
+        }
+        return;
+    }
+    // json diagnostics are logged after they are parsed,
+    // other lines (linker, assembler...) are logged as is
+    QStringList textLines;
     for (QString& s:msg.split("\n")) {
-        if (!s.isEmpty())
-            processOutput(s);
+        if (s.isEmpty())
+            continue;
+        if (mJsonBuffer.isEmpty() && !s.startsWith('[')) {
+            textLines.append(s);
+        } else if (!textLines.isEmpty()) {
+            emit compileOutput(textLines.join('\n'));
+            textLines.clear();
+        }
+        processOutput(s);
     }
+    if (!textLines.isEmpty())
+        emit compileOutput(textLines.join('\n'));
 }
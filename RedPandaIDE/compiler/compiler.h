@@ -18,11 +18,16 @@
 #define COMPILER_H
 
 #include <QThread>
+#include <QElapsedTimer>
 #include "settings.h"
 #include "../common.h"
 #include "../parser/cppparser.h"
 
+#define COMPILE_PROCESS_END "---//END//----"
+
 class Project;
+class CompileCache;
+class QJsonObject;
 class Compiler : public QThread
 {
     Q_OBJECT
@@ -50,7 +55,8 @@ signals:
     void compileStarted();
     void compileFinished(QString filename);
     void compileOutput(const QString& msg);
-    void compileIssue(PCompileIssue issue);
+    // issues are delivered in batches, so an error storm won't flood the gui event loop
+    void compileIssues(const QList<PCompileIssue>& issues);
     void compileErrorOccured(const QString& reason);
 public slots:
     void stopCompile();
@@ -58,6 +64,11 @@ public slots:
 protected:
     void run() override;
     void processOutput(QString& line);
+    void addIssue(PCompileIssue issue);
+    void flushIssues(bool force);
+    bool processJsonDiagnostics(const QString& line);
+    void processTextDiagnostics(const QString& text);
+    void processJsonDiagnostic(const QJsonObject& diagnostic, QStringList& logLines);
     void getParserForFile(const QString& filename);
     virtual QString getFileNameFromOutputLine(QString &line);
     virtual int getLineNumberFromOutputLine(QString &line);
@@ -70,6 +81,10 @@ protected:
     virtual QByteArray pipedText();
     virtual bool prepareForRebuild() = 0;
     virtual bool beforeRunExtraCommand(int idx);
+    // returns true if the outputs are restored from the compile cache, and the main command is skipped
+    virtual bool restoreFromCompileCache();
+    virtual void saveToCompileCache();
+    std::shared_ptr<CompileCache> createCompileCache();
     virtual QString getCharsetArgument(const QByteArray& encoding, FileType fileType, bool onlyCheckSyntax);
     virtual QString getCCompileArguments(bool checkSyntax);
     virtual QString getCppCompileArguments(bool checkSyntax);
@@ -77,6 +92,7 @@ protected:
     virtual QString getProjectIncludeArguments();
     virtual QString getCppIncludeArguments();
     virtual QString getLibraryArguments(FileType fileType);
+    QString getDiagnosticsFormatArgument();
     virtual QString parseFileIncludesForAutolink(
             const QString& filename,
             QSet<QString>& parsedFiles);
@@ -104,6 +120,14 @@ protected:
     std::shared_ptr<Project> mProject;
     bool mSetLANG;
     PCppParser mParserForFile;
+    int mCacheHits;
+    int mCacheMisses;
+    bool mRecordDiagnostics;
+    QString mDiagnostics; // error output of the main command, saved with its compile cache entry
+    bool mJsonDiagnostics;
+    QString mJsonBuffer;
+    QList<PCompileIssue> mPendingIssues;
+    QElapsedTimer mIssuesFlushTimer;
 
 private:
     bool mStop;
@@ -105,12 +105,12 @@ void CompilerManager::compile(const QString& filename, const QByteArray& encodin
         mCompiler->setRebuild(rebuild);
         connect(mCompiler, &Compiler::finished, mCompiler, &QObject::deleteLater);
         connect(mCompiler, &Compiler::compileFinished, this, &CompilerManager::onCompileFinished);
-        connect(mCompiler, &Compiler::compileIssue, this, &CompilerManager::onCompileIssue);
+        connect(mCompiler, &Compiler::compileIssues, this, &CompilerManager::onCompileIssues);
         connect(mCompiler, &Compiler::compileStarted, pMainWindow, &MainWindow::onCompileStarted);
         connect(mCompiler, &Compiler::compileStarted, pMainWindow, &MainWindow::clearToolsOutput);
 
         connect(mCompiler, &Compiler::compileOutput, pMainWindow, &MainWindow::logToolsOutput);
-        connect(mCompiler, &Compiler::compileIssue, pMainWindow, &MainWindow::onCompileIssue);
+        connect(mCompiler, &Compiler::compileIssues, pMainWindow, &MainWindow::onCompileIssues);
         connect(mCompiler, &Compiler::compileErrorOccured, pMainWindow, &MainWindow::onCompileErrorOccured);
         mCompiler->start();
     }
@@ -137,12 +137,12 @@ void CompilerManager::compileProject(std::shared_ptr<Project> project, bool rebu
         connect(mCompiler, &Compiler::finished, mCompiler, &QObject::deleteLater);
         connect(mCompiler, &Compiler::compileFinished, this, &CompilerManager::onCompileFinished);
 
-        connect(mCompiler, &Compiler::compileIssue, this, &CompilerManager::onCompileIssue);
+        connect(mCompiler, &Compiler::compileIssues, this, &CompilerManager::onCompileIssues);
         connect(mCompiler, &Compiler::compileStarted, pMainWindow, &MainWindow::onProjectCompileStarted);
         connect(mCompiler, &Compiler::compileStarted, pMainWindow, &MainWindow::clearToolsOutput);
 
         connect(mCompiler, &Compiler::compileOutput, pMainWindow, &MainWindow::logToolsOutput);
-        connect(mCompiler, &Compiler::compileIssue, pMainWindow, &MainWindow::onCompileIssue);
+        connect(mCompiler, &Compiler::compileIssues, pMainWindow, &MainWindow::onCompileIssues);
         connect(mCompiler, &Compiler::compileErrorOccured, pMainWindow, &MainWindow::onCompileErrorOccured);
         mCompiler->start();
     }
@@ -171,12 +171,12 @@ void CompilerManager::cleanProject(std::shared_ptr<Project> project)
         connect(mCompiler, &Compiler::finished, mCompiler, &QObject::deleteLater);
         connect(mCompiler, &Compiler::compileFinished, this, &CompilerManager::onCompileFinished);
 
-        connect(mCompiler, &Compiler::compileIssue, this, &CompilerManager::onCompileIssue);
+        connect(mCompiler, &Compiler::compileIssues, this, &CompilerManager::onCompileIssues);
         connect(mCompiler, &Compiler::compileStarted, pMainWindow, &MainWindow::onProjectCompileStarted);
         connect(mCompiler, &Compiler::compileStarted, pMainWindow, &MainWindow::clearToolsOutput);
 
         connect(mCompiler, &Compiler::compileOutput, pMainWindow, &MainWindow::logToolsOutput);
-        connect(mCompiler, &Compiler::compileIssue, pMainWindow, &MainWindow::onCompileIssue);
+        connect(mCompiler, &Compiler::compileIssues, pMainWindow, &MainWindow::onCompileIssues);
         connect(mCompiler, &Compiler::compileErrorOccured, pMainWindow, &MainWindow::onCompileErrorOccured);
         mCompiler->start();
     }
@@ -222,11 +222,11 @@ void CompilerManager::checkSyntax(const QString &filename, const QByteArray& enc
         mBackgroundSyntaxChecker = new StdinCompiler(filename,encoding, content,true);
         mBackgroundSyntaxChecker->setProject(project);
         connect(mBackgroundSyntaxChecker, &Compiler::finished, mBackgroundSyntaxChecker, &QThread::deleteLater);
-        connect(mBackgroundSyntaxChecker, &Compiler::compileIssue, this, &CompilerManager::onSyntaxCheckIssue);
+        connect(mBackgroundSyntaxChecker, &Compiler::compileIssues, this, &CompilerManager::onSyntaxCheckIssues);
         connect(mBackgroundSyntaxChecker, &Compiler::compileStarted, pMainWindow, &MainWindow::onSyntaxCheckStarted);
         connect(mBackgroundSyntaxChecker, &Compiler::compileFinished, this, &CompilerManager::onSyntaxCheckFinished);
         //connect(mBackgroundSyntaxChecker, &Compiler::compileOutput, pMainWindow, &MainWindow::logToolsOutput);
-        connect(mBackgroundSyntaxChecker, &Compiler::compileIssue, pMainWindow, &MainWindow::onCompileIssue);
+        connect(mBackgroundSyntaxChecker, &Compiler::compileIssues, pMainWindow, &MainWindow::onCompileIssues);
         connect(mBackgroundSyntaxChecker, &Compiler::compileErrorOccured, pMainWindow, &MainWindow::onCompileErrorOccured);
         mBackgroundSyntaxChecker->start();
     }
@@ -392,6 +392,9 @@ void CompilerManager::doRunProblem(const QString &filename, const QString &argum
         execRunner->setExecTimeout(timeLimit);
     if (memoryLimit)
         execRunner->setMemoryLimit(memoryLimit);
+    execRunner->setLimitBySystem(pSettings->executor().caseLimitBySystem());
+    if (pSettings->executor().runCasesInParallel())
+        execRunner->setParallelCount(QThread::idealThreadCount());
     connect(mRunner, &Runner::finished, this ,&CompilerManager::onRunnerTerminated);
     connect(mRunner, &Runner::finished, mRunner ,&Runner::deleteLater);
     connect(mRunner, &Runner::finished, pMainWindow ,&MainWindow::onRunProblemFinished);
@@ -477,11 +480,13 @@ void CompilerManager::onRunnerPausing()
     mTempFileOwner=nullptr;
 }
 
-void CompilerManager::onCompileIssue(PCompileIssue issue)
+void CompilerManager::onCompileIssues(const QList<PCompileIssue>& issues)
 {
-    if (issue->type == CompileIssueType::Error)
-        mCompileErrorCount++;
-    mCompileIssueCount++;
+    foreach (const PCompileIssue& issue, issues) {
+        if (issue->type == CompileIssueType::Error)
+            mCompileErrorCount++;
+    }
+    mCompileIssueCount+=issues.count();
 }
 
 void CompilerManager::onSyntaxCheckFinished(QString filename)
@@ -491,13 +496,15 @@ void CompilerManager::onSyntaxCheckFinished(QString filename)
     pMainWindow->onCompileFinished(filename, true);
 }
 
-void CompilerManager::onSyntaxCheckIssue(PCompileIssue issue)
+void CompilerManager::onSyntaxCheckIssues(const QList<PCompileIssue>& issues)
 {
-    if (issue->type == CompileIssueType::Error)
-        mSyntaxCheckErrorCount++;
-    if (issue->type == CompileIssueType::Error ||
-            issue->type == CompileIssueType::Warning)
-        mSyntaxCheckIssueCount++;
+    foreach (const PCompileIssue& issue, issues) {
+        if (issue->type == CompileIssueType::Error)
+            mSyntaxCheckErrorCount++;
+        if (issue->type == CompileIssueType::Error ||
+                issue->type == CompileIssueType::Warning)
+            mSyntaxCheckIssueCount++;
+    }
 }
 
 ProjectCompiler *CompilerManager::createProjectCompiler(std::shared_ptr<Project> project)
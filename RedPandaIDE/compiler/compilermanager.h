@@ -84,9 +84,9 @@ private slots:
     void onRunnerTerminated();
     void onRunnerPausing();
     void onCompileFinished(QString filename);
-    void onCompileIssue(PCompileIssue issue);
+    void onCompileIssues(const QList<PCompileIssue>& issues);
     void onSyntaxCheckFinished(QString filename);
-    void onSyntaxCheckIssue(PCompileIssue issue);
+    void onSyntaxCheckIssues(const QList<PCompileIssue>& issues);
 private:
     ProjectCompiler* createProjectCompiler(std::shared_ptr<Project> project);
 private:
@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "compilerprobecache.h"
+#include "../settings.h"
+#include "../utils.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+#define PROBE_CACHE_FILE "compilerprobes.json"
+#define PROBE_CACHE_MAX_COUNT 1000
+#define PROBE_CACHE_MAX_SIZE (16*1024*1024)
+
+// created before any thread can use it
+PCompilerProbeCache CompilerProbeCache::instance = std::make_shared<CompilerProbeCache>();
+
+CompilerProbeCache::CompilerProbeCache():
+    mLoaded(false),
+    mModified(false),
+    mOutputsSize(0),
+    mGeneration(0)
+{
+
+}
+
+PCompilerProbeCache CompilerProbeCache::getInstance()
+{
+    return instance;
+}
+
+QByteArray CompilerProbeCache::getOutput(const QString &compiler, const QStringList &arguments,
+                                         bool persistent, const std::function<QByteArray ()> &probe)
+{
+    QString key = makeKey(compiler, arguments);
+    if (key.isEmpty())
+        return probe();
+    int generation;
+    {
+        QMutexLocker locker(&mMutex);
+        if (!mLoaded)
+            load();
+        while (mRunningProbes.contains(key))
+            mProbeFinished.wait(&mMutex);
+        auto it = mOutputs.constFind(key);
+        if (it != mOutputs.constEnd()) {
+            if (persistent || mSessionKeys.contains(key))
+                return it.value();
+            // written by an older version, probe it again and drop it from the file
+            mOutputsSize -= it.value().size();
+            mKeys.removeOne(key);
+            mOutputs.remove(key);
+            mModified = true;
+        }
+        mRunningProbes.insert(key);
+        generation = mGeneration;
+    }
+    QByteArray output = probe();
+    QMutexLocker locker(&mMutex);
+    mRunningProbes.remove(key);
+    // an empty output is most likely a failed run, try it again next time
+    // the cache may be cleared while probing
+    if (!output.isEmpty() && generation == mGeneration) {
+        insert(key, output);
+        if (persistent) {
+            mSessionKeys.remove(key);
+            mModified = true;
+        } else {
+            mSessionKeys.insert(key);
+        }
+    }
+    mProbeFinished.wakeAll();
+    return output;
+}
+
+QString CompilerProbeCache::makeKey(const QString &compiler, const QStringList &arguments) const
+{
+    QFileInfo info(compiler);
+    if (!info.exists())
+        return QString();
+    return QString("%1|%2|%3|%4")
+            .arg(info.absoluteFilePath())
+            .arg(info.size())
+            .arg(info.lastModified().toMSecsSinceEpoch())
+            .arg(arguments.join(' '));
+}
+
+QString CompilerProbeCache::cacheFilename() const
+{
+    if (!pSettings)
+        return QString();
+    return includeTrailingPathDelimiter(pSettings->dirs().config()) + PROBE_CACHE_FILE;
+}
+
+void CompilerProbeCache::load()
+{
+    mLoaded = true;
+    QString filename = cacheFilename();
+    if (filename.isEmpty())
+        return;
+    QMutexLocker locker(&mFileMutex);
+    QFile file(filename);
+    if (!file.open(QFile::ReadOnly))
+        return;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    QJsonObject outputs = doc.object();
+    for (auto it = outputs.constBegin(); it != outputs.constEnd(); ++it) {
+        insert(it.key(), it.value().toString().toLatin1());
+    }
+}
+
+void CompilerProbeCache::insert(const QString &key, const QByteArray &output)
+{
+    auto it = mOutputs.find(key);
+    if (it != mOutputs.end()) {
+        mOutputsSize -= it.value().size();
+        mKeys.removeOne(key);
+        mOutputs.erase(it);
+    }
+    // drop the oldest outputs
+    while (!mKeys.isEmpty()
+           && (mKeys.count() >= PROBE_CACHE_MAX_COUNT
+               || mOutputsSize + output.size() > PROBE_CACHE_MAX_SIZE)) {
+        QString oldKey = mKeys.takeFirst();
+        mOutputsSize -= mOutputs.take(oldKey).size();
+        mSessionKeys.remove(oldKey);
+    }
+    mOutputs.insert(key, output);
+    mKeys.append(key);
+    mOutputsSize += output.size();
+}
+
+void CompilerProbeCache::flush()
+{
+    QHash<QString,QByteArray> outputs;
+    QSet<QString> sessionKeys;
+    {
+        QMutexLocker locker(&mMutex);
+        if (!mModified)
+            return;
+        mModified = false;
+        outputs = mOutputs;
+        sessionKeys = mSessionKeys;
+    }
+    QString filename = cacheFilename();
+    if (filename.isEmpty())
+        return;
+    // serialize outside of the cache lock, probes don't wait for the disk
+    QJsonObject json;
+    // outputs may be in the local encoding, latin1 keeps the bytes as they are
+    for (auto it = outputs.constBegin(); it != outputs.constEnd(); ++it) {
+        if (!sessionKeys.contains(it.key()))
+            json.insert(it.key(), QString::fromLatin1(it.value()));
+    }
+    QMutexLocker locker(&mFileMutex);
+    QSaveFile file(filename);
+    if (file.open(QFile::WriteOnly)) {
+        file.write(QJsonDocument(json).toJson(QJsonDocument::Compact));
+        file.commit();
+    }
+}
+
+void CompilerProbeCache::clear()
+{
+    {
+        QMutexLocker locker(&mMutex);
+        mOutputs.clear();
+        mKeys.clear();
+        mSessionKeys.clear();
+        mOutputsSize = 0;
+        mModified = false;
+        mGeneration++;
+        // don't load the old file again
+        mLoaded = true;
+    }
+    QString filename = cacheFilename();
+    if (filename.isEmpty())
+        return;
+    QMutexLocker locker(&mFileMutex);
+    QFile::remove(filename);
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef COMPILERPROBECACHE_H
+#define COMPILERPROBECACHE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QStringList>
+#include <QWaitCondition>
+#include <functional>
+#include <memory>
+
+class CompilerProbeCache;
+using PCompilerProbeCache = std::shared_ptr<CompilerProbeCache>;
+
+/*
+ * Outputs of the compiler runs used to probe a compiler set (version,
+ * target, default include dirs, predefined macros...).
+ *
+ * The key of an output is the path, size and modification time of the
+ * compiler and the arguments, so an upgraded compiler is probed again.
+ * Outputs are kept in a file in the config dir, so they survive restarts;
+ * new outputs are written by flush(). Outputs that depend on more than the
+ * compiler (search dirs, files in the custom arguments) are not persistent,
+ * they are only kept until the program exits or clear() is called.
+ * It can be used from several threads; a probe already running in another
+ * thread is waited for instead of being run twice.
+ */
+class CompilerProbeCache {
+public:
+    CompilerProbeCache();
+    static PCompilerProbeCache getInstance();
+    // the output of probe(), which is only called if it's not cached
+    QByteArray getOutput(const QString& compiler, const QStringList& arguments,
+                         bool persistent, const std::function<QByteArray()>& probe);
+    // write the new outputs to the cache file
+    void flush();
+    // drop all outputs, so the compilers are probed again
+    void clear();
+private:
+    QString makeKey(const QString& compiler, const QStringList& arguments) const;
+    QString cacheFilename() const;
+    void load();
+    void insert(const QString& key, const QByteArray& output);
+private:
+    static PCompilerProbeCache instance;
+    bool mLoaded;
+    bool mModified;
+    QHash<QString,QByteArray> mOutputs;
+    QList<QString> mKeys; // oldest first
+    QSet<QString> mSessionKeys; // outputs not written to the cache file
+    qint64 mOutputsSize;
+    int mGeneration; // increased by clear()
+    QSet<QString> mRunningProbes;
+    QMutex mMutex;
+    QWaitCondition mProbeFinished;
+    QMutex mFileMutex;
+};
+
+#endif // COMPILERPROBECACHE_H
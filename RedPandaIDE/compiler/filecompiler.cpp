@@ -15,6 +15,7 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 #include "filecompiler.h"
+#include "compilecache.h"
 #include "utils.h"
 #include "compilermanager.h"
 #include "qsynedit/syntaxer/asm.h"
@@ -109,6 +110,7 @@ bool FileCompiler::prepareForCompile()
         }
     }
 
+    int commonArgumentsStart = mArguments.length();
     mArguments += getCharsetArgument(mEncoding, fileType, mOnlyCheckSyntax);
     QString strFileType;
     switch(fileType) {
@@ -136,6 +138,17 @@ bool FileCompiler::prepareForCompile()
     default:
         throw CompileError(tr("Can't find the compiler for file %1").arg(mFilename));
     }
+    mArguments += getDiagnosticsFormatArgument();
+
+    mPreprocessArguments.clear();
+    if (!mOnlyCheckSyntax
+            && fileType != FileType::GAS
+            && (compilerSet()->compilationStage() == Settings::CompilerSet::CompilationStage::GenerateExecutable
+                || compilerSet()->compilationStage() == Settings::CompilerSet::CompilationStage::AssemblingOnly)) {
+        // same options as the compile, but without the output file and the libraries
+        mPreprocessArguments = QString(" \"%1\" -E").arg(mFilename)
+                + mArguments.mid(commonArgumentsStart);
+    }
 
     if (!mOnlyCheckSyntax)
         mArguments += getLibraryArguments(fileType);
@@ -200,3 +213,108 @@ bool FileCompiler::prepareForRebuild()
     }
     return true;
 }
+
+bool FileCompiler::restoreFromCompileCache()
+{
+    mCacheKey.clear();
+    if (mPreprocessArguments.isEmpty())
+        return false;
+    std::shared_ptr<CompileCache> cache = createCompileCache();
+    if (!cache)
+        return false;
+    QByteArray preprocessed;
+    if (!CompileCache::preprocess(mCompiler, mPreprocessArguments, mDirectory, preprocessed))
+        return false;
+    QString identity = CompileCache::compilerIdentity(mCompiler, compilerSet()->version());
+    if (compilerSet()->compilationStage() == Settings::CompilerSet::CompilationStage::GenerateExecutable) {
+        // the executable also depends on the libraries and objects linked into it
+        QString linkInputs;
+        if (!getLinkInputs(linkInputs))
+            return false;
+        identity += linkInputs;
+    }
+    mCacheKey = CompileCache::makeKey(preprocessed, identity, mArguments);
+    QByteArray diagnostics;
+    if (cache->fetchData(mCacheKey, "log", diagnostics)
+            && cache->fetch(mCacheKey, "out", mOutputFile)) {
+        mCacheHits++;
+        log(tr("- Restored \"%1\" from the compile cache.").arg(mOutputFile));
+        // show the warnings of the cached compile again
+        if (!diagnostics.isEmpty())
+            error(QString::fromUtf8(diagnostics));
+        error(COMPILE_PROCESS_END);
+        return true;
+    }
+    mCacheMisses++;
+    return false;
+}
+
+void FileCompiler::saveToCompileCache()
+{
+    if (mCacheKey.isEmpty() || mErrorCount > 0 || !fileExists(mOutputFile))
+        return;
+    std::shared_ptr<CompileCache> cache = createCompileCache();
+    if (!cache)
+        return;
+    if (!cache->storeData(mCacheKey, "log", mDiagnostics.toUtf8()))
+        return;
+    cache->store(mCacheKey, "out", mOutputFile);
+    cache->trim();
+}
+
+bool FileCompiler::getLinkInputs(QString &inputs)
+{
+    QStringList args = splitProcessCommand(mArguments);
+    QStringList libDirs;
+    QStringList libs;
+    QStringList files;
+    for (int i=0;i<args.count();i++) {
+        const QString& arg = args[i];
+        if (arg == "-o") {
+            i++;
+        } else if (arg == "-L" || arg == "-l") {
+            if (i+1<args.count())
+                (arg == "-L"?libDirs:libs).append(args[i+1]);
+            i++;
+        } else if (arg.startsWith("-L")) {
+            libDirs.append(arg.mid(2));
+        } else if (arg.startsWith("-l")) {
+            libs.append(arg.mid(2));
+        } else if (!arg.startsWith('-')) {
+            QString suffix = QFileInfo(arg).suffix().toLower();
+            if (suffix == "o" || suffix == "obj" || suffix == "a" || suffix == "lib"
+                    || suffix == "so" || suffix == "dll" || suffix == "dylib")
+                files.append(arg);
+        }
+    }
+    libDirs.append(compilerSet()->defaultLibDirs());
+    foreach (const QString& lib, libs) {
+        QStringList names;
+        if (lib.startsWith(':'))
+            names.append(lib.mid(1));
+        else
+            names<<QString("lib%1.a").arg(lib)<<QString("lib%1.dll.a").arg(lib)
+                <<QString("lib%1.so").arg(lib)<<QString("lib%1.dylib").arg(lib)
+                <<QString("%1.lib").arg(lib);
+        int count = files.count();
+        foreach (const QString& dir, libDirs) {
+            foreach (const QString& name, names) {
+                QString path = generateAbsolutePath(dir, name);
+                if (fileExists(path))
+                    files.append(path);
+            }
+        }
+        // can't tell which file the linker will use
+        if (files.count() == count)
+            return false;
+    }
+    foreach (const QString& file, files) {
+        QFileInfo info(generateAbsolutePath(mDirectory, file));
+        if (!info.exists())
+            return false;
+        inputs += QString("|%1|%2|%3").arg(info.absoluteFilePath())
+                .arg(info.size())
+                .arg(info.lastModified().toMSecsSinceEpoch());
+    }
+    return true;
+}
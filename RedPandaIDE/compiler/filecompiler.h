@@ -35,9 +35,14 @@ protected:
 private:
     QByteArray mEncoding;
     CppCompileType mCompileType;
+    QString mPreprocessArguments; // empty if the output can't be cached
+    QByteArray mCacheKey;
+    bool getLinkInputs(QString& inputs);
     // Compiler interface
 protected:
     bool prepareForRebuild() override;
+    bool restoreFromCompileCache() override;
+    void saveToCompileCache() override;
 };
 
 #endif // FILECOMPILER_H
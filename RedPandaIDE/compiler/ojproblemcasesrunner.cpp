@@ -20,41 +20,109 @@
 #include "../systemconsts.h"
 #include <QElapsedTimer>
 #include <QProcess>
+#include <QRunnable>
+#include <QThreadPool>
 #ifdef Q_OS_WINDOWS
 #include <psapi.h>
 #endif
+#ifdef Q_OS_LINUX
+#include <QFile>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#endif
 
+namespace {
+class ProblemCaseRunnable : public QRunnable {
+public:
+    explicit ProblemCaseRunnable(OJProblemCasesRunner* runner, int index):
+        mRunner(runner),
+        mIndex(index) {
+    }
+    void run() override {
+        mRunner->runCase(mIndex);
+    }
+private:
+    OJProblemCasesRunner* mRunner;
+    int mIndex;
+};
+}
 
 OJProblemCasesRunner::OJProblemCasesRunner(const QString& filename, const QStringList& arguments, const QString& workDir,
                                            const QVector<POJProblemCase>& problemCases, QObject *parent):
-    Runner(filename,arguments,workDir,parent),
-    mExecTimeout(0),
-    mMemoryLimit(0)
+    Runner(filename,arguments,workDir,parent)
 {
     mProblemCases = problemCases;
-    mBufferSize = 8192;
-    mOutputRefreshTime = 1000;
-    setWaitForFinishTime(100);
+    init();
 }
 
 OJProblemCasesRunner::OJProblemCasesRunner(const QString& filename, const QStringList& arguments, const QString& workDir,
                                            POJProblemCase problemCase, QObject *parent):
-    Runner(filename,arguments,workDir,parent),
-    mExecTimeout(0),
-    mMemoryLimit(0)
+    Runner(filename,arguments,workDir,parent)
 {
     mProblemCases.append(problemCase);
+    init();
+}
+
+void OJProblemCasesRunner::init()
+{
+    mExecTimeout = 0;
+    mMemoryLimit = 0;
+    mLimitBySystem = false;
+    mSanitized = false;
+    mParallelCount = 1;
+    mStreamOutput = true;
+    mFinishedCount = 0;
     mBufferSize = 8192;
     mOutputRefreshTime = 1000;
     setWaitForFinishTime(100);
+
+    //settings are not thread safe, so read them in the gui thread
+    mRedirectStderr = pSettings->executor().redirectStderrToToolLog();
+    mEnvironment = QProcessEnvironment::systemEnvironment();
+    QString path = mEnvironment.value("PATH");
+    QStringList pathAdded;
+    if (pSettings->compilerSets().defaultSet()) {
+        foreach(const QString& dir, pSettings->compilerSets().defaultSet()->binDirs()) {
+            pathAdded.append(dir);
+        }
+    }
+    pathAdded.append(pSettings->dirs().appDir());
+    if (!path.isEmpty()) {
+        path= pathAdded.join(PATH_SEPARATOR) + PATH_SEPARATOR + path;
+    } else {
+        path = pathAdded.join(PATH_SEPARATOR);
+    }
+    mEnvironment.insert("PATH",path);
 }
 
-void OJProblemCasesRunner::runCase(int index,POJProblemCase problemCase)
+void OJProblemCasesRunner::runCase(int index)
 {
-    emit caseStarted(problemCase->getId(),index, mProblemCases.count());
-    auto action = finally([this,&index, &problemCase]{
-        emit caseFinished(problemCase->getId(), index, mProblemCases.count());
+    if (mStop)
+        return;
+    POJProblemCase problemCase = mProblemCases[index];
+    emit caseStarted(problemCase->getId(), mFinishedCount.loadAcquire(), mProblemCases.count());
+    auto action = finally([this, &problemCase]{
+        int finishedCount = mFinishedCount.fetchAndAddOrdered(1)+1;
+        emit caseFinished(problemCase->getId(), finishedCount, mProblemCases.count());
     });
+    if (mRedirectStderr)
+        emit logStderrOutput("\n");
+#ifdef Q_OS_LINUX
+    runCaseByFork(problemCase);
+#else
+    runCaseByQProcess(problemCase);
+#endif
+}
+
+void OJProblemCasesRunner::runCaseByQProcess(POJProblemCase problemCase)
+{
     QProcess process;
     bool errorOccurred = false;
     QByteArray readed;
@@ -66,26 +134,9 @@ void OJProblemCasesRunner::runCase(int index,POJProblemCase problemCase)
     process.setProgram(mFilename);
     process.setArguments(mArguments);
     process.setWorkingDirectory(mWorkDir);
-    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
-    QString path = env.value("PATH");
-    QStringList pathAdded;
     bool writeChannelClosed = false;
-    if (pSettings->compilerSets().defaultSet()) {
-        foreach(const QString& dir, pSettings->compilerSets().defaultSet()->binDirs()) {
-            pathAdded.append(dir);
-        }
-    }
-    pathAdded.append(pSettings->dirs().appDir());
-    if (!path.isEmpty()) {
-        path= pathAdded.join(PATH_SEPARATOR) + PATH_SEPARATOR + path;
-    } else {
-        path = pathAdded.join(PATH_SEPARATOR);
-    }
-    env.insert("PATH",path);
-    process.setProcessEnvironment(env);
-    if (pSettings->executor().redirectStderrToToolLog()) {
-        emit logStderrOutput("\n");
-    } else {
+    process.setProcessEnvironment(mEnvironment);
+    if (!mRedirectStderr) {
         process.setProcessChannelMode(QProcess::MergedChannels);
         process.setReadChannel(QProcess::StandardOutput);
     }
@@ -134,7 +185,7 @@ void OJProblemCasesRunner::runCase(int index,POJProblemCase problemCase)
         }
         if (errorOccurred)
             break;
-        if (pSettings->executor().redirectStderrToToolLog()) {
+        if (mRedirectStderr) {
             QString s = QString::fromLocal8Bit(process.readAllStandardError());
             if (!s.isEmpty())
                 emit logStderrOutput(s);
@@ -142,7 +193,10 @@ void OJProblemCasesRunner::runCase(int index,POJProblemCase problemCase)
         readed = process.read(mBufferSize);
         buffer += readed;
         if (buffer.length()>=mBufferSize || noOutputTime > mOutputRefreshTime) {
-            if (!buffer.isEmpty()) {
+            if (!mStreamOutput) {
+                output.append(buffer);
+                buffer.clear();
+            } else if (!buffer.isEmpty()) {
                 emit newOutputGetted(problemCase->getId(),QString::fromLocal8Bit(buffer));
                 output.append(buffer);
                 buffer.clear();
@@ -181,16 +235,19 @@ void OJProblemCasesRunner::runCase(int index,POJProblemCase problemCase)
         problemCase->output = tr("Memory limit exceeded!");
         emit resetOutput(problemCase->getId(), problemCase->output);
     } else {
-        if (pSettings->executor().redirectStderrToToolLog()) {
+        if (mRedirectStderr) {
             QString s = QString::fromLocal8Bit(process.readAllStandardError());
             if (!s.isEmpty())
                 emit logStderrOutput(s);
         }
         if (process.state() == QProcess::ProcessState::NotRunning)
             buffer += process.readAll();
-        emit newOutputGetted(problemCase->getId(),QString::fromLocal8Bit(buffer));
         output.append(buffer);
         problemCase->output = QString::fromLocal8Bit(output);
+        if (mStreamOutput)
+            emit newOutputGetted(problemCase->getId(),QString::fromLocal8Bit(buffer));
+        else
+            emit resetOutput(problemCase->getId(), problemCase->output);
 
         if (errorOccurred) {
             //qDebug()<<"process error:"<<process.error();
@@ -218,20 +275,367 @@ void OJProblemCasesRunner::runCase(int index,POJProblemCase problemCase)
     }
 }
 
+#ifdef Q_OS_LINUX
+static void closeFd(int &fd)
+{
+    if (fd>=0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+static bool isSanitizedProgram(const QString& filename)
+{
+    QFile file(filename);
+    if (!file.open(QFile::ReadOnly))
+        return false;
+    qint64 size = file.size();
+    uchar* data = file.map(0, size);
+    if (!data)
+        return false;
+    QByteArray content = QByteArray::fromRawData((const char*)data, size);
+    bool result = content.contains("__asan_init")
+            || content.contains("__tsan_init")
+            || content.contains("__msan_init")
+            || content.contains("__ubsan_handle_");
+    file.unmap(data);
+    return result;
+}
+
+// peak resident set size of a running process, in bytes
+static qulonglong peakMemoryOfProcess(pid_t pid)
+{
+    QFile file(QString("/proc/%1/status").arg(pid));
+    if (!file.open(QFile::ReadOnly))
+        return 0;
+    foreach (const QByteArray& line, file.readAll().split('\n')) {
+        if (line.startsWith("VmHWM:")) {
+            return line.mid(6).trimmed().split(' ').front().toULongLong()*1024;
+        }
+    }
+    return 0;
+}
+
+void OJProblemCasesRunner::runCaseByFork(POJProblemCase problemCase)
+{
+    QByteArray input;
+    if (fileExists(problemCase->inputFileName))
+        input = readFileToByteArray(problemCase->inputFileName);
+    else
+        input = problemCase->input.toUtf8();
+    problemCase->output.clear();
+    problemCase->runningTime = 0;
+    problemCase->runningMemory = 0;
+
+    // the child of a multi-threaded process may only call async-signal-safe functions,
+    // so everything it needs is prepared before fork()
+    QByteArray program = QFile::encodeName(mFilename);
+    QByteArray workDir = QFile::encodeName(mWorkDir);
+    QList<QByteArray> argStrings;
+    argStrings.append(program);
+    foreach (const QString& arg, mArguments)
+        argStrings.append(arg.toLocal8Bit());
+    QVector<char*> argv;
+    for (QByteArray& arg:argStrings)
+        argv.append(arg.data());
+    argv.append(nullptr);
+    QList<QByteArray> envStrings;
+    foreach (const QString& env, mEnvironment.toStringList())
+        envStrings.append(env.toLocal8Bit());
+    QVector<char*> envp;
+    for (QByteArray& env:envStrings)
+        envp.append(env.data());
+    envp.append(nullptr);
+    rlim_t cpuLimit = 0;
+    rlim_t dataLimit = 0;
+    if (mLimitBySystem) {
+        if (mExecTimeout>0)
+            cpuLimit = (mExecTimeout+999)/1000;
+        if (!mSanitized)
+            dataLimit = mMemoryLimit;
+    }
+
+    int inPipe[2]={-1,-1};
+    int outPipe[2]={-1,-1};
+    int errPipe[2]={-1,-1};
+    int execPipe[2]={-1,-1};
+    auto closePipes = finally([&]{
+        for (int* fds: {inPipe, outPipe, errPipe, execPipe}) {
+            closeFd(fds[0]);
+            closeFd(fds[1]);
+        }
+    });
+    if (pipe2(inPipe, O_CLOEXEC)!=0
+            || pipe2(outPipe, O_CLOEXEC)!=0
+            || (mRedirectStderr && pipe2(errPipe, O_CLOEXEC)!=0)
+            || pipe2(execPipe, O_CLOEXEC)!=0) {
+        emit runErrorOccurred(tr("The runner process '%1' failed to start.").arg(mFilename));
+        return;
+    }
+
+    // writing to a closed pipe must fail with EPIPE instead of killing the ide
+    sigset_t pipeSignal;
+    sigemptyset(&pipeSignal);
+    sigaddset(&pipeSignal, SIGPIPE);
+    sigset_t oldSignalMask;
+    pthread_sigmask(SIG_BLOCK, &pipeSignal, &oldSignalMask);
+
+    pid_t pid = fork();
+    if (pid==0) {
+        dup2(inPipe[0], STDIN_FILENO);
+        dup2(outPipe[1], STDOUT_FILENO);
+        dup2(mRedirectStderr?errPipe[1]:outPipe[1], STDERR_FILENO);
+        // own process group, so the whole group can be killed
+        setpgid(0,0);
+        signal(SIGPIPE, SIG_DFL);
+        sigprocmask(SIG_SETMASK, &oldSignalMask, nullptr);
+        if (cpuLimit>0) {
+            struct rlimit limit;
+            limit.rlim_cur = cpuLimit;
+            limit.rlim_max = cpuLimit+1;
+            setrlimit(RLIMIT_CPU, &limit);
+        }
+        if (dataLimit>0) {
+            struct rlimit limit;
+            limit.rlim_cur = dataLimit;
+            limit.rlim_max = dataLimit;
+            setrlimit(RLIMIT_DATA, &limit);
+        }
+        if (workDir.isEmpty() || chdir(workDir.constData())==0)
+            execve(program.constData(), argv.data(), envp.data());
+        int error = errno;
+        ssize_t ignored = write(execPipe[1], &error, sizeof(error));
+        Q_UNUSED(ignored);
+        _exit(127);
+    }
+    closeFd(inPipe[0]);
+    closeFd(outPipe[1]);
+    closeFd(errPipe[1]);
+    closeFd(execPipe[1]);
+    if (pid<0) {
+        emit runErrorOccurred(tr("The runner process '%1' failed to start.").arg(mFilename));
+        return;
+    }
+    // the exec pipe is closed by a successful execve()
+    int execError = 0;
+    ssize_t n;
+    do {
+        n = read(execPipe[0], &execError, sizeof(execError));
+    } while (n<0 && errno==EINTR);
+    if (n==sizeof(execError)) {
+        waitpid(pid, nullptr, 0);
+        emit runErrorOccurred(tr("The runner process '%1' failed to start.").arg(mFilename));
+        return;
+    }
+    fcntl(inPipe[1], F_SETFL, O_NONBLOCK);
+    fcntl(outPipe[0], F_SETFL, O_NONBLOCK);
+    if (errPipe[0]>=0)
+        fcntl(errPipe[0], F_SETFL, O_NONBLOCK);
+    if (input.isEmpty())
+        closeFd(inPipe[1]);
+    int pidFd = -1;
+#ifdef SYS_pidfd_open
+    // readable when the process exits, so short cases don't wait for the poll timeout
+    pidFd = syscall(SYS_pidfd_open, pid, 0);
+#endif
+    auto closePidFd = finally([&pidFd]{
+        closeFd(pidFd);
+    });
+
+    QByteArray buffer;
+    QByteArray output;
+    QByteArray errorOutput;
+    char readBuffer[8192];
+    int inputWritten = 0;
+    bool exited = false;
+    bool execTimeouted = false;
+    bool memoryExceeded = false;
+    int status = 0;
+    struct rusage usage;
+    memset(&usage, 0, sizeof(usage));
+    QElapsedTimer elapsedTimer;
+    QElapsedTimer refreshTimer;
+    elapsedTimer.start();
+    refreshTimer.start();
+    qint64 lastMemoryCheck = 0;
+
+    auto readFrom = [&](int &fd, QByteArray& target) {
+        while (fd>=0) {
+            ssize_t count = read(fd, readBuffer, sizeof(readBuffer));
+            if (count>0) {
+                target.append(readBuffer, count);
+            } else if (count==0) {
+                closeFd(fd);
+            } else if (errno!=EINTR) {
+                if (errno!=EAGAIN)
+                    closeFd(fd);
+                break;
+            }
+        }
+    };
+    auto killProcess = [&]{
+        ::kill(-pid, SIGKILL);
+        while (wait4(pid, &status, 0, &usage)<0 && errno==EINTR)
+            ;
+        exited = true;
+    };
+    while (!exited) {
+        struct pollfd fds[4];
+        int nfds = 0;
+        if (inPipe[1]>=0)
+            fds[nfds++] = {inPipe[1], POLLOUT, 0};
+        if (outPipe[0]>=0)
+            fds[nfds++] = {outPipe[0], POLLIN, 0};
+        if (errPipe[0]>=0)
+            fds[nfds++] = {errPipe[0], POLLIN, 0};
+        if (pidFd>=0)
+            fds[nfds++] = {pidFd, POLLIN, 0};
+        int timeout = mWaitForFinishTime;
+        if (pidFd<0 && outPipe[0]<0 && errPipe[0]<0)
+            timeout = 1;
+        poll(fds, nfds, timeout);
+
+        if (inPipe[1]>=0) {
+            ssize_t count = write(inPipe[1], input.constData()+inputWritten, input.length()-inputWritten);
+            if (count>0)
+                inputWritten += count;
+            if (inputWritten>=input.length() || (count<0 && errno!=EAGAIN && errno!=EINTR)) {
+                closeFd(inPipe[1]);
+                // consume the SIGPIPE generated if the program didn't read all input
+                struct timespec noWait{0,0};
+                sigtimedwait(&pipeSignal, nullptr, &noWait);
+            }
+        }
+        readFrom(outPipe[0], buffer);
+        if (errPipe[0]>=0) {
+            readFrom(errPipe[0], errorOutput);
+            if (mStreamOutput && !errorOutput.isEmpty()) {
+                emit logStderrOutput(QString::fromLocal8Bit(errorOutput));
+                errorOutput.clear();
+            }
+        }
+        if (buffer.length()>=mBufferSize || refreshTimer.elapsed() > mOutputRefreshTime) {
+            if (mStreamOutput && !buffer.isEmpty())
+                emit newOutputGetted(problemCase->getId(),QString::fromLocal8Bit(buffer));
+            output.append(buffer);
+            buffer.clear();
+            refreshTimer.restart();
+        }
+
+        pid_t result = wait4(pid, &status, WNOHANG, &usage);
+        if (result==pid || (result<0 && errno!=EINTR)) {
+            exited = true;
+            break;
+        }
+        qint64 msec = elapsedTimer.elapsed();
+        if (mExecTimeout>0 && msec>mExecTimeout) {
+            execTimeouted = true;
+            killProcess();
+            break;
+        }
+        if (mMemoryLimit>0 && msec - lastMemoryCheck >= mWaitForFinishTime) {
+            lastMemoryCheck = msec;
+            if (peakMemoryOfProcess(pid)>mMemoryLimit) {
+                memoryExceeded = true;
+                killProcess();
+                break;
+            }
+        }
+        if (mStop) {
+            killProcess();
+            break;
+        }
+    }
+    // the program may have left children holding the pipes
+    ::kill(-pid, SIGKILL);
+    readFrom(outPipe[0], buffer);
+    readFrom(errPipe[0], errorOutput);
+    pthread_sigmask(SIG_SETMASK, &oldSignalMask, nullptr);
+
+    problemCase->runningMemory = (qulonglong)usage.ru_maxrss*1024;
+    problemCase->runningTime = (qulonglong)usage.ru_utime.tv_sec*1000 + usage.ru_utime.tv_usec/1000
+            + (qulonglong)usage.ru_stime.tv_sec*1000 + usage.ru_stime.tv_usec/1000;
+    if (WIFSIGNALED(status) && WTERMSIG(status)==SIGXCPU)
+        execTimeouted = true;
+    // a failed allocation under RLIMIT_DATA ends as an uncaught bad_alloc or a null pointer crash,
+    // other crashes are runtime errors even if the program used a lot of memory
+    if (dataLimit>0 && WIFSIGNALED(status)
+            && (WTERMSIG(status)==SIGABRT || WTERMSIG(status)==SIGSEGV || WTERMSIG(status)==SIGBUS)
+            && (errorOutput.contains("bad_alloc") || buffer.contains("bad_alloc")
+                || problemCase->runningMemory >= dataLimit))
+        memoryExceeded = true;
+    if (execTimeouted) {
+        problemCase->output = tr("Time limit exceeded!");
+        emit resetOutput(problemCase->getId(), problemCase->output);
+    } else if (memoryExceeded || (mMemoryLimit>0 && problemCase->runningMemory>mMemoryLimit)) {
+        problemCase->output = tr("Memory limit exceeded!");
+        emit resetOutput(problemCase->getId(), problemCase->output);
+    } else {
+        if (!errorOutput.isEmpty())
+            emit logStderrOutput(QString::fromLocal8Bit(errorOutput));
+        output.append(buffer);
+        problemCase->output = QString::fromLocal8Bit(output);
+        if (mStreamOutput)
+            emit newOutputGetted(problemCase->getId(),QString::fromLocal8Bit(buffer));
+        else
+            emit resetOutput(problemCase->getId(), problemCase->output);
+    }
+}
+#endif
+
 void OJProblemCasesRunner::run()
 {
     emit started();
     auto action = finally([this]{
         emit terminated();
     });
+    mFinishedCount = 0;
+#ifdef Q_OS_LINUX
+    mSanitized = mLimitBySystem && mMemoryLimit>0 && isSanitizedProgram(mFilename);
+#endif
+    int workers = std::min(mParallelCount, mProblemCases.size());
+    if (workers<=1) {
+        mStreamOutput = true;
+        for (int i=0; i < mProblemCases.size(); i++) {
+            if (mStop)
+                break;
+            runCase(i);
+        }
+        return;
+    }
+    // cases are independent, each runs in its own process
+    mStreamOutput = false;
+    QThreadPool pool;
+    pool.setMaxThreadCount(workers);
     for (int i=0; i < mProblemCases.size(); i++) {
+        pool.start(new ProblemCaseRunnable(this, i));
+    }
+    while (!pool.waitForDone(mWaitForFinishTime)) {
         if (mStop)
-            break;
-        POJProblemCase problemCase = mProblemCases[i];
-        runCase(i,problemCase);
+            pool.clear();
     }
 }
 
+bool OJProblemCasesRunner::limitBySystem() const
+{
+    return mLimitBySystem;
+}
+
+void OJProblemCasesRunner::setLimitBySystem(bool newLimitBySystem)
+{
+    mLimitBySystem = newLimitBySystem;
+}
+
+int OJProblemCasesRunner::parallelCount() const
+{
+    return mParallelCount;
+}
+
+void OJProblemCasesRunner::setParallelCount(int newParallelCount)
+{
+    mParallelCount = std::max(1, newParallelCount);
+}
+
 int OJProblemCasesRunner::execTimeout() const
 {
     return mExecTimeout;
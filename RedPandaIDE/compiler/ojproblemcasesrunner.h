@@ -19,6 +19,8 @@
 
 #include "runner.h"
 #include <QVector>
+#include <QAtomicInt>
+#include <QProcessEnvironment>
 #include "../problems/ojproblemset.h"
 
 class OJProblemCasesRunner : public Runner
@@ -49,6 +51,15 @@ public:
 
     void setMemoryLimit(size_t limit);
 
+    //let the system (rlimit) enforce time and memory limits, only used on linux
+    bool limitBySystem() const;
+    void setLimitBySystem(bool newLimitBySystem);
+
+    //max number of cases run at the same time
+    int parallelCount() const;
+    void setParallelCount(int newParallelCount);
+
+    void runCase(int index);
 signals:
     void caseStarted(const QString &caseId, int current, int total);
     void caseFinished(const QString &caseId, int current, int total);
@@ -56,7 +67,11 @@ signals:
     void resetOutput(const QString &caseId, const QString &newOutputLine);
     void logStderrOutput(const QString& msg);
 private:
-    void runCase(int index, POJProblemCase problemCase);
+    void runCaseByQProcess(POJProblemCase problemCase);
+#ifdef Q_OS_LINUX
+    void runCaseByFork(POJProblemCase problemCase);
+#endif
+    void init();
 private:
     QVector<POJProblemCase> mProblemCases;
 
@@ -68,6 +83,14 @@ private:
     int mOutputRefreshTime;
     int mExecTimeout;
     size_t mMemoryLimit;
+    bool mLimitBySystem;
+    bool mSanitized; // sanitizers reserve huge address spaces, they can't run under RLIMIT_DATA
+    int mParallelCount;
+    // partial output is only reported when cases are run one by one
+    bool mStreamOutput;
+    bool mRedirectStderr;
+    QProcessEnvironment mEnvironment;
+    QAtomicInt mFinishedCount;
 };
 
 #endif // OJPROBLEMCASESRUNNER_H
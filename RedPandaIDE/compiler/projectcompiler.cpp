@@ -15,6 +15,7 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 #include "projectcompiler.h"
+#include "compilecache.h"
 #include "../project.h"
 #include "compilermanager.h"
 #include "../systemconsts.h"
@@ -22,6 +23,60 @@
 #include "../editor.h"
 
 #include <QDir>
+#include <QHash>
+#include <QRunnable>
+#include <QThreadPool>
+
+namespace {
+class CompileCacheRunnable : public QRunnable {
+public:
+    explicit CompileCacheRunnable(ProjectCompiler* compiler, int index):
+        mCompiler(compiler),
+        mIndex(index) {
+    }
+    void run() override {
+        mCompiler->restoreObjectFromCompileCache(mIndex);
+    }
+private:
+    ProjectCompiler* mCompiler;
+    int mIndex;
+};
+
+// the prerequisites of the first rule in a dependency file generated by -MMD
+QStringList readDependencies(const QString& depFile)
+{
+    QStringList result;
+    QFile file(depFile);
+    if (!file.open(QFile::ReadOnly))
+        return result;
+    QString content = QString::fromLocal8Bit(file.readAll());
+    content.replace("\\\r\n"," ");
+    content.replace("\\\n"," ");
+    int pos = content.indexOf(": ");
+    if (pos<0)
+        return result;
+    int end = content.indexOf('\n', pos);
+    if (end<0)
+        end = content.length();
+    QString current;
+    for (int i=pos+2;i<end;i++) {
+        QChar ch = content[i];
+        if (ch=='\\' && i+1<end && content[i+1]==' ') {
+            current += ' ';
+            i++;
+        } else if (ch==' ' || ch=='\t' || ch=='\r') {
+            if (!current.isEmpty())
+                result.append(current);
+            current.clear();
+        } else {
+            current += ch;
+        }
+    }
+    if (!current.isEmpty())
+        result.append(current);
+    return result;
+}
+}
 
 ProjectCompiler::ProjectCompiler(std::shared_ptr<Project> project):
     Compiler("",false),
@@ -35,6 +90,7 @@ void ProjectCompiler::buildMakeFile()
     //we are using custom make file, don't overwrite it
     if (mProject->options().useCustomMakefile && !mProject->options().customMakefile.isEmpty())
         return;
+    mCacheUnits.clear();
     switch(mProject->options().type) {
     case ProjectType::StaticLib:
         createStaticMakeFile();
@@ -140,6 +196,7 @@ void ProjectCompiler::writeMakeDefines(QFile &file)
     QString Objects;
     QString LinkObjects;
     QString cleanObjects;
+    QString depFiles;
 
     // Create a list of object files
     foreach(const PProjectUnit &unit, mProject->unitList()) {
@@ -158,21 +215,28 @@ void ProjectCompiler::writeMakeDefines(QFile &file)
                         + extractFileName(unit->fileName());
                 QString relativeObjFile = extractRelativePath(mProject->directory(), changeFileExt(fullObjFile, OBJ_EXT));
                 QString objFile = genMakePath2(relativeObjFile);
+                QString relativeDepFile = changeFileExt(relativeObjFile, DEP_EXT);
                 Objects += ' ' + objFile;
+                depFiles += ' ' + genMakePath2(relativeDepFile);
 #ifdef Q_OS_WIN
                 cleanObjects += ' ' + genMakePath1(relativeObjFile).replace("/",QDir::separator());
+                cleanObjects += ' ' + genMakePath1(relativeDepFile).replace("/",QDir::separator());
 #else
                 cleanObjects += ' ' + genMakePath1(relativeObjFile);
+                cleanObjects += ' ' + genMakePath1(relativeDepFile);
 #endif
                 if (unit->link()) {
                     LinkObjects += ' ' + genMakePath1(relativeObjFile);
                 }
             } else {
                 Objects += ' ' + genMakePath2(changeFileExt(RelativeName, OBJ_EXT));
+                depFiles += ' ' + genMakePath2(changeFileExt(RelativeName, DEP_EXT));
 #ifdef Q_OS_WIN
                 cleanObjects += ' ' + genMakePath1(changeFileExt(RelativeName, OBJ_EXT)).replace("/",QDir::separator());
+                cleanObjects += ' ' + genMakePath1(changeFileExt(RelativeName, DEP_EXT)).replace("/",QDir::separator());
 #else
                 cleanObjects += ' ' + genMakePath1(changeFileExt(RelativeName, OBJ_EXT));
+                cleanObjects += ' ' + genMakePath1(changeFileExt(RelativeName, DEP_EXT));
 #endif
                 if (unit->link())
                     LinkObjects = LinkObjects + ' ' + genMakePath1(changeFileExt(RelativeName, OBJ_EXT));
@@ -182,6 +246,7 @@ void ProjectCompiler::writeMakeDefines(QFile &file)
 
     Objects = Objects.trimmed();
     LinkObjects = LinkObjects.trimmed();
+    depFiles = depFiles.trimmed();
 
     // Get windres file
     QString objResFile;
@@ -265,6 +330,11 @@ void ProjectCompiler::writeMakeDefines(QFile &file)
     //writeln(file,"ENCODINGS = -finput-charset=utf-8 -fexec-charset='+GetSystemCharsetName);
     cCompileArguments.replace('\\', '/');
     writeln(file,"CFLAGS   = $(INCS) " + cCompileArguments);
+    mCacheCFlags = cIncludeArguments + " " + cCompileArguments;
+    mCacheCppFlags = cppIncludeArguments + " " + cppCompileArguments;
+    writeln(file,"DEPS     = " + depFiles);
+    // let the compiler list the headers each object depends on
+    writeln(file,"DEPFLAGS = -MMD -MP");
     writeln(file, QString("RM       = ") + CLEAN_PROGRAM );
     if (mProject->options().usePrecompiledHeader
             && fileExists(mProject->options().precompiledHeader)){
@@ -340,11 +410,12 @@ void ProjectCompiler::writeMakeClean(QFile &file)
 
 void ProjectCompiler::writeMakeObjFilesRules(QFile &file)
 {
-    PCppParser parser = mProject->cppParser();
     QString precompileStr;
+    if (mProject->options().usePrecompiledHeader
+            && fileExists(mProject->options().precompiledHeader))
+        precompileStr = " $(PCH) ";
 
-    QList<PProjectUnit> projectUnits=mProject->unitList();
-    foreach(const PProjectUnit &unit, projectUnits) {
+    foreach(const PProjectUnit &unit, mProject->unitList()) {
         if (!unit->compile())
             continue;
         FileType fileType = getFileType(unit->fileName());
@@ -357,27 +428,7 @@ void ProjectCompiler::writeMakeObjFilesRules(QFile &file)
 
         writeln(file);
         QString objStr=genMakePath2(shortFileName);
-        // if we have scanned it, use scanned info
-        if (parser && parser->scannedFiles().contains(unit->fileName())) {
-            QSet<QString> fileIncludes = parser->getFileIncludes(unit->fileName());
-            foreach(const PProjectUnit &unit2, projectUnits) {
-                if (unit2==unit)
-                    continue;
-                if (fileIncludes.contains(unit2->fileName())) {
-                    if (mProject->options().usePrecompiledHeader &&
-                           unit2->fileName() == mProject->options().precompiledHeader)
-                        precompileStr = " $(PCH) ";
-                    else
-                        objStr = objStr + ' ' + genMakePath2(extractRelativePath(mProject->makeFileName(),unit2->fileName()));
-                }
-            }
-        } else {
-            foreach(const PProjectUnit &unit2, projectUnits) {
-                FileType fileType = getFileType(unit2->fileName());
-                if (fileType == FileType::CHeader || fileType==FileType::CppHeader)
-                    objStr = objStr + ' ' + genMakePath2(extractRelativePath(mProject->makeFileName(),unit2->fileName()));
-            }
-        }
+        // headers are listed in the dependency files generated by the compiler
         QString objFileName;
         QString objFileName2;
         if (!mProject->options().objectOutput.isEmpty()) {
@@ -456,10 +507,34 @@ void ProjectCompiler::writeMakeObjFilesRules(QFile &file)
             }
 
             if (fileType==FileType::CSource || fileType==FileType::CppSource) {
+                CompileCacheUnit cacheUnit;
+                cacheUnit.compiler = unit->compileCpp()?compilerSet()->cppCompiler():compilerSet()->CCompiler();
+                cacheUnit.source = shortFileName;
+                if (!mProject->options().objectOutput.isEmpty()) {
+                    cacheUnit.objectFile = generateAbsolutePath(
+                                mProject->directory(),
+                                changeFileExt(includeTrailingPathDelimiter(mProject->options().objectOutput)
+                                              + extractFileName(unit->fileName()), OBJ_EXT));
+                } else {
+                    cacheUnit.objectFile = changeFileExt(unit->fileName(), OBJ_EXT);
+                }
+                cacheUnit.logFile = cacheUnit.objectFile + ".log";
+                // the diagnostics are stored with the cached object, and shown again when it's restored
+                QString logStr;
+                if (pSettings->environment().enableCompileCache())
+                    logStr = " 2> " + genMakePath1(extractRelativePath(mProject->makeFileName(), cacheUnit.logFile));
                 if (unit->compileCpp())
-                    writeln(file, "\t$(CPP) -c " + genMakePath1(shortFileName) + " -o " + objFileName2 + " $(CXXFLAGS) " + encodingStr);
+                    writeln(file, "\t$(CPP) -c " + genMakePath1(shortFileName) + " -o " + objFileName2 + " $(CXXFLAGS) $(DEPFLAGS) " + encodingStr + logStr);
                 else
-                    writeln(file, "\t$(CC) -c " + genMakePath1(shortFileName) + " -o " + objFileName2 + " $(CFLAGS) " + encodingStr);
+                    writeln(file, "\t$(CC) -c " + genMakePath1(shortFileName) + " -o " + objFileName2 + " $(CFLAGS) $(DEPFLAGS) " + encodingStr + logStr);
+                cacheUnit.depFile = changeFileExt(cacheUnit.objectFile, DEP_EXT);
+                QString flags = unit->compileCpp()?mCacheCppFlags:mCacheCFlags;
+                cacheUnit.preprocessArguments = QString(" \"%1\" -E %2 %3").arg(shortFileName, flags, encodingStr);
+                // the object and the dependency file embed the paths, so they are part of the key
+                cacheUnit.compileArguments = QString("%1|-c %2 -o %3 %4 -MMD -MP %5").arg(
+                            mProject->directory(), shortFileName, objFileName2, flags, encodingStr);
+                cacheUnit.restored = false;
+                mCacheUnits.append(cacheUnit);
             } else if (fileType==FileType::GAS) {
                 writeln(file, "\t$(CC) -c " + genMakePath1(shortFileName) + " -o " + objFileName2 + " $(CFLAGS) " + encodingStr);
             }
@@ -514,6 +589,8 @@ void ProjectCompiler::writeMakeObjFilesRules(QFile &file)
         writeln(file);
     }
 #endif
+    writeln(file);
+    writeln(file, "-include $(DEPS)");
 }
 
 void ProjectCompiler::writeln(QFile &file, const QString &s)
@@ -539,6 +616,137 @@ bool ProjectCompiler::prepareForRebuild()
     return true;
 }
 
+bool ProjectCompiler::beforeRunExtraCommand(int idx)
+{
+    // objects can only be restored after "make clean" when rebuilding
+    if (mRebuild && idx==0)
+        restoreObjectsFromCompileCache();
+    return true;
+}
+
+bool ProjectCompiler::restoreFromCompileCache()
+{
+    if (!mRebuild && !mOnlyClean)
+        restoreObjectsFromCompileCache();
+    // make still has to link the program
+    return false;
+}
+
+void ProjectCompiler::saveToCompileCache()
+{
+    if (!mCompileCache)
+        return;
+    bool hasDiagnostics = false;
+    foreach (const CompileCacheUnit& unit, mCacheUnits) {
+        // the logs are removed before make runs, so only objects compiled by it have one
+        QFile logFile(unit.logFile);
+        if (!logFile.open(QFile::ReadOnly))
+            continue;
+        QByteArray diagnostics = logFile.readAll();
+        logFile.close();
+        logFile.remove();
+        if (!diagnostics.isEmpty()) {
+            error(decodeDiagnostics(diagnostics));
+            hasDiagnostics = true;
+        }
+        if (unit.key.isEmpty() || unit.restored)
+            continue;
+        QFileInfo info(unit.objectFile);
+        // not rebuilt, make failed or stopped before it
+        if (!info.exists() || (unit.objectTime.isValid() && info.lastModified() <= unit.objectTime))
+            continue;
+        if (!fileExists(unit.depFile))
+            continue;
+        if (!mCompileCache->storeData(unit.key, "log", diagnostics))
+            continue;
+        mCompileCache->store(unit.key, "d", unit.depFile);
+        mCompileCache->store(unit.key, "o", unit.objectFile);
+    }
+    if (hasDiagnostics)
+        error(COMPILE_PROCESS_END);
+    mCompileCache->trim();
+    mCompileCache.reset();
+}
+
+void ProjectCompiler::restoreObjectsFromCompileCache()
+{
+    mCompileCache = createCompileCache();
+    if (!mCompileCache || mCacheUnits.isEmpty())
+        return;
+    QHash<QString,QString> compilerIdentities;
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1,QThread::idealThreadCount()));
+    for (int i=0;i<mCacheUnits.count();i++) {
+        CompileCacheUnit& unit = mCacheUnits[i];
+        if (!compilerIdentities.contains(unit.compiler))
+            compilerIdentities.insert(unit.compiler,
+                                      CompileCache::compilerIdentity(unit.compiler, compilerSet()->version()));
+        unit.compilerIdentity = compilerIdentities.value(unit.compiler);
+        unit.key.clear();
+        unit.diagnostics.clear();
+        unit.restored = false;
+        QFile::remove(unit.logFile);
+        QFileInfo info(unit.objectFile);
+        unit.objectTime = info.exists()?info.lastModified():QDateTime();
+        // check it like make does, only outdated objects are looked up
+        bool outdated = !unit.objectTime.isValid() || !fileExists(unit.depFile);
+        if (!outdated) {
+            QStringList dependencies = readDependencies(unit.depFile);
+            if (dependencies.isEmpty())
+                dependencies.append(unit.source);
+            foreach (const QString& dependency, dependencies) {
+                QFileInfo depInfo(generateAbsolutePath(mProject->directory(),dependency));
+                if (!depInfo.exists() || depInfo.lastModified() > unit.objectTime) {
+                    outdated = true;
+                    break;
+                }
+            }
+        }
+        if (outdated)
+            pool.start(new CompileCacheRunnable(this, i));
+    }
+    pool.waitForDone();
+    foreach (const CompileCacheUnit& unit, mCacheUnits) {
+        if (unit.key.isEmpty())
+            continue;
+        if (unit.restored) {
+            mCacheHits++;
+            log(tr("- Restored \"%1\" from the compile cache.").arg(unit.objectFile));
+            // show the warnings of the cached compile again
+            if (!unit.diagnostics.isEmpty())
+                error(decodeDiagnostics(unit.diagnostics));
+        } else {
+            mCacheMisses++;
+        }
+    }
+}
+
+void ProjectCompiler::restoreObjectFromCompileCache(int index)
+{
+    CompileCacheUnit& unit = mCacheUnits[index];
+    QByteArray preprocessed;
+    if (!CompileCache::preprocess(unit.compiler, unit.preprocessArguments, mProject->directory(), preprocessed))
+        return;
+    unit.key = CompileCache::makeKey(
+                preprocessed,
+                unit.compilerIdentity,
+                unit.compileArguments);
+    if (!QDir().mkpath(extractFileDir(unit.objectFile)))
+        return;
+    // the dependency file first, so a restored object always has its dependencies
+    unit.restored = mCompileCache->fetchData(unit.key, "log", unit.diagnostics)
+            && mCompileCache->fetch(unit.key, "d", unit.depFile)
+            && mCompileCache->fetch(unit.key, "o", unit.objectFile);
+}
+
+QString ProjectCompiler::decodeDiagnostics(const QByteArray &diagnostics)
+{
+    // like the error output read in runCommand()
+    if (compilerSet()->isCompilerInfoUsingUTF8())
+        return QString::fromUtf8(diagnostics);
+    return QString::fromLocal8Bit(diagnostics);
+}
+
 bool ProjectCompiler::prepareForCompile()
 {
     if (!mProject)
@@ -20,6 +20,7 @@
 #include "compiler.h"
 #include <QObject>
 #include <QFile>
+#include <QDateTime>
 
 class Project;
 class ProjectCompiler : public Compiler
@@ -46,12 +47,39 @@ private:
     void writeMakeClean(QFile& file);
     void writeMakeObjFilesRules(QFile& file);
     void writeln(QFile& file, const QString& s="");
+    void restoreObjectsFromCompileCache();
+    QString decodeDiagnostics(const QByteArray& diagnostics);
+public:
+    void restoreObjectFromCompileCache(int index);
+private:
+    // an object file built by a standard makefile rule, which can be cached
+    struct CompileCacheUnit {
+        QString compiler;
+        QString compilerIdentity;
+        QString source; // relative to the project directory, as in the makefile
+        QString objectFile;
+        QString depFile;
+        QString logFile; // error output of the compile, written by the makefile rule
+        QString preprocessArguments;
+        QString compileArguments;
+        QDateTime objectTime; // last modified time before the build, invalid if not exists
+        QByteArray key; // empty if the object is up to date or can't be cached
+        QByteArray diagnostics; // of the cached compile, if restored
+        bool restored;
+    };
     // Compiler interface
 private:
     bool mOnlyClean;
+    QString mCacheCFlags;
+    QString mCacheCppFlags;
+    QList<CompileCacheUnit> mCacheUnits;
+    std::shared_ptr<CompileCache> mCompileCache;
 protected:
     bool prepareForCompile() override;
     bool prepareForRebuild() override;
+    bool beforeRunExtraCommand(int idx) override;
+    bool restoreFromCompileCache() override;
+    void saveToCompileCache() override;
 };
 
 #endif // PROJECTCOMPILER_H
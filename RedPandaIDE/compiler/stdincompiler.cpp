@@ -74,6 +74,7 @@ bool StdinCompiler::prepareForCompile()
     default:
         throw CompileError(tr("Can't find the compiler for file %1").arg(mFilename));
     }
+    mArguments += getDiagnosticsFormatArgument();
     if (!mOnlyCheckSyntax)
         mArguments += getLibraryArguments(fileType);
 
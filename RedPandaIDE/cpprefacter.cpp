@@ -199,6 +199,10 @@ void CppRefacter::doFindOccurenceInProject(PStatement statement, std::shared_ptr
 
             if (progressDlg.wasCanceled())
                 break;
+            // macros are expanded before the parser indexes the identifiers
+            if (statement->kind != StatementKind::skPreprocessor
+                    && !parser->mayReferTo(unit->fileName(), statement->command))
+                continue;
             PSearchResultTreeItem item = findOccurenceInFile(
                         unit->fileName(),
                         unit->encoding()==ENCODING_PROJECT?project->options().encoding:unit->encoding(),
@@ -240,7 +244,7 @@ PSearchResultTreeItem CppRefacter::findOccurenceInFile(
     int posY = 0;
     while (posY < editor.document()->count()) {
         QString line = editor.document()->getLine(posY);
-        if (line.isEmpty()) {
+        if (!line.contains(statement->command)) {
             posY++;
             continue;
         }
@@ -301,6 +305,10 @@ void CppRefacter::renameSymbolInFile(const QString &filename, const PStatement &
         oldEditor->beginEditing();
         while (posY < oldEditor->document()->count()) {
             QString line = oldEditor->document()->getLine(posY);
+            if (!line.contains(statement->command)) {
+                posY++;
+                continue;
+            }
             if (posY == 0) {
                 syntaxer->resetState();
             } else {
@@ -353,6 +361,11 @@ void CppRefacter::renameSymbolInFile(const QString &filename, const PStatement &
         int posY = 0;
         while (posY < editor.document()->count()) {
             QString line = editor.document()->getLine(posY);
+            if (!line.contains(statement->command)) {
+                newContents.append(line);
+                posY++;
+                continue;
+            }
             if (posY == 0) {
                 editor.syntaxer()->resetState();
             } else {
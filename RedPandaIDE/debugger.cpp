@@ -33,6 +33,9 @@
 #include <QJsonObject>
 #include "widgets/signalmessagedialog.h"
 
+//max number of commands sent to gdb without waiting for their results
+#define MAX_PIPELINED_DEBUG_COMMANDS 8
+
 Debugger::Debugger(QObject *parent) : QObject(parent),
     mForceUTF8(false),
     mDebuggerType(DebuggerType::GDB),
@@ -226,6 +229,17 @@ void Debugger::cleanUpReader()
     if (mExecuting) {
         mExecuting = false;
 
+        DebugLatencyStats stats = mReader->latencyStats();
+        if (stats.steps>0
+                && pSettings->debugger().enableDebugConsole()
+                && pSettings->debugger().showDetailLog()) {
+            pMainWindow->addDebugOutput(
+                        tr("%1 steps, average latency %2 ms, max latency %3 ms.")
+                        .arg(stats.steps)
+                        .arg(stats.totalLatency / stats.steps)
+                        .arg(stats.maxLatency));
+        }
+
         //stop debugger
         mReader->deleteLater();
         mReader=nullptr;
@@ -987,8 +1001,16 @@ DebugReader::DebugReader(Debugger* debugger, QObject *parent) : QThread(parent),
 {
     mDebugger = debugger;
     mProcess = std::make_shared<QProcess>();
-    mCmdRunning = false;
     mAsyncUpdated = false;
+    mDispatcher = nullptr;
+    mDispatchPending = false;
+    mNextToken = 0;
+    mExclusiveCmdRunning = false;
+    mVisibleCmdCount = 0;
+    mStepTiming = false;
+    mStepStopped = false;
+    mStepRoundTrips = 0;
+    mLatencyStats = DebugLatencyStats{0,0,0,0,0};
 }
 
 void DebugReader::postCommand(const QString &Command, const QString &Params,
@@ -1000,8 +1022,18 @@ void DebugReader::postCommand(const QString &Command, const QString &Params,
     pCmd->params = Params;
     pCmd->source = Source;
     mCmdQueue.enqueue(pCmd);
-//    if (!mCmdRunning)
-    //        runNextCmd();
+    wakeUp();
+}
+
+void DebugReader::wakeUp()
+{
+    QMutexLocker locker(&mCmdQueueMutex);
+    if (mDispatcher && !mDispatchPending) {
+        mDispatchPending = true;
+        QMetaObject::invokeMethod(mDispatcher, [this]{
+            runNextCmd();
+        }, Qt::QueuedConnection);
+    }
 }
 
 void DebugReader::registerInferiorStoppedCommand(const QString &Command, const QString &Params)
@@ -1191,6 +1223,8 @@ void DebugReader::processExecAsyncRecord(const QByteArray &line)
     }
     if (result == "stopped") {
         mInferiorRunning = false;
+        // the step ends when the refresh commands triggered by the stop are handled
+        mStepStopped = true;
         QByteArray reason = multiValues["reason"].value();
         if (reason == "exited") {
             //inferior exited, gdb should terminate too
@@ -1324,7 +1358,7 @@ void DebugReader::processResultRecord(const QByteArray &line)
     }
 }
 
-void DebugReader::processDebugOutput(const QByteArray& debugOutput)
+void DebugReader::processDebugOutput(const QList<QByteArray>& lines)
 {
     // Only update once per update at most
     //WatchView.Items.BeginUpdate;
@@ -1337,13 +1371,17 @@ void DebugReader::processDebugOutput(const QByteArray& debugOutput)
     mSignalReceived = false;
     mUpdateCPUInfo = false;
     mReceivedSFWarning = false;
-    QList<QByteArray> lines = splitByteArrayToLines(debugOutput);
+    if (mStepTiming)
+        mStepRoundTrips++;
+    // output not tagged by a token belongs to the oldest command still running
+    mCurrentCmd = mInFlightCmds.isEmpty()?nullptr:mInFlightCmds.first();
 
     for (int i=0;i<lines.count();i++) {
          QByteArray line = lines[i];
          if (pSettings->debugger().showDetailLog())
             mFullOutput.append(line);
-         line = removeToken(line);
+         int token;
+         line = removeToken(line, token);
          if (line.isEmpty()) {
              continue;
          }
@@ -1356,9 +1394,18 @@ void DebugReader::processDebugOutput(const QByteArray& debugOutput)
          case '&': // log stream output
              processLogOutput(line);
              break;
-         case '^': // result record
+         case '^': { // result record
+             PDebugCommand cmd = mInFlightCmds.value(token);
+             if (!cmd && !mInFlightCmds.isEmpty()) {
+                 // the debugger doesn't echo the token, results come in order
+                 cmd = mInFlightCmds.first();
+             }
+             mCurrentCmd = cmd;
              processResultRecord(line);
+             if (cmd)
+                 finishCommand(cmd);
              break;
+         }
          case '*': // exec async output
              processExecAsyncRecord(line);
              break;
@@ -1383,26 +1430,93 @@ void DebugReader::runInferiorStoppedHook()
 void DebugReader::runNextCmd()
 {
     QMutexLocker locker(&mCmdQueueMutex);
-
-    if (mCurrentCmd) {
-        DebugCommandSource commandSource = mCurrentCmd->source;
-        mCurrentCmd=nullptr;
-        if (commandSource!=DebugCommandSource::HeartBeat)
-            emit cmdFinished();
+    mDispatchPending = false;
+    if (mStop)
+        return;
+    while (!mCmdQueue.isEmpty()) {
+        bool exclusive = !canPipeline(mCmdQueue.head());
+        if (!mInFlightCmds.isEmpty()
+                && (exclusive || mExclusiveCmdRunning
+                    || mInFlightCmds.count()>=MAX_PIPELINED_DEBUG_COMMANDS))
+            break;
+        PDebugCommand pCmd = mCmdQueue.dequeue();
+        mExclusiveCmdRunning = exclusive;
+        writeCommand(pCmd);
+        if (exclusive)
+            break;
     }
-    if (mCmdQueue.isEmpty()) {
-        if (pSettings->debugger().useGDBServer() && mInferiorRunning && !mAsyncUpdated) {
-            mAsyncUpdated = true;
-            QTimer::singleShot(50,this,&DebugReader::asyncUpdate);
+    if (!mInFlightCmds.isEmpty() || !mCmdQueue.isEmpty())
+        return;
+    if (mStepTiming && mStepStopped) {
+        mStepTiming = false;
+        qint64 latency = mStepTimer.elapsed();
+        mLatencyStats.steps++;
+        mLatencyStats.lastLatency = latency;
+        mLatencyStats.maxLatency = std::max(mLatencyStats.maxLatency, latency);
+        mLatencyStats.totalLatency += latency;
+        mLatencyStats.lastRoundTrips = mStepRoundTrips;
+        if (pSettings->debugger().enableDebugConsole()
+                && pSettings->debugger().showDetailLog()) {
+            emit changeDebugConsoleLastLine(
+                        tr("Step handled in %1 ms, %2 round trips.").arg(latency).arg(mStepRoundTrips));
         }
+    }
+    if (pSettings->debugger().useGDBServer() && mInferiorRunning && !mAsyncUpdated) {
+        mAsyncUpdated = true;
+        QTimer::singleShot(50,this,&DebugReader::asyncUpdate);
+    }
+}
+
+bool DebugReader::canPipeline(const PDebugCommand &cmd) const
+{
+    // lldb-mi doesn't reliably echo tokens
+    if (mDebugger->debuggerType()==DebuggerType::LLDB_MI)
+        return false;
+    // console commands must be alone to get their output.
+    // commands changing the inferior's state are barriers.
+    if (cmd->source == DebugCommandSource::Console
+            || !cmd->command.startsWith('-')
+            || cmd->command.startsWith("-exec-")
+            || cmd->command.startsWith("-target-")
+            || cmd->command.startsWith("-gdb-"))
+        return false;
+    // gdb runs the commands in the order they are received,
+    // so the others can be sent without waiting for the previous results
+    return true;
+}
+
+void DebugReader::finishCommand(const PDebugCommand &cmd)
+{
+    QMutexLocker locker(&mCmdQueueMutex);
+    int token = mInFlightCmds.key(cmd, -1);
+    if (token<0)
         return;
+    mInFlightCmds.remove(token);
+    if (mInFlightCmds.isEmpty())
+        mExclusiveCmdRunning = false;
+    if (cmd->source!=DebugCommandSource::HeartBeat) {
+        mVisibleCmdCount--;
+        if (mVisibleCmdCount==0)
+            emit cmdFinished();
     }
+}
 
-    PDebugCommand pCmd = mCmdQueue.dequeue();
-    mCmdRunning = true;
+void DebugReader::writeCommand(const PDebugCommand& pCmd)
+{
+    int token = ++mNextToken;
+    mInFlightCmds.insert(token, pCmd);
     mCurrentCmd = pCmd;
-    if (pCmd->source!=DebugCommandSource::HeartBeat)
-        emit cmdStarted();
+    if (pCmd->source!=DebugCommandSource::HeartBeat) {
+        if (mVisibleCmdCount==0)
+            emit cmdStarted();
+        mVisibleCmdCount++;
+    }
+    if (pCmd->command.startsWith("-exec-") && pCmd->command!="-exec-interrupt") {
+        mStepTiming = true;
+        mStepStopped = false;
+        mStepRoundTrips = 0;
+        mStepTimer.start();
+    }
 
     QByteArray s;
     QByteArray params;
@@ -1434,6 +1548,7 @@ void DebugReader::runNextCmd()
     }
     s+=" "+params;
     s+= "\n";
+    s = QByteArray::number(token) + s;
     if (mProcess->write(s)<0) {
         emit writeToDebugFailed();
     }
@@ -1544,16 +1659,6 @@ QStringList DebugReader::tokenize(const QString &s)
     return result;
 }
 
-bool DebugReader::outputTerminated(const QByteArray &text)
-{
-    QStringList lines = textToLines(QString::fromUtf8(text));
-    foreach (const QString& line,lines) {
-        if (line.trimmed() == "(gdb)")
-            return true;
-    }
-    return false;
-}
-
 void DebugReader::handleBreakpoint(const GDBMIResultParser::ParseObject& breakpoint)
 {
     QString filename;
@@ -1728,9 +1833,10 @@ void DebugReader::handleUpdateVarValue(const QList<GDBMIResultParser::ParseValue
     //emit varsValueUpdated();
 }
 
-QByteArray DebugReader::removeToken(const QByteArray &line)
+QByteArray DebugReader::removeToken(const QByteArray &line, int &token)
 {
     int p=0;
+    token = -1;
     while (p<line.length()) {
         QChar ch=line[p];
         if (ch<'0' || ch>'9') {
@@ -1738,8 +1844,11 @@ QByteArray DebugReader::removeToken(const QByteArray &line)
         }
         p++;
     }
-    if (p<line.length())
+    if (p<line.length()) {
+        if (p>0)
+            token = line.left(p).toInt();
         return line.mid(p);
+    }
     return line;
 }
 
@@ -1829,19 +1938,67 @@ void DebugReader::setDebuggerPath(const QString &debuggerPath)
 
 void DebugReader::stopDebug()
 {
+    QMutexLocker locker(&mCmdQueueMutex);
     mStop = true;
+    if (mDispatcher) {
+        QMetaObject::invokeMethod(mDispatcher, [this]{
+            mProcess->terminate();
+            mProcess->kill();
+            quit();
+        }, Qt::QueuedConnection);
+    }
 }
 
 bool DebugReader::commandRunning()
 {
+    QMutexLocker locker(&mCmdQueueMutex);
     return !mCmdQueue.isEmpty();
 }
 
+DebugLatencyStats DebugReader::latencyStats()
+{
+    QMutexLocker locker(&mCmdQueueMutex);
+    return mLatencyStats;
+}
+
 void DebugReader::waitStart()
 {
     mStartSemaphore.acquire(1);
 }
 
+void DebugReader::onProcessReadyRead()
+{
+    int scanFrom = mReadBuffer.length();
+    mReadBuffer += mProcess->readAll();
+    // frame the new data into lines, a response ends with the "(gdb)" prompt
+    bool responseFinished = false;
+    int lineStart = 0;
+    int p = mReadBuffer.indexOf('\n', scanFrom);
+    while (p>=0) {
+        int lineEnd = p;
+        if (lineEnd>lineStart && mReadBuffer[lineEnd-1]=='\r')
+            lineEnd--;
+        QByteArray line = mReadBuffer.mid(lineStart, lineEnd-lineStart);
+        if (line.trimmed() == "(gdb)") {
+            responseFinished = true;
+        } else if (!line.isEmpty()) {
+            mPendingLines.append(line);
+        }
+        lineStart = p+1;
+        p = mReadBuffer.indexOf('\n', lineStart);
+    }
+    mReadBuffer.remove(0, lineStart);
+    if (!responseFinished)
+        return;
+    // handle all the responses received so far in one batch
+    QList<QByteArray> lines;
+    lines.swap(mPendingLines);
+    processDebugOutput(lines);
+    if (mStop)
+        return;
+    runNextCmd();
+}
+
 void DebugReader::run()
 {
     mStop = false;
@@ -1881,38 +2038,44 @@ void DebugReader::run()
     connect(mProcess.get(), &QProcess::errorOccurred,
                     [&](){
                         mErrorOccured= true;
+                        quit();
                     });
-    QByteArray buffer;
-    QByteArray readed;
+    connect(mProcess.get(), QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, [this](){
+                quit();
+            }, Qt::DirectConnection);
+    connect(mProcess.get(), &QProcess::readyRead,
+            mProcess.get(), [this](){
+                onProcessReadyRead();
+            });
+
+    // the queued commands are sent from the reader thread's event loop
+    QObject dispatcher;
+    {
+        QMutexLocker locker(&mCmdQueueMutex);
+        mDispatcher = &dispatcher;
+        mDispatchPending = false;
+        mInFlightCmds.clear();
+        mExclusiveCmdRunning = false;
+        mVisibleCmdCount = 0;
+    }
+    auto resetDispatcher = finally([this]{
+        QMutexLocker locker(&mCmdQueueMutex);
+        mDispatcher = nullptr;
+    });
+    mReadBuffer.clear();
+    mPendingLines.clear();
 
     mProcess->start();
     mProcess->waitForStarted(5000);
     mStartSemaphore.release(1);
-    while (true) {
-        mProcess->waitForFinished(1);
-        if (mProcess->state()!=QProcess::Running) {
-            break;
-        }
-        if (mStop) {
-            mProcess->terminate();
-            mProcess->kill();
-            break;
-        }
-        if (mErrorOccured)
-            break;
-        readed = mProcess->readAll();
-        buffer += readed;
-
-        if (readed.endsWith("\n")&& outputTerminated(buffer)) {
-            processDebugOutput(buffer);
-            buffer.clear();
-            mCmdRunning = false;
-            runNextCmd();
-        } else if (!mCmdRunning && readed.isEmpty()){
-            runNextCmd();
-        } else if (readed.isEmpty()){
-            msleep(1);
-        }
+    if (mProcess->state()==QProcess::Running && !mErrorOccured && !mStop) {
+        runNextCmd();
+        exec();
+    }
+    if (mStop) {
+        mProcess->terminate();
+        mProcess->kill();
     }
     if (mErrorOccured) {
         emit processError(mProcess->error());
@@ -18,6 +18,7 @@
 #define DEBUGGER_H
 
 #include <QAbstractTableModel>
+#include <QElapsedTimer>
 #include <QList>
 #include <QList>
 #include <QMap>
@@ -51,6 +52,16 @@ struct DebugCommand{
 };
 
 using PDebugCommand = std::shared_ptr<DebugCommand>;
+
+// time (in milliseconds) from sending a step/continue command until
+// the stop and all the refresh commands it triggers are handled
+struct DebugLatencyStats {
+    int steps;
+    qint64 lastLatency;
+    qint64 maxLatency;
+    qint64 totalLatency;
+    int lastRoundTrips; // response batches handled during the last step
+};
 struct WatchVar;
 using  PWatchVar = std::shared_ptr<WatchVar>;
 struct WatchVar {
@@ -514,6 +525,8 @@ public:
     void addBinDirs(const QStringList &binDirs);
     void addBinDir(const QString &binDir);
 
+    DebugLatencyStats latencyStats();
+
 signals:
     void parseStarted();
     void invalidateAllVars();
@@ -556,9 +569,13 @@ private:
     void clearCmdQueue();
 
     void runNextCmd();
+    void wakeUp();
+    bool canPipeline(const PDebugCommand& cmd) const;
+    void writeCommand(const PDebugCommand& cmd);
+    void finishCommand(const PDebugCommand& cmd);
+    void onProcessReadyRead();
     QStringList tokenize(const QString& s);
 
-    bool outputTerminated(const QByteArray& text);
     void handleBreakpoint(const GDBMIResultParser::ParseObject& breakpoint);
     void handleFrame(const GDBMIResultParser::ParseValue &frame);
     void handleStack(const QList<GDBMIResultParser::ParseValue> & stack);
@@ -576,9 +593,9 @@ private:
     void processExecAsyncRecord(const QByteArray& line);
     void processError(const QByteArray& errorLine);
     void processResultRecord(const QByteArray& line);
-    void processDebugOutput(const QByteArray& debugOutput);
+    void processDebugOutput(const QList<QByteArray>& lines);
     void runInferiorStoppedHook();
-    QByteArray removeToken(const QByteArray& line);
+    QByteArray removeToken(const QByteArray& line, int &token);
 private slots:
     void asyncUpdate();
 private:
@@ -594,8 +611,23 @@ private:
     bool mErrorOccured;
     bool mAsyncUpdated;
     //fOnInvalidateAllVars: TInvalidateAllVarsEvent;
-    bool mCmdRunning;
     PDebugCommand mCurrentCmd;
+    // lives in the reader thread, commands are sent through it
+    QObject* mDispatcher;
+    bool mDispatchPending;
+    // commands sent and waiting for their result records, by token.
+    // only used in the reader thread
+    QMap<int,PDebugCommand> mInFlightCmds;
+    int mNextToken;
+    bool mExclusiveCmdRunning;
+    int mVisibleCmdCount;
+    QByteArray mReadBuffer;
+    QList<QByteArray> mPendingLines;
+    QElapsedTimer mStepTimer;
+    bool mStepTiming;
+    bool mStepStopped;
+    int mStepRoundTrips;
+    DebugLatencyStats mLatencyStats;
     std::shared_ptr<QProcess> mProcess;
     QStringList mBinDirs;
     QMap<QString,QStringList> mFileCache;
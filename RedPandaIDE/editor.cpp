@@ -457,7 +457,7 @@ bool Editor::saveAs(const QString &name, bool fromProject){
     clearSyntaxIssues();
     pMainWindow->fileSystemWatcher()->removePath(mFilename);
     if (pSettings->codeCompletion().enabled() && mParser && !inProject()) {
-        mParser->invalidateFile(mFilename);
+        invalidateFile(mParser,mFilename);
     }
 
     if (pSettings->editor().autoFormatWhenSaved()) {
@@ -3153,7 +3153,7 @@ void Editor::reparse(bool resetParser)
         ParserLanguage language = calcParserLanguage();
         if (pSettings->codeCompletion().shareParser()) {
             if (language!=mParser->language()) {
-                mParser->invalidateFile(mFilename);
+                invalidateFile(mParser,mFilename);
                 mParser=sharedParser(language);
             }
         } else {
@@ -3165,7 +3165,9 @@ void Editor::reparse(bool resetParser)
             }
         }
     }
-    parseFile(mParser,mFilename, inProject());
+    // the current editor's file is parsed before other queued files
+    bool isCurrentEditor = (mParentPageControl->currentWidget()==this);
+    parseFile(mParser,mFilename, inProject(), false, true, isCurrentEditor);
 }
 
 void Editor::reparseTodo()
@@ -465,7 +465,8 @@ bool EditorList::getContentFromOpenedEditor(const QString &filename, QStringList
     Editor * e= getOpenedEditorByFilename(filename);
     if (!e)
         return false;
-    buffer = e->contents();
+    // called from parser and todo threads, the snapshot is read without locking the document
+    buffer = e->document()->snapshot()->contents();
     return true;
 }
 
@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "filesearcher.h"
+#include <QFile>
+#include <QRunnable>
+#include <QSet>
+#include <QTextCodec>
+#include <QThreadPool>
+#include <qsynedit/searcher/basicsearcher.h>
+#include <qsynedit/searcher/regexsearcher.h>
+#include <qt_utils/charsetinfo.h>
+#include "utils.h"
+
+namespace {
+class FileSearchRunnable : public QRunnable {
+public:
+    explicit FileSearchRunnable(FileSearcher* searcher, int index):
+        mSearcher(searcher),
+        mIndex(index) {
+    }
+    void run() override {
+        mSearcher->searchFile(mIndex);
+    }
+private:
+    FileSearcher* mSearcher;
+    int mIndex;
+};
+}
+
+FileSearcher::FileSearcher(const QString &keyword, QSynedit::SearchOptions options, QObject *parent):
+    QThread(parent),
+    mKeyword(keyword),
+    mOptions(options),
+    mCanceled(0),
+    mSearchedCount(0)
+{
+    // pCharsetInfoManager is not thread safe, so query it in the gui thread
+    mSystemEncoding = pCharsetInfoManager->getDefaultSystemEncoding();
+    QSet<QByteArray> encodingSet;
+    foreach (const PCharsetInfo& charset, pCharsetInfoManager->findCharsetByLocale(pCharsetInfoManager->localeName())) {
+        if (charset->name == ENCODING_UTF8 || charset->name == mSystemEncoding
+                || encodingSet.contains(charset->name))
+            continue;
+        encodingSet.insert(charset->name);
+        mLocaleEncodings.append(charset->name);
+    }
+}
+
+void FileSearcher::addFile(const QString &filename, const QByteArray &encoding)
+{
+    PFileSearchTask task = std::make_shared<FileSearchTask>();
+    task->filename = filename;
+    task->encoding = encoding;
+    task->opened = false;
+    mTasks.append(task);
+}
+
+void FileSearcher::addOpenedFile(const QString &filename, const QStringList &contents)
+{
+    PFileSearchTask task = std::make_shared<FileSearchTask>();
+    task->filename = filename;
+    task->opened = true;
+    task->contents = contents;
+    mTasks.append(task);
+}
+
+int FileSearcher::fileCount() const
+{
+    return mTasks.count();
+}
+
+void FileSearcher::cancel()
+{
+    mCanceled.storeRelease(1);
+}
+
+bool FileSearcher::isCanceled() const
+{
+    return mCanceled.loadAcquire()!=0;
+}
+
+QList<PSearchResultTreeItem> FileSearcher::takeFoundItems()
+{
+    QMutexLocker locker(&mMutex);
+    QList<PSearchResultTreeItem> items;
+    items.swap(mFoundItems);
+    return items;
+}
+
+void FileSearcher::searchFile(int index)
+{
+    auto action = finally([this]{
+        mSearchedCount.fetchAndAddRelaxed(1);
+    });
+    if (isCanceled())
+        return;
+    PFileSearchTask task = mTasks[index];
+    QString text;
+    if (!task->opened && !loadFile(task, text))
+        return;
+
+    QSynedit::PSynSearchBase searchEngine;
+    if (mOptions.testFlag(QSynedit::ssoRegExp)) {
+        searchEngine = std::make_shared<QSynedit::RegexSearcher>();
+    } else {
+        searchEngine = std::make_shared<QSynedit::BasicSearcher>();
+    }
+    searchEngine->setOptions(mOptions);
+    searchEngine->setPattern(mKeyword);
+
+    PSearchResultTreeItem parentItem = std::make_shared<SearchResultTreeItem>();
+    parentItem->filename = task->filename;
+    parentItem->parent = nullptr;
+    auto searchLine = [&](const QString& line, int lineNo) {
+        int count = searchEngine->findAll(line);
+        for (int i=0;i<count;i++) {
+            PSearchResultTreeItem item = std::make_shared<SearchResultTreeItem>();
+            item->filename = task->filename;
+            item->line = lineNo;
+            item->start = searchEngine->result(i) + 1;
+            item->len = searchEngine->length(i);
+            item->parent = parentItem.get();
+            item->text = line;
+            item->text.replace('\t',' ');
+            parentItem->results.append(item);
+        }
+    };
+    if (task->opened) {
+        for (int i=0;i<task->contents.count();i++) {
+            if ((i & 0xFF) == 0 && isCanceled())
+                return;
+            searchLine(task->contents[i], i+1);
+        }
+    } else {
+        int lineStart = 0;
+        int lineNo = 1;
+        while (lineStart < text.length()) {
+            if ((lineNo & 0xFF) == 0 && isCanceled())
+                return;
+            int lineEnd = text.indexOf('\n', lineStart);
+            if (lineEnd<0)
+                lineEnd = text.length();
+            int len = lineEnd - lineStart;
+            if (len>0 && text[lineEnd-1]=='\r')
+                len--;
+            searchLine(text.mid(lineStart, len), lineNo);
+            lineStart = lineEnd + 1;
+            lineNo++;
+        }
+    }
+    if (!parentItem->results.isEmpty()) {
+        QMutexLocker locker(&mMutex);
+        mFoundItems.append(parentItem);
+    }
+}
+
+bool FileSearcher::loadFile(const PFileSearchTask &task, QString &text) const
+{
+    QFile file(task->filename);
+    if (!file.open(QFile::ReadOnly))
+        return false;
+    qint64 size = file.size();
+    if (size<=0)
+        return false;
+    // map the file instead of reading it, the content is only needed while decoding
+    uchar* data = file.map(0, size);
+    auto action = finally([&file,data]{
+        if (data)
+            file.unmap(data);
+    });
+    QByteArray content;
+    if (data)
+        content = QByteArray::fromRawData((const char*)data, size);
+    else
+        content = file.readAll();
+
+    QTextCodec* codec = QTextCodec::codecForUtfText(content, nullptr);
+    if (codec) {
+        text = codec->toUnicode(content);
+        return true;
+    }
+    if (isBinaryContent(content))
+        return false;
+    if (isTextAllAscii(content)) {
+        text = QString::fromLatin1(content);
+        return true;
+    }
+    QList<QByteArray> encodings;
+    if (task->encoding == ENCODING_AUTO_DETECT) {
+        encodings.append(ENCODING_UTF8);
+        encodings.append(mSystemEncoding);
+        encodings.append(mLocaleEncodings);
+    } else if (task->encoding == ENCODING_SYSTEM_DEFAULT) {
+        encodings.append(mSystemEncoding);
+    } else if (task->encoding == ENCODING_UTF8_BOM || task->encoding == ENCODING_ASCII) {
+        encodings.append(ENCODING_UTF8);
+    } else if (task->encoding == ENCODING_UTF16_BOM) {
+        encodings.append(ENCODING_UTF16);
+    } else if (task->encoding == ENCODING_UTF32_BOM) {
+        encodings.append(ENCODING_UTF32);
+    } else {
+        encodings.append(task->encoding);
+    }
+    foreach (const QByteArray& encoding, encodings) {
+        codec = QTextCodec::codecForName(encoding);
+        if (!codec)
+            continue;
+        QTextCodec::ConverterState state;
+        text = codec->toUnicode(content.constData(), content.length(), &state);
+        if (state.invalidChars == 0)
+            return true;
+    }
+    // nothing fits, use the system encoding like the editor does
+    codec = QTextCodec::codecForName(encodings.count()==1?encodings.front():mSystemEncoding);
+    if (!codec)
+        return false;
+    text = codec->toUnicode(content);
+    return true;
+}
+
+void FileSearcher::run()
+{
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1,QThread::idealThreadCount()));
+    for (int i=0;i<mTasks.count();i++) {
+        pool.start(new FileSearchRunnable(this, i));
+    }
+    while (!pool.waitForDone(100)) {
+        if (isCanceled()) {
+            // drop the files not started yet
+            pool.clear();
+        }
+        emit searchProgress(mSearchedCount.loadAcquire(), mTasks.count());
+    }
+    emit searchProgress(mSearchedCount.loadAcquire(), mTasks.count());
+}
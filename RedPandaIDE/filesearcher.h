@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef FILESEARCHER_H
+#define FILESEARCHER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QAtomicInt>
+#include "widgets/searchresultview.h"
+
+struct FileSearchTask {
+    QString filename;
+    QByteArray encoding;
+    bool opened; // contents are taken from an opened editor
+    QStringList contents;
+};
+
+using PFileSearchTask = std::shared_ptr<FileSearchTask>;
+
+/*
+ * Searches a list of files in a thread pool, without creating editors for them.
+ * Files opened in editors must be added with their contents, because the
+ * editors can't be used outside the gui thread.
+ */
+class FileSearcher : public QThread
+{
+    Q_OBJECT
+public:
+    explicit FileSearcher(const QString& keyword, QSynedit::SearchOptions options, QObject* parent = nullptr);
+    void addFile(const QString& filename, const QByteArray& encoding);
+    void addOpenedFile(const QString& filename, const QStringList& contents);
+    int fileCount() const;
+    void cancel();
+    bool isCanceled() const;
+    // results of the files searched since the last call
+    QList<PSearchResultTreeItem> takeFoundItems();
+    void searchFile(int index);
+signals:
+    void searchProgress(int searchedCount, int fileCount);
+private:
+    bool loadFile(const PFileSearchTask& task, QString& text) const;
+private:
+    QString mKeyword;
+    QSynedit::SearchOptions mOptions;
+    QList<PFileSearchTask> mTasks;
+    QByteArray mSystemEncoding;
+    QList<QByteArray> mLocaleEncodings;
+    QAtomicInt mCanceled;
+    QAtomicInt mSearchedCount;
+    QMutex mMutex;
+    QList<PSearchResultTreeItem> mFoundItems;
+
+    // QThread interface
+protected:
+    void run() override;
+};
+
+#endif // FILESEARCHER_H
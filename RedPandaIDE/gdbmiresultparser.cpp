@@ -19,6 +19,7 @@
 #include <QFileInfo>
 #include <QList>
 #include <QDebug>
+#include <cstring>
 
 GDBMIResultParser::GDBMIResultParser()
 {
@@ -42,10 +43,12 @@ GDBMIResultParser::GDBMIResultParser()
 
 bool GDBMIResultParser::parse(const QByteArray &record, const QString& command, GDBMIResultType &type, ParseObject& multiValues)
 {
-    const char* p = record.data();
-    bool result = parseMultiValues(p,multiValues);
+    std::shared_ptr<ParseArena> arena = std::make_shared<ParseArena>();
+    arena->record = record;
+    bool result = parseMultiValues(*arena, arena->record.constData());
     if (!result)
         return false;
+    multiValues = ParseObject(arena, 0);
 //    if (*p!=0)
 //        return false;
     if (!mResultTypes.contains(command))
@@ -56,7 +59,9 @@ bool GDBMIResultParser::parse(const QByteArray &record, const QString& command,
 
 bool GDBMIResultParser::parseAsyncResult(const QByteArray &record, QByteArray &result, ParseObject &multiValue)
 {
-    const char* p =record.data();
+    std::shared_ptr<ParseArena> arena = std::make_shared<ParseArena>();
+    arena->record = record;
+    const char* p =arena->record.constData();
     if (*p!='*')
         return false;
     p++;
@@ -64,35 +69,40 @@ bool GDBMIResultParser::parseAsyncResult(const QByteArray &record, QByteArray &r
     while (*p && *p!=',')
         p++;
     result = QByteArray(start,p-start);
-    if (*p==0)
-        return true;
-    p++;
-    return parseMultiValues(p,multiValue);
+    if (*p!=0)
+        p++;
+    if (!parseMultiValues(*arena, p))
+        return false;
+    multiValue = ParseObject(arena, 0);
+    return true;
 }
 
-bool GDBMIResultParser::parseMultiValues(const char* p, ParseObject &multiValue)
+bool GDBMIResultParser::parseMultiValues(ParseArena& arena, const char* p)
 {
-    while (*p) {
-        QByteArray propName;
-        ParseValue propValue;
-        bool result = parseNameAndValue(p,propName,propValue);
-        if (result) {
-            multiValue[propName]=propValue;
-        } else {
-            return false;
-        }
-        skipSpaces(p);
-        if (*p==0)
-            break;
-        if (*p!=',')
-            return false;
-        p++; //skip ','
-        skipSpaces(p);
-    }
-    return true;
+    // a rough guess, to avoid growing the node list too many times
+    arena.nodes.reserve(arena.record.length()/16+1);
+    int root = newNode(arena);
+    arena.nodes[root].type = ParseValueType::Object;
+    return parseChildren(arena, p, root, 0);
+}
+
+int GDBMIResultParser::newNode(ParseArena &arena)
+{
+    ParseNode node;
+    node.type = ParseValueType::NotAssigned;
+    node.nameStart = 0;
+    node.nameLength = 0;
+    node.start = 0;
+    node.length = 0;
+    node.escaped = false;
+    node.firstChild = -1;
+    node.childCount = 0;
+    node.nextSibling = -1;
+    arena.nodes.append(node);
+    return arena.nodes.count()-1;
 }
 
-bool GDBMIResultParser::parseNameAndValue(const char *&p, QByteArray &name, ParseValue &value)
+bool GDBMIResultParser::parseNameAndValue(ParseArena& arena, const char *&p, int &index)
 {
     skipSpaces(p);
     const char* nameStart =p;
@@ -101,56 +111,118 @@ bool GDBMIResultParser::parseNameAndValue(const char *&p, QByteArray &name, Pars
     }
     if (*p==0)
         return false;
-    name = QByteArray(nameStart,p-nameStart);
+    int nameLength = p-nameStart;
     skipSpaces(p);
     if (*p!='=')
         return false;
     p++;
-    return parseValue(p,value);
+    if (!parseValue(arena, p, index))
+        return false;
+    arena.nodes[index].nameStart = nameStart - arena.record.constData();
+    arena.nodes[index].nameLength = nameLength;
+    return true;
 }
 
-bool GDBMIResultParser::parseValue(const char *&p, ParseValue &value)
+bool GDBMIResultParser::parseValue(ParseArena& arena, const char *&p, int &index)
 {
     skipSpaces(p);
-    bool result;
     switch (*p) {
-    case '{': {
-        ParseObject obj;
-        result = parseObject(p,obj);
-        value = obj;
+    case '{':
+        index = newNode(arena);
+        arena.nodes[index].type = ParseValueType::Object;
+        p++;
+        if (!parseChildren(arena, p, index, '}'))
+            return false;
+        p++; //skip '}'
         break;
-    }
-    case '[': {
-        QList<ParseValue> array;
-        result = parseArray(p,array);
-        value = array;
+    case '[':
+        index = newNode(arena);
+        arena.nodes[index].type = ParseValueType::Array;
+        p++;
+        if (!parseChildren(arena, p, index, ']'))
+            return false;
+        p++; //skip ']'
         break;
-    }
-    case '"': {
-        QByteArray s;
-        result = parseStringValue(p,s);
-        value = s;
+    case '"':
+        index = newNode(arena);
+        arena.nodes[index].type = ParseValueType::Value;
+        if (!parseStringValue(arena, p, index))
+            return false;
         break;
-    }
     default:
         return false;
     }
-    if (!result)
-        return false;
     skipSpaces(p);
     return true;
 }
 
-bool GDBMIResultParser::parseStringValue(const char *&p, QByteArray& stringValue)
+bool GDBMIResultParser::parseStringValue(ParseArena& arena, const char *&p, int index)
 {
     if (*p!='"')
         return false;
     p++;
-    stringValue.clear();
-    while (*p!=0) {
-        if (*p == '"') {
+    const char* start = p;
+    bool escaped = false;
+    // only find the end here, escapes are decoded when the value is used
+    while (*p!=0 && *p!='"') {
+        if (*p=='\\' && *(p+1)!=0) {
+            escaped = true;
+            p+=2;
+        } else {
+            p++;
+        }
+    }
+    if (*p!='"')
+        return false;
+    ParseNode& node = arena.nodes[index];
+    node.start = start - arena.record.constData();
+    node.length = p - start;
+    node.escaped = escaped;
+    p++; //skip '"'
+    return true;
+}
+
+bool GDBMIResultParser::parseChildren(ParseArena& arena, const char *&p, int index, char closeChar)
+{
+    int lastChild = -1;
+    skipSpaces(p);
+    while (*p!=closeChar) {
+        if (*p==0)
+            return false;
+        int child;
+        bool result;
+        if (closeChar==']' && (*p=='{' || *p=='"' || *p=='[')) {
+            result = parseValue(arena, p, child);
+        } else {
+            // names of array elements are dropped
+            result = parseNameAndValue(arena, p, child);
+        }
+        if (!result)
+            return false;
+        if (lastChild<0)
+            arena.nodes[index].firstChild = child;
+        else
+            arena.nodes[lastChild].nextSibling = child;
+        arena.nodes[index].childCount++;
+        lastChild = child;
+        skipSpaces(p);
+        if (*p==closeChar)
             break;
-        } else if (*p=='\\' && *(p+1)!=0) {
+        if (*p!=',')
+            return false;
+        p++; //skip ','
+        skipSpaces(p);
+    }
+    return true;
+}
+
+QByteArray GDBMIResultParser::decodeString(const char *p, int length)
+{
+    QByteArray stringValue;
+    stringValue.reserve(length);
+    const char* end = p + length;
+    while (p<end) {
+        if (*p=='\\' && p+1<end) {
             p++;
             switch (*p) {
             case '\'':
@@ -207,7 +279,7 @@ bool GDBMIResultParser::parseStringValue(const char *&p, QByteArray& stringValue
             case '7':
             {
                 int i=0;
-                for (i=0;i<3;i++) {
+                for (i=0;i<3 && p+i<end;i++) {
                     if (*(p+i)<'0' || *(p+i)>'7')
                         break;
                 }
@@ -218,92 +290,18 @@ bool GDBMIResultParser::parseStringValue(const char *&p, QByteArray& stringValue
                 p+=i;
                 break;
             }
+            default:
+                // keep the escaped char, like before
+                stringValue+=*p;
+                p++;
+                break;
             }
         } else {
             stringValue+=*p;
             p++;
         }
     }
-    if (*p=='"') {
-        p++; //skip '"'
-        return true;
-    }
-    return false;
-}
-
-bool GDBMIResultParser::parseObject(const char *&p, ParseObject &obj)
-{
-    if (*p!='{')
-        return false;
-    p++;
-
-    if (*p!='}') {
-        while (*p!=0) {
-            QByteArray propName;
-            ParseValue propValue;
-            bool result = parseNameAndValue(p,propName,propValue);
-            if (result) {
-                obj[propName]=propValue;
-            } else {
-                return false;
-            }
-            skipSpaces(p);
-            if (*p=='}')
-                break;
-            if (*p!=',') {
-                return false;
-            }
-            p++; //skip ','
-            skipSpaces(p);
-        }
-    }
-    if (*p=='}') {
-        p++; //skip '}'
-        return true;
-    }
-    return false;
-}
-
-bool GDBMIResultParser::parseArray(const char *&p, QList<GDBMIResultParser::ParseValue> &array)
-{
-    if (*p!='[')
-        return false;
-    p++;
-    if (*p!=']') {
-        while (*p!=0) {
-            skipSpaces(p);
-            if (*p=='{' || *p=='"' || *p=='[') {
-                ParseValue val;
-                bool result = parseValue(p,val);
-                if (result) {
-                    array.append(val);
-                } else {
-                    return false;
-                }
-            } else {
-                QByteArray name;
-                ParseValue val;
-                bool result = parseNameAndValue(p,name,val);
-                if (result) {
-                    array.append(val);
-                } else {
-                    return false;
-                }
-            }
-            skipSpaces(p);            
-            if (*p==']')
-                break;
-            if (*p!=',')
-                return false;
-            p++; //skip ','
-            skipSpaces(p);
-        }
-    }
-    if (*p==']') {
-        p++; //skip ']'
-        return true;
-    }
-    return false;
+    return stringValue;
 }
 
 bool GDBMIResultParser::isNameChar(char ch)
@@ -335,26 +333,58 @@ void GDBMIResultParser::skipSpaces(const char *&p)
         p++;
 }
 
-const QByteArray &GDBMIResultParser::ParseValue::value() const
+const GDBMIResultParser::ParseNode &GDBMIResultParser::ParseValue::node() const
 {
-    return mValue;
+    return mArena->nodes[mIndex];
 }
 
-const QList<::GDBMIResultParser::ParseValue> &GDBMIResultParser::ParseValue::array() const
+QByteArray GDBMIResultParser::ParseValue::rawValue() const
 {
-    return mArray;
+    //the result is only valid while the arena is alive
+    if (type()!=ParseValueType::Value)
+        return QByteArray();
+    const ParseNode& n = node();
+    if (n.escaped)
+        return value();
+    return QByteArray::fromRawData(mArena->record.constData()+n.start, n.length);
 }
 
-const GDBMIResultParser::ParseObject &GDBMIResultParser::ParseValue::object() const
+QByteArray GDBMIResultParser::ParseValue::value() const
 {
-    return mObject;
+    if (type()!=ParseValueType::Value)
+        return QByteArray();
+    const ParseNode& n = node();
+    const char* p = mArena->record.constData()+n.start;
+    if (n.escaped)
+        return decodeString(p, n.length);
+    return QByteArray(p, n.length);
+}
+
+QList<GDBMIResultParser::ParseValue> GDBMIResultParser::ParseValue::array() const
+{
+    QList<ParseValue> result;
+    if (type()!=ParseValueType::Array)
+        return result;
+    const ParseNode& n = node();
+    result.reserve(n.childCount);
+    for (int child = n.firstChild; child>=0; child = mArena->nodes[child].nextSibling) {
+        result.append(ParseValue(mArena, child));
+    }
+    return result;
+}
+
+GDBMIResultParser::ParseObject GDBMIResultParser::ParseValue::object() const
+{
+    if (type()!=ParseValueType::Object)
+        return ParseObject();
+    return ParseObject(mArena, mIndex);
 }
 
 qlonglong GDBMIResultParser::ParseValue::intValue(int defaultValue) const
 {
     //Q_ASSERT(mType == ParseValueType::Value);
     bool ok;
-    qlonglong value = QString(mValue).toLongLong(&ok);
+    qlonglong value = rawValue().toLongLong(&ok);
     if (ok)
         return value;
     else
@@ -364,14 +394,14 @@ qlonglong GDBMIResultParser::ParseValue::intValue(int defaultValue) const
 qulonglong GDBMIResultParser::ParseValue::hexValue(bool &ok) const
 {
     //Q_ASSERT(mType == ParseValueType::Value);
-    qulonglong value = QString(mValue).toULongLong(&ok,16);
+    qulonglong value = rawValue().toULongLong(&ok,16);
     return value;
 }
 
 QString GDBMIResultParser::ParseValue::pathValue() const
 {
     //Q_ASSERT(mType == ParseValueType::Value);
-    QByteArray value=mValue;
+    QByteArray value=this->value();
 #ifdef Q_OS_WIN
     if (value.startsWith("/") && !value.startsWith("//"))
         value=value.mid(1);
@@ -381,7 +411,7 @@ QString GDBMIResultParser::ParseValue::pathValue() const
 
 QString GDBMIResultParser::ParseValue::utf8PathValue() const
 {
-    QByteArray value=mValue;
+    QByteArray value=this->value();
 #ifdef Q_OS_WIN
     if (value.startsWith("/") && !value.startsWith("//"))
         value=value.mid(1);
@@ -391,108 +421,57 @@ QString GDBMIResultParser::ParseValue::utf8PathValue() const
 
 GDBMIResultParser::ParseValueType GDBMIResultParser::ParseValue::type() const
 {
-    return mType;
+    if (!mArena)
+        return ParseValueType::NotAssigned;
+    return node().type;
 }
 
 bool GDBMIResultParser::ParseValue::isValid() const
 {
-    return mType!=ParseValueType::NotAssigned;
+    return type()!=ParseValueType::NotAssigned;
 }
 
 GDBMIResultParser::ParseValue::ParseValue():
-    mType(ParseValueType::NotAssigned) {
-
-}
-
-GDBMIResultParser::ParseValue::ParseValue(const QByteArray &value):
-    mValue(value),
-    mType(ParseValueType::Value)
-{
-}
-
-GDBMIResultParser::ParseValue::ParseValue(const ParseObject &object):
-    mObject(object),
-    mType(ParseValueType::Object)
-{
-}
-
-GDBMIResultParser::ParseValue::ParseValue(const QList<ParseValue> &array):
-    mArray(array),
-    mType(ParseValueType::Array)
-{
-}
-
-GDBMIResultParser::ParseValue::ParseValue(const ParseValue &value):
-    mValue(value.mValue),
-    mArray(value.mArray),
-    mObject(value.mObject),
-    mType(value.mType)
+    mIndex(-1)
 {
 }
 
-GDBMIResultParser::ParseValue &GDBMIResultParser::ParseValue::operator=(const GDBMIResultParser::ParseValue &value)
+GDBMIResultParser::ParseValue::ParseValue(const PParseArena &arena, int index):
+    mArena(arena),
+    mIndex(index)
 {
-    mType = value.mType;
-    mValue = value.mValue;
-    mArray = value.mArray;
-    mObject = value.mObject;
-    return *this;
 }
 
-GDBMIResultParser::ParseValue &GDBMIResultParser::ParseValue::operator=(const QByteArray &value)
+GDBMIResultParser::ParseObject::ParseObject():
+    mIndex(-1)
 {
-    Q_ASSERT(mType == ParseValueType::NotAssigned);
-    mType = ParseValueType::Value;
-    mValue = value;
-    return *this;
 }
 
-GDBMIResultParser::ParseValue &GDBMIResultParser::ParseValue::operator=(const ParseObject& object)
+GDBMIResultParser::ParseObject::ParseObject(const PParseArena &arena, int index):
+    mArena(arena),
+    mIndex(index)
 {
-    Q_ASSERT(mType == ParseValueType::NotAssigned);
-    mType = ParseValueType::Object;
-    mObject = object;
-    return *this;
-}
-
-GDBMIResultParser::ParseValue &GDBMIResultParser::ParseValue::operator=(const QList<ParseValue>& array)
-{
-    Q_ASSERT(mType == ParseValueType::NotAssigned);
-    mType = ParseValueType::Array;
-    mArray = array;
-    return *this;
-}
-
-
-GDBMIResultParser::ParseObject::ParseObject()
-{
-
-}
-
-GDBMIResultParser::ParseObject::ParseObject(const ParseObject &object):
-    mProps(object.mProps)
-{
-
 }
 
 GDBMIResultParser::ParseValue GDBMIResultParser::ParseObject::operator[](const QByteArray &name) const
 {
-    if (mProps.contains(name)) {
-        ParseValue value(mProps[name]);
-        return value;
+    if (!mArena)
+        return ParseValue();
+    const char* record = mArena->record.constData();
+    int found = -1;
+    // objects are small, a linear search is enough. the last one wins, like before
+    for (int child = mArena->nodes[mIndex].firstChild; child>=0; child = mArena->nodes[child].nextSibling) {
+        const ParseNode& node = mArena->nodes[child];
+        if (node.nameLength == name.length()
+                && memcmp(record+node.nameStart, name.constData(), node.nameLength)==0)
+            found = child;
     }
-    return ParseValue();
+    if (found<0)
+        return ParseValue();
+    return ParseValue(mArena, found);
 }
 
-GDBMIResultParser::ParseObject &GDBMIResultParser::ParseObject::operator=(const ParseObject &object)
+bool GDBMIResultParser::ParseObject::isValid() const
 {
-    mProps = object.mProps;
-    return *this;
-}
-
-GDBMIResultParser::ParseValue &GDBMIResultParser::ParseObject::operator[](const QByteArray &name) {
-    if (!mProps.contains(name))
-        mProps[name]=ParseValue();
-    return mProps[name];
+    return mArena!=nullptr;
 }
-
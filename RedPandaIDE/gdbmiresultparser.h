@@ -20,6 +20,7 @@
 #include <QByteArray>
 #include <QHash>
 #include <QList>
+#include <QVector>
 #include <memory>
 
 
@@ -51,29 +52,51 @@ public:
         NotAssigned
     };
 
+    /*
+     * A parsed record is stored as a flat list of nodes in an arena.
+     * String values are kept as offsets into the original record and
+     * their escapes are only decoded when the value is read.
+     */
+    struct ParseNode {
+        ParseValueType type;
+        int nameStart;
+        int nameLength;
+        int start; // contents of a string value, without the quotes
+        int length;
+        bool escaped; // the string value contains escape sequences
+        int firstChild;
+        int childCount;
+        int nextSibling;
+    };
+
+    struct ParseArena {
+        QByteArray record;
+        QVector<ParseNode> nodes;
+    };
+
+    using PParseArena = std::shared_ptr<const ParseArena>;
+
     class ParseValue;
 
+    // Light views on the nodes of an arena, cheap to copy.
     class ParseObject {
     public:
         explicit ParseObject();
-        ParseObject(const ParseObject& object);
+        explicit ParseObject(const PParseArena& arena, int index);
         ParseValue operator[](const QByteArray& name) const;
-        ParseValue& operator[](const QByteArray& name);
-        ParseObject& operator=(const ParseObject& object);
+        bool isValid() const;
     private:
-        QHash<QByteArray, ParseValue> mProps;
+        PParseArena mArena;
+        int mIndex;
     };
 
     class ParseValue {
     public:
         explicit ParseValue();
-        explicit ParseValue(const QByteArray& value);
-        explicit ParseValue(const ParseObject &object);
-        explicit ParseValue(const QList<ParseValue>& array);
-        ParseValue(const ParseValue& value);
-        const QByteArray &value() const;
-        const QList<ParseValue> &array() const;
-        const ParseObject &object() const;
+        explicit ParseValue(const PParseArena& arena, int index);
+        QByteArray value() const;
+        QList<ParseValue> array() const;
+        ParseObject object() const;
         qlonglong intValue(int defaultValue=-1) const;
         qulonglong hexValue(bool &ok) const;
 
@@ -81,33 +104,30 @@ public:
         QString utf8PathValue() const;
         ParseValueType type() const;
         bool isValid() const;
-        ParseValue& operator=(const QByteArray& value);
-        ParseValue& operator=(const ParseObject& object);
-        ParseValue& operator=(const QList<ParseValue>& array);
-        ParseValue& operator=(const ParseValue& value);
     private:
-        QByteArray mValue;
-        QList<ParseValue> mArray;
-        ParseObject mObject;
-        ParseValueType mType;
+        const ParseNode& node() const;
+        QByteArray rawValue() const;
+    private:
+        PParseArena mArena;
+        int mIndex;
     };
 
-    using PParseValue = std::shared_ptr<ParseValue>;
-
 public:
     GDBMIResultParser();
     bool parse(const QByteArray& record, const QString& command, GDBMIResultType& type, ParseObject& multiValues);
     bool parseAsyncResult(const QByteArray& record, QByteArray& result, ParseObject& multiValue);
 private:
-    bool parseMultiValues(const char*p, ParseObject& multiValue);
-    bool parseNameAndValue(const char *&p,QByteArray& name, ParseValue& value);
-    bool parseValue(const char* &p, ParseValue& value);
-    bool parseStringValue(const char*&p, QByteArray& stringValue);
-    bool parseObject(const char*&p, ParseObject& obj);
-    bool parseArray(const char*&p, QList<ParseValue>& array);
+    bool parseMultiValues(ParseArena& arena, const char*p);
+    bool parseNameAndValue(ParseArena& arena, const char *&p, int& index);
+    bool parseValue(ParseArena& arena, const char* &p, int& index);
+    bool parseStringValue(ParseArena& arena, const char*&p, int index);
+    bool parseChildren(ParseArena& arena, const char*&p, int index, char closeChar);
+    int newNode(ParseArena& arena);
     void skipSpaces(const char* &p);
     bool isNameChar(char ch);
     bool isSpaceChar(char ch);
+public:
+    static QByteArray decodeString(const char* p, int length);
 private:
     QHash<QString, GDBMIResultType> mResultTypes;
 };
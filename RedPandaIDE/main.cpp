@@ -37,6 +37,7 @@
 #include "editorlist.h"
 #include "widgets/choosethemedialog.h"
 #include "thememanager.h"
+#include "compiler/compilerprobecache.h"
 
 #ifdef Q_OS_WIN
 #include <QTemporaryFile>
@@ -335,6 +336,8 @@ int main(int argc, char *argv[])
     }
     qRegisterMetaType<PCompileIssue>("PCompileIssue");
     qRegisterMetaType<PCompileIssue>("PCompileIssue&");
+    qRegisterMetaType<QList<PCompileIssue>>("QList<PCompileIssue>");
+    qRegisterMetaType<QList<PTodoItem>>("QList<PTodoItem>");
     qRegisterMetaType<QVector<int>>("QVector<int>");
     qRegisterMetaType<QHash<int,QString>>("QHash<int,QString>");
 
@@ -439,6 +442,7 @@ int main(int argc, char *argv[])
         }
 
         int retCode = app.exec();
+        CompilerProbeCache::getInstance()->flush();
         if (mainWindow.shouldRemoveAllSettings()) {
             QString configDir = pSettings->dirs().config();
             settings.release();
@@ -5205,19 +5205,21 @@ void MainWindow::stopDebugForNoSymbolTable()
     }
 }
 
-void MainWindow::onTodoParsingFile(const QString& filename)
-{
-    mTodoModel.removeTodosForFile(filename);
-}
-
 void MainWindow::onTodoParseStarted()
 {
     mTodoModel.clear();
 }
 
-void MainWindow::onTodoFound(const QString& filename, int lineNo, int ch, const QString& line)
+void MainWindow::onTodosFound(const QStringList& files, const QList<PTodoItem>& items)
 {
-    mTodoModel.addItem(filename,lineNo,ch,line);
+    // items of the same file are adjacent and sorted by line
+    int pos = 0;
+    foreach (const QString& filename, files) {
+        int start = pos;
+        while (pos<items.count() && items[pos]->filename == filename)
+            pos++;
+        mTodoModel.setTodosForFile(filename, items.mid(start, pos-start));
+    }
 }
 
 void MainWindow::onTodoParseFinished()
@@ -5783,30 +5785,42 @@ void MainWindow::logToolsOutput(const QString& msg)
     ui->txtToolsOutput->ensureCursorVisible();
 }
 
-void MainWindow::onCompileIssue(PCompileIssue issue)
+void MainWindow::onCompileIssues(const QList<PCompileIssue>& issues)
 {
-    if (issue->filename.isEmpty())
-        return;
-    if (issue->filename.contains("*"))
-        return;
-    ui->tableIssues->addIssue(issue);
+    QList<PCompileIssue> shownIssues;
+    shownIssues.reserve(issues.count());
+    foreach (const PCompileIssue& issue, issues) {
+        if (issue->filename.isEmpty())
+            continue;
+        if (issue->filename.contains("*"))
+            continue;
+        shownIssues.append(issue);
+    }
+    ui->tableIssues->addIssues(shownIssues);
 
     // Update tab caption
 //    if CompilerOutput.Items.Count = 1 then
 //      CompSheet.Caption := Lang[ID_SHEET_COMP] + ' (' + IntToStr(CompilerOutput.Items.Count) + ')';
 
-    if (issue->type == CompileIssueType::Error || issue->type ==
-            CompileIssueType::Warning) {
-        Editor* e = mEditorList->getOpenedEditorByFilename(issue->filename);
-        if (e!=nullptr && (issue->line>0)) {
-            int line = issue->line;
-            if (line > e->document()->count())
-                return;
-            int col = std::min(issue->column,e->document()->getLine(line-1).length()+1);
-            if (col < 1)
-                col = e->document()->getLine(line-1).length()+1;
-            e->addSyntaxIssues(line,col,issue->endColumn,issue->type,issue->description);
-        }
+    Editor* e = nullptr;
+    foreach (const PCompileIssue& issue, shownIssues) {
+        if (issue->type != CompileIssueType::Error && issue->type !=
+                CompileIssueType::Warning)
+            continue;
+        if (issue->line<=0)
+            continue;
+        // issues of the same file usually come together
+        if (!e || e->filename()!=issue->filename)
+            e = mEditorList->getOpenedEditorByFilename(issue->filename);
+        if (e==nullptr)
+            continue;
+        int line = issue->line;
+        if (line > e->document()->count())
+            continue;
+        int col = std::min(issue->column,e->document()->getLine(line-1).length()+1);
+        if (col < 1)
+            col = e->document()->getLine(line-1).length()+1;
+        e->addSyntaxIssues(line,col,issue->endColumn,issue->type,issue->description);
     }
 }
 
@@ -6059,6 +6073,9 @@ void MainWindow::onOJProblemCaseStarted(const QString& id,int current, int total
         mOJProblemModel.update(row);
         QModelIndex idx = ui->tblProblemCases->currentIndex();
         if (!idx.isValid() || row != idx.row()) {
+            //cases may run in parallel, don't leave a case that is still testing
+            if (idx.isValid() && mOJProblemModel.getCase(idx.row())->testState == ProblemCaseTestState::Testing)
+                return;
             ui->tblProblemCases->setCurrentIndex(mOJProblemModel.index(row,0));
         }
         ui->txtProblemCaseOutput->clearAll();
@@ -6078,20 +6095,25 @@ void MainWindow::onOJProblemCaseFinished(const QString& id, int current, int tot
                     ProblemCaseTestState::Passed:
                     ProblemCaseTestState::Failed;
         mOJProblemModel.update(row);
-        updateProblemCaseOutput(problemCase);
+        if (isCurrentProblemCase(id))
+            updateProblemCaseOutput(problemCase);
     }
     ui->pbProblemCases->setMaximum(total);
     ui->pbProblemCases->setValue(current);
     updateProblemTitle();
 }
 
-void MainWindow::onOJProblemCaseNewOutputGetted(const QString &/* id */, const QString &line)
+void MainWindow::onOJProblemCaseNewOutputGetted(const QString &id, const QString &line)
 {
+    if (!isCurrentProblemCase(id))
+        return;
     ui->txtProblemCaseOutput->appendPlainText(line);
 }
 
-void MainWindow::onOJProblemCaseResetOutput(const QString &/* id */, const QString &line)
+void MainWindow::onOJProblemCaseResetOutput(const QString &id, const QString &line)
 {
+    if (!isCurrentProblemCase(id))
+        return;
     ui->txtProblemCaseOutput->clearAll();
     ui->txtProblemCaseOutput->setPlainText(line);
 }
@@ -6504,22 +6526,29 @@ void MainWindow::onEndParsing(int total, int)
     double parseTime = mParserTimer.elapsed() / 1000.0;
     double parsingFrequency;
 
-
+    QString message;
     if (total > 1) {
         if (parseTime>0) {
             parsingFrequency = total / parseTime;
         } else {
             parsingFrequency = 999;
         }
-        updateStatusbarMessage(tr("Done parsing %1 files in %2 seconds")
+        message = tr("Done parsing %1 files in %2 seconds")
                                   .arg(total).arg(parseTime)
                                   + " "
                                   + tr("(%1 files per second)")
-                                  .arg(parsingFrequency));
+                                  .arg(parsingFrequency);
     } else {
-        updateStatusbarMessage(tr("Done parsing %1 files in %2 seconds")
-                                  .arg(total).arg(parseTime));
+        message = tr("Done parsing %1 files in %2 seconds")
+                                  .arg(total).arg(parseTime);
+    }
+    SymbolLayerStatistics statistics = CppParser::symbolLayerStatistics();
+    if (statistics.layerCount>0) {
+        message += " " + tr("(system header symbols: %1 MB, shared by %2 parsers)")
+                .arg(statistics.memoryUsage / 1024.0 / 1024.0, 0, 'f', 1)
+                .arg(statistics.parserCount);
     }
+    updateStatusbarMessage(message);
 }
 
 void MainWindow::onEvalValueReady(const QString& value)
@@ -7714,10 +7743,11 @@ void MainWindow::onProjectUnitAdded(const QString &filename)
 
 void MainWindow::onProjectUnitRemoved(const QString &filename)
 {
-    mProject->cppParser()->invalidateFile(filename);
+    invalidateFile(mProject->cppParser(),filename);
     mProject->cppParser()->removeProjectFile(filename);
     if (pSettings->editor().parseTodos()) {
         mTodoModel.removeTodosForFile(filename);
+        mTodoParser->removeFile(filename);
     }
     mDebugger->breakpointModel()->removeBreakpointsInFile(filename,true);
     mBookmarkModel->removeBookmarks(filename,true);
@@ -7725,12 +7755,13 @@ void MainWindow::onProjectUnitRemoved(const QString &filename)
 
 void MainWindow::onProjectUnitRenamed(const QString &oldFilename, const QString &newFilename)
 {
-    mProject->cppParser()->invalidateFile(oldFilename);
+    invalidateFile(mProject->cppParser(),oldFilename);
     mProject->cppParser()->removeProjectFile(oldFilename);
     mProject->cppParser()->addProjectFile(newFilename,true);
     parseFileList(mProject->cppParser());
     if (pSettings->editor().parseTodos()) {
         mTodoModel.removeTodosForFile(oldFilename);
+        mTodoParser->removeFile(oldFilename);
         mTodoParser->parseFile(newFilename,true);
     }
     mBookmarkModel->renameBookmarkFile(oldFilename,newFilename,true);
@@ -8128,6 +8159,15 @@ void MainWindow::doGenerateAssembly()
     compile(false,CppCompileType::GenerateAssemblyOnly);
 }
 
+bool MainWindow::isCurrentProblemCase(const QString &id)
+{
+    QModelIndex idx = ui->tblProblemCases->currentIndex();
+    if (!idx.isValid())
+        return false;
+    POJProblemCase problemCase = mOJProblemModel.getCase(idx.row());
+    return problemCase && problemCase->getId() == id;
+}
+
 void MainWindow::updateProblemCaseOutput(POJProblemCase problemCase)
 {
     if (problemCase->testState == ProblemCaseTestState::Failed) {
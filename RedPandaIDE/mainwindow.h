@@ -236,7 +236,7 @@ public:
 
 public slots:
     void logToolsOutput(const QString& msg);
-    void onCompileIssue(PCompileIssue issue);
+    void onCompileIssues(const QList<PCompileIssue>& issues);
     void clearToolsOutput();
     void clearTodos();
     void onCompileStarted();
@@ -268,9 +268,8 @@ public slots:
     void disableDebugActions();
     void enableDebugActions();
     void stopDebugForNoSymbolTable();
-    void onTodoParsingFile(const QString& filename);
     void onTodoParseStarted();
-    void onTodoFound(const QString& filename, int lineNo, int ch, const QString& line);
+    void onTodosFound(const QStringList& files, const QList<PTodoItem>& items);
     void onTodoParseFinished();
     void onWatchpointHitted(const QString& var, const QString& oldVal, const QString& newVal);
     void setActiveBreakpoint(QString FileName, int Line, bool setFocus);
@@ -314,6 +313,7 @@ private:
     void doCompileRun(RunType runType);
     void doGenerateAssembly();
     void updateProblemCaseOutput(POJProblemCase problemCase);
+    bool isCurrentProblemCase(const QString& id);
     void applyCurrentProblemCaseChanges();
     void showHideInfosTab(QWidget *widget, bool show);
     void showHideMessagesTab(QWidget *widget, bool show);
@@ -20,15 +20,102 @@
 #include "qsynedit/syntaxer/cpp.h"
 
 #include <QApplication>
+#include <QDataStream>
 #include <QDate>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFileInfo>
 #include <QHash>
 #include <QQueue>
 #include <QRegularExpression>
+#include <QRunnable>
+#include <QSaveFile>
 #include <QThread>
+#include <QThreadPool>
 #include <QTime>
 
 static QAtomicInt cppParserCount(0);
 
+static const quint32 SYMBOL_CACHE_MAGIC = 0x52504353; // "RPCS"
+static const qint32 SYMBOL_CACHE_VERSION = 1;
+
+struct SymbolLayerFile {
+    QString fileName;
+    qint64 size;
+    qint64 lastModified; // msecs since epoch
+
+    bool isUnchanged() const {
+        QFileInfo info(fileName);
+        return info.exists() && info.size()==size
+                && info.lastModified().toMSecsSinceEpoch()==lastModified;
+    }
+};
+
+// System header statements loaded from a symbol cache file
+struct SymbolLayer {
+    QString cacheKey;
+    SymbolLayerFile cacheFile;
+    QList<SymbolLayerFile> files;
+    QList<PFileIncludes> fileIncludesList;
+    QList<PDefineMap> defineMaps;
+    QVector<PStatement> statements; // parents before children
+    QSet<QString> inlineNamespaces;
+    int uniqId;
+    qint64 memoryUsage;
+
+    SymbolLayer():uniqId(0),memoryUsage(0) {}
+
+    bool isValid(const QString& key) const {
+        if (key!=cacheKey || !cacheFile.isUnchanged())
+            return false;
+        foreach (const SymbolLayerFile& file, files) {
+            if (!file.isUnchanged())
+                return false;
+        }
+        return true;
+    }
+};
+
+namespace {
+// layers shared by the parsers, indexed by the cache file name
+QMutex symbolLayersMutex;
+QHash<QString,std::weak_ptr<SymbolLayer>> symbolLayers;
+
+qint64 estimateMemoryUsage(const PStatement& statement)
+{
+    qint64 size = sizeof(Statement);
+    size += (statement->type.capacity() + statement->command.capacity()
+             + statement->args.capacity() + statement->value.capacity()
+             + statement->fileName.capacity() + statement->definitionFileName.capacity()
+             + statement->fullName.capacity() + statement->noNameArgs.capacity())
+            * sizeof(QChar);
+    // map/hash nodes, without the keys' contents
+    size += (statement->children.count() + statement->friends.count()
+             + statement->usingList.count())
+            * (sizeof(QString) + sizeof(PStatement) + 3*sizeof(void*));
+    return size;
+}
+
+// a translation unit that has been preprocessed and is waiting to be tokenized
+struct PreprocessedUnit {
+    QString fileName;
+    CppTokenizer tokenizer; // holds the preprocessed lines until tokenized
+};
+using PPreprocessedUnit = std::shared_ptr<PreprocessedUnit>;
+
+class CppTokenizeTask : public QRunnable {
+public:
+    explicit CppTokenizeTask(const PPreprocessedUnit& unit):
+        mUnit(unit) {
+    }
+    void run() override {
+        mUnit->tokenizer.endTokenize();
+    }
+private:
+    PPreprocessedUnit mUnit;
+};
+}
+
 CppParser::CppParser(QObject *parent) : QObject(parent),
 #if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
     mMutex()
@@ -52,6 +139,16 @@ CppParser::CppParser(QObject *parent) : QObject(parent),
     //mSkipList;
     mParseLocalHeaders = true;
     mParseGlobalHeaders = true;
+    mParallelParsing = false;
+    mIncrementalParsing = false;
+    mSymbolCacheLoaded = false;
+    mSymbolCacheFileCount = 0;
+    mQueueThreadRunning = false;
+    mMaxQueueDepth = 0;
+    mProcessedRequests = 0;
+    mCoalescedRequests = 0;
+    mTotalQueueLatency = 0;
+    mMaxQueueLatency = 0;
     mLockCount = 0;
     mIsSystemHeader = false;
     mIsHeader = false;
@@ -59,6 +156,7 @@ CppParser::CppParser(QObject *parent) : QObject(parent),
 
     mCppKeywords = CppKeywords;
     mCppTypeKeywords = CppTypeKeywords;
+    updateAtomKeywords();
     mEnabled = true;
 
     internalClear();
@@ -72,20 +170,12 @@ CppParser::CppParser(QObject *parent) : QObject(parent),
 CppParser::~CppParser()
 {
     //qDebug()<<"delete parser";
-    while (true) {
-        //wait for all methods finishes running
-        {
-            QMutexLocker locker(&mMutex);
-            if (!mParsing && (mLockCount == 0)) {
-              mParsing = true;
-              break;
-            }
-        }
-        //qDebug()<<"waiting for parse finished";
-        QThread::msleep(50);
-        QCoreApplication* app = QApplication::instance();
-        app->processEvents();
+    {
+        QMutexLocker locker(&mQueueMutex);
+        mParseRequests.clear();
     }
+    //stop the running parse and wait for all methods finishes running
+    cancelAndWaitForIdle();
     //qDebug()<<"-------- parser deleted ------------";
 }
 
@@ -258,6 +348,17 @@ PStatementList CppParser::doFindNamespace(const QString &name) const
 }
 
 
+bool CppParser::mayReferTo(const QString &fileName, const QString &identifier)
+{
+    QMutexLocker locker(&mMutex);
+    if (mParsing)
+        return true;
+    auto it = mFileIdentifiers.constFind(fileName);
+    if (it == mFileIdentifiers.constEnd())
+        return true;
+    return it->contains(identifier);
+}
+
 PStatement CppParser::findStatement(const QString &fullname)
 {
     QMutexLocker locker(&mMutex);
@@ -752,7 +853,7 @@ QStringList CppParser::getClassesList()
         for (PStatement& child:statementMap) {
             if (child->kind == StatementKind::skClass)
                 list.append(child->command);
-            if (!child->children.isEmpty())
+            if (!mStatementList.childrenStatements(child).isEmpty())
                 queue.enqueue(child);
         }
     }
@@ -869,20 +970,22 @@ bool CppParser::isLineVisible(const QString &fileName, int line)
     return fileIncludes->isLineVisible(line);
 }
 
-void CppParser::invalidateFile(const QString &fileName)
+bool CppParser::invalidateFile(const QString &fileName)
 {
     if (!mEnabled)
-        return;
+        return true;
     {
         QMutexLocker locker(&mMutex);
         if (mParsing || mLockCount>0)
-            return;
+            return false;
         updateSerialId();
         mParsing = true;
     }
     QSet<QString> files = calculateFilesToBeReparsed(fileName);
     internalInvalidateFiles(files);
     mParsing = false;
+    notifyStateChanged();
+    return true;
 }
 
 bool CppParser::isIncludeLine(const QString &line)
@@ -919,14 +1022,14 @@ bool CppParser::isSystemHeaderFile(const QString &fileName)
     return ::isSystemHeaderFile(fileName,mPreprocessor.includePaths());
 }
 
-void CppParser::parseFile(const QString &fileName, bool inProject, bool onlyIfNotParsed, bool updateView)
+bool CppParser::parseFile(const QString &fileName, bool inProject, bool onlyIfNotParsed, bool updateView)
 {
     if (!mEnabled)
-        return;
+        return true;
     {
         QMutexLocker locker(&mMutex);
         if (mParsing || mLockCount>0)
-            return;
+            return false;
         updateSerialId();
         mParsing = true;
         if (updateView)
@@ -935,16 +1038,31 @@ void CppParser::parseFile(const QString &fileName, bool inProject, bool onlyIfNo
     }
     {
         auto action = finally([&,this]{
+            // don't save the symbols of a canceled parse
+            if (!parsingCanceled())
+                saveSymbolCache();
             mParsing = false;
+            notifyStateChanged();
 
             if (updateView)
                 emit onEndParsing(mFilesScannedCount,1);
             else
                 emit onEndParsing(mFilesScannedCount,0);
         });
+        if (!mSymbolCacheLoaded)
+            loadSymbolCache();
         QString fName = fileName;
         if (onlyIfNotParsed && mPreprocessor.scannedFiles().contains(fName))
-            return;
+            return true;
+
+        // edits inside a function body don't change what other files see
+        if (mIncrementalParsing && internalParseIncrementally(fileName)) {
+            mFilesToScanCount = 1;
+            mFilesScannedCount = 1;
+            return true;
+        }
+        mLastSourceFile = mIncrementalParsing ? fileName : QString();
+        mLastSourceBuffer.clear();
 
         if (inProject) {
             QSet<QString> filesToReparsed = calculateFilesToBeReparsed(fileName);
@@ -955,6 +1073,8 @@ void CppParser::parseFile(const QString &fileName, bool inProject, bool onlyIfNo
             mFilesScannedCount = 0;
 
             foreach (const QString& file,files) {
+                if (parsingCanceled())
+                    break;
                 mFilesScannedCount++;
                 emit onProgress(file,mFilesToScanCount,mFilesScannedCount);
                 if (!mPreprocessor.scannedFiles().contains(file)) {
@@ -980,16 +1100,17 @@ void CppParser::parseFile(const QString &fileName, bool inProject, bool onlyIfNo
         // Parse from disk or stream
 
     }
+    return true;
 }
 
-void CppParser::parseFileList(bool updateView)
+bool CppParser::parseFileList(bool updateView)
 {
     if (!mEnabled)
-        return;
+        return true;
     {
         QMutexLocker locker(&mMutex);
         if (mParsing || mLockCount>0)
-            return;
+            return false;
         updateSerialId();
         mParsing = true;
         if (updateView)
@@ -998,58 +1119,74 @@ void CppParser::parseFileList(bool updateView)
     }
     {
         auto action = finally([&,this]{
+            // don't save the symbols of a canceled parse
+            if (!parsingCanceled())
+                saveSymbolCache();
             mParsing = false;
+            notifyStateChanged();
             if (updateView)
                 emit onEndParsing(mFilesScannedCount,1);
             else
                 emit onEndParsing(mFilesScannedCount,0);
         });
+        if (!mSymbolCacheLoaded)
+            loadSymbolCache();
         // Support stopping of parsing when files closes unexpectedly
         mFilesScannedCount = 0;
         mFilesToScanCount = mFilesToScan.count();
 
         QStringList files = sortFilesByIncludeRelations(mFilesToScan);
-        // parse header files in the first parse
-        foreach (const QString& file, files) {
-            mFilesScannedCount++;
-            emit onProgress(mCurrentFile,mFilesToScanCount,mFilesScannedCount);
-            if (!mPreprocessor.scannedFiles().contains(file)) {
-                internalParse(file);
+        if (mParallelParsing && files.count()>1) {
+            internalParseFileList(files);
+        } else {
+            // parse header files in the first parse
+            foreach (const QString& file, files) {
+                if (parsingCanceled())
+                    break;
+                mFilesScannedCount++;
+                emit onProgress(mCurrentFile,mFilesToScanCount,mFilesScannedCount);
+                if (!mPreprocessor.scannedFiles().contains(file)) {
+                    internalParse(file);
+                }
             }
         }
         mFilesToScan.clear();
     }
+    return true;
 }
 
 void CppParser::parseHardDefines()
 {
-    QMutexLocker locker(&mMutex);
-    if (mParsing)
-        return;
-    int oldIsSystemHeader = mIsSystemHeader;
-    mIsSystemHeader = true;
-    mParsing=true;
     {
-        auto action = finally([&,this]{
-            mParsing = false;
-            mIsSystemHeader=oldIsSystemHeader;
-        });
-        for (const PDefine& define:mPreprocessor.hardDefines()) {
-            addStatement(
-                        PStatement(), // defines don't belong to any scope
-                        "",
-                        "", // define has no type
-                        define->name,
-                        define->args,
-                        "",
-                        define->value,
-                        -1,
-                        StatementKind::skPreprocessor,
-                        StatementScope::Global,
-                        StatementAccessibility::None,
-                        StatementProperty::spHasDefinition);
+        QMutexLocker locker(&mMutex);
+        if (mParsing)
+            return;
+        int oldIsSystemHeader = mIsSystemHeader;
+        mIsSystemHeader = true;
+        mParsing=true;
+        {
+            auto action = finally([&,this]{
+                mParsing = false;
+                mIsSystemHeader=oldIsSystemHeader;
+            });
+            for (const PDefine& define:mPreprocessor.hardDefines()) {
+                addStatement(
+                            PStatement(), // defines don't belong to any scope
+                            "",
+                            "", // define has no type
+                            define->name,
+                            define->args,
+                            "",
+                            define->value,
+                            -1,
+                            StatementKind::skPreprocessor,
+                            StatementScope::Global,
+                            StatementAccessibility::None,
+                            StatementProperty::spHasDefinition);
+            }
         }
     }
+    notifyStateChanged();
 }
 
 bool CppParser::parsing() const
@@ -1059,21 +1196,11 @@ bool CppParser::parsing() const
 
 void CppParser::resetParser()
 {
-    while (true) {
-        {
-            QMutexLocker locker(&mMutex);
-            if (!mParsing && mLockCount ==0) {
-                mParsing = true;
-                break;
-            }
-        }
-        QThread::msleep(50);
-        QCoreApplication* app = QApplication::instance();
-        app->processEvents();
-    }
+    cancelAndWaitForIdle();
     {
         auto action = finally([this]{
             mParsing = false;
+            notifyStateChanged();
         });
         emit  onBusy();
         mUniqId = 0;
@@ -1097,6 +1224,14 @@ void CppParser::resetParser()
         mFilesToScan.clear(); // list of base files to scan
         mNamespaces.clear();  // namespace and the statements in its scope
         mInlineNamespaces.clear();
+        mSymbolCacheFile.clear();
+        mSymbolCacheKey.clear();
+        mSymbolCacheLoaded = false;
+        mSymbolCacheFileCount = 0;
+        mLastSourceFile.clear();
+        mLastSourceBuffer.clear();
+        mSymbolLayer.reset();
+        mFileIdentifiers.clear();
 
         mPreprocessor.clear();
         mTokenizer.clear();
@@ -1106,8 +1241,11 @@ void CppParser::resetParser()
 
 void CppParser::unFreeze()
 {
-    QMutexLocker locker(&mMutex);
-    mLockCount--;
+    {
+        QMutexLocker locker(&mMutex);
+        mLockCount--;
+    }
+    notifyStateChanged();
 }
 
 QSet<QString> CppParser::scannedFiles()
@@ -1349,7 +1487,8 @@ PStatement CppParser::addStatement(const PStatement& parent,
         //find
         if (properties.testFlag(StatementProperty::spHasDefinition)) {
             PStatement oldStatement = findStatementInScope(newCommand,noNameArgs,kind,parent);
-            if (oldStatement  && !oldStatement->hasDefinition()) {
+            if (oldStatement  && !oldStatement->hasDefinition()
+                    && !oldStatement->isShared()) {
                 oldStatement->setHasDefinition(true);
                 if (oldStatement->fileName!=fileName) {
                     PFileIncludes fileIncludes=mPreprocessor.includesList().value(fileName);
@@ -1545,7 +1684,7 @@ void CppParser::setInheritance(int index, const PStatement& classStatement, bool
             index=mTokenizer[index]->matchIndex;
         } else if (currentText=="::"
                    || (isIdentChar(currentText[0]))) {
-            KeywordType keywordType = mCppKeywords.value(currentText, KeywordType::None);
+            KeywordType keywordType = tokenKeywordType(index, KeywordType::None);
             if (keywordType!=KeywordType::None) {
                 StatementAccessibility inheritScopeType = getClassMemberAccessibility(mTokenizer[index]->text);
                 if (inheritScopeType != StatementAccessibility::None) {
@@ -1938,9 +2077,27 @@ int CppParser::evaluateLiteralNumber(int endIndex, bool &ok)
     return result;
 }
 
+void CppParser::updateAtomKeywords()
+{
+    mAtomKeywords.resize(CppTokenizer::staticAtomCount());
+    for (int i=0;i<mAtomKeywords.count();i++) {
+        mAtomKeywords[i] = mCppKeywords.value(CppTokenizer::staticAtomText(i),KeywordType::NotKeyword);
+    }
+}
+
+KeywordType CppParser::tokenKeywordType(int index, KeywordType defaultType) const
+{
+    int atom = mTokenizer[index]->atom;
+    // all keywords are static atoms, except the keywords added after the atoms table is built
+    KeywordType keywordType = (atom < mAtomKeywords.count())?
+                mAtomKeywords[atom]
+              : mCppKeywords.value(mTokenizer[index]->text,KeywordType::NotKeyword);
+    return (keywordType==KeywordType::NotKeyword)?defaultType:keywordType;
+}
+
 bool CppParser::checkForKeyword(KeywordType& keywordType)
 {
-    keywordType = mCppKeywords.value(mTokenizer[mIndex]->text,KeywordType::NotKeyword);
+    keywordType = tokenKeywordType(mIndex,KeywordType::NotKeyword);
     switch(keywordType) {
     case KeywordType::Catch:
     case KeywordType::For:
@@ -2010,7 +2167,7 @@ bool CppParser::checkForStructs(KeywordType keywordType)
             mIndex++;
             return false;
         }
-        result = (mCppKeywords.value(mTokenizer[mIndex+dis]->text,KeywordType::None)==KeywordType::Struct);
+        result = (tokenKeywordType(mIndex+dis,KeywordType::None)==KeywordType::Struct);
     } else {
         result = (keywordType==KeywordType::Struct);
     }
@@ -2071,7 +2228,7 @@ bool CppParser::checkForTypedefStruct()
     //should call CheckForTypedef first!!!
     if (mIndex+1 >= mTokenizer.tokenCount())
         return false;
-    return (mCppKeywords.value(mTokenizer[mIndex+1]->text,KeywordType::None)==KeywordType::Struct);
+    return (tokenKeywordType(mIndex+1,KeywordType::None)==KeywordType::Struct);
 
 }
 
@@ -3563,14 +3720,14 @@ bool CppParser::handleStatement()
         handlePreprocessor();
 //    } else if (checkForLambda()) { // is lambda
 //        handleLambda();
-    } else if (mTokenizer[mIndex]->text=='(') {
+    } else if (mTokenizer[mIndex]->atom==CppTokenizer::AtomLeftParenthesis) {
         if (mIndex+1<tokenCount &&
                 mTokenizer[mIndex+1]->text=="operator") {
             // things like (operator int)
             mIndex++; //just skip '('
         } else
             skipParenthesis(mIndex);
-    } else if (mTokenizer[mIndex]->text==')') {
+    } else if (mTokenizer[mIndex]->atom==CppTokenizer::AtomRightParenthesis) {
         mIndex++;
     } else if (mTokenizer[mIndex]->text.startsWith('~')) {
         //it should be a destructor
@@ -3583,7 +3740,7 @@ bool CppParser::handleStatement()
             //error
             mIndex=moveToEndOfStatement(mIndex,false);
         }
-    } else if (mTokenizer[mIndex]->text=="::") {
+    } else if (mTokenizer[mIndex]->atom==CppTokenizer::AtomScope) {
         checkAndHandleMethodOrVar(KeywordType::None);
     } else if (!isIdentChar(mTokenizer[mIndex]->text[0])) {
         mIndex=moveToEndOfStatement(mIndex,true);
@@ -4330,22 +4487,21 @@ void CppParser::handleVar(const QString& typePrefix,bool isExtern,bool isStatic)
 void CppParser::internalParse(const QString &fileName)
 {
     // Perform some validation before we start
-    if (!mEnabled)
+    if (!mEnabled || parsingCanceled())
         return;
 //    if (!isCfile(fileName) && !isHfile(fileName))  // support only known C/C++ files
 //        return;
 
     //QElapsedTimer timer;
     // Preprocess the file...
-    auto action = finally([this]{
-        mTokenizer.clear();
-    });
     //timer.start();
     // Let the preprocessor augment the include records
     mPreprocessor.setScanOptions(mParseGlobalHeaders, mParseLocalHeaders);
-    mPreprocessor.preprocess(fileName);
+    // the preprocessed lines are fed to the tokenizer directly
+    mPreprocessor.preprocess(fileName, mTokenizer);
 
-    QStringList preprocessResult = mPreprocessor.result();
+    if (fileName == mLastSourceFile)
+        mLastSourceBuffer = mPreprocessor.sourceBuffer();
 #ifdef QT_DEBUG
 //        stringsToFile(mPreprocessor.result(),QString("r:\\preprocess-%1.txt").arg(extractFileName(fileName)));
 //        mPreprocessor.dumpDefinesTo("r:\\defines.txt");
@@ -4359,33 +4515,376 @@ void CppParser::internalParse(const QString &fileName)
 
     //timer.restart();
     // Tokenize the preprocessed buffer file
-    mTokenizer.tokenize(preprocessResult);
-    //reduce memory usage
-    preprocessResult.clear();
+    mTokenizer.endTokenize();
     //qDebug()<<"tokenize"<<timer.elapsed();
+    internalParseTokens();
+}
+
+void CppParser::internalParseTokens()
+{
+    auto action = finally([this]{
+        mTokenizer.clear();
+    });
     if (mTokenizer.tokenCount() == 0)
         return;
+    indexIdentifiers(true);
 #ifdef QT_DEBUG
-//       mTokenizer.dumpTokens(QString("r:\\tokens-%1.txt").arg(extractFileName(fileName)));
+//       mTokenizer.dumpTokens(QString("r:\\tokens-%1.txt").arg(extractFileName(mCurrentFile)));
 #endif
 #ifdef QT_DEBUG
         mLastIndex = -1;
 #endif
     //    timer.restart();
     // Process the token list
-    while(true) {
+    while(!parsingCanceled()) {
         if (!handleStatement())
             break;
     }
     //    qDebug()<<"parse"<<timer.elapsed();
 #ifdef QT_DEBUG
-//        mStatementList.dumpAll(QString("r:\\all-stats-%1.txt").arg(extractFileName(fileName)));
-//        mStatementList.dump(QString("r:\\stats-%1.txt").arg(extractFileName(fileName)));
+//        mStatementList.dumpAll(QString("r:\\all-stats-%1.txt").arg(extractFileName(mCurrentFile)));
+//        mStatementList.dump(QString("r:\\stats-%1.txt").arg(extractFileName(mCurrentFile)));
 #endif
     //reduce memory usage
     internalClear();
 }
 
+bool CppParser::internalParseIncrementally(const QString &fileName)
+{
+    if (fileName != mLastSourceFile || mLastSourceBuffer.isEmpty()
+            || !mPreprocessor.scannedFiles().contains(fileName))
+        return false;
+    PFileIncludes fileIncludes = mPreprocessor.includesList().value(fileName);
+    if (!fileIncludes)
+        return false;
+    QStringList newBuffer = mPreprocessor.readSourceBuffer(fileName);
+    const QStringList& oldBuffer = mLastSourceBuffer;
+
+    // Find the changed lines by skipping the unchanged head and tail.
+    // Lines (head, lastChangedLine] (1-based) are changed in the old buffer.
+    int oldCount = oldBuffer.count();
+    int newCount = newBuffer.count();
+    int head = 0;
+    while (head<oldCount && head<newCount && oldBuffer[head]==newBuffer[head])
+        head++;
+    if (head == oldCount && head == newCount)
+        return true; // only comments are changed
+    int tail = 0;
+    while (tail<oldCount-head && tail<newCount-head
+           && oldBuffer[oldCount-1-tail]==newBuffer[newCount-1-tail])
+        tail++;
+    int lastChangedLine = oldCount - tail;
+    int lineDelta = newCount - oldCount;
+    if (head == 0)
+        return false;
+    for (int i=head;i<lastChangedLine;i++) {
+        if (oldBuffer[i].startsWith('#'))
+            return false;
+    }
+
+    // The changes must be inside the body of a function
+    const QVector<PCppScope>& scopes = fileIncludes->scopes.scopes();
+    PStatement function = fileIncludes->scopes.findScopeAtLine(head);
+    while (function && function->kind == StatementKind::skBlock)
+        function = function->parentScope.lock();
+    if (!function || (function->kind != StatementKind::skFunction
+                      && function->kind != StatementKind::skConstructor
+                      && function->kind != StatementKind::skDestructor))
+        return false;
+    auto inFunction = [&function](PStatement statement) {
+        while (statement) {
+            if (statement == function)
+                return true;
+            statement = statement->parentScope.lock();
+        }
+        return false;
+    };
+    int index = scopes.count()-1;
+    while (index>=0 && scopes[index]->startLine > head)
+        index--;
+    int startIndex = index;
+    while (startIndex>0 && inFunction(scopes[startIndex-1]->statement))
+        startIndex--;
+    int endIndex = index+1;
+    while (endIndex<scopes.count() && inFunction(scopes[endIndex]->statement))
+        endIndex++;
+    if (startIndex<0 || scopes[startIndex]->statement != function
+            || endIndex>=scopes.count())
+        return false;
+    int startLine = scopes[startIndex]->startLine;
+    int endLine = scopes[endIndex]->startLine;
+    int newEndLine = endLine + lineDelta;
+    if (startLine > head || endLine <= lastChangedLine)
+        return false;
+
+    // Tokenize the function in the new buffer
+    QStringList lines = newBuffer.mid(startLine-1, newEndLine-startLine+1);
+    foreach (const QString& line, lines) {
+        if (line.startsWith('#'))
+            return false;
+    }
+    // The body is expanded with the defines at the end of the file, so the
+    // directives after the function must not change the macros it uses
+    QSet<QString> changedDefines;
+    for (int i=newEndLine;i<newCount;i++) {
+        if (!newBuffer[i].startsWith('#'))
+            continue;
+        QString directive = newBuffer[i].mid(1).trimmed();
+        // we don't know what a header included after the function defines
+        if (directive.startsWith("include"))
+            return false;
+        QString name;
+        if (directive.startsWith("define"))
+            name = directive.mid(6).trimmed();
+        else if (directive.startsWith("undef"))
+            name = directive.mid(5).trimmed();
+        else
+            continue;
+        int len = 0;
+        while (len<name.length() && (isIdentChar(name[len]) || isDigitChar(name[len])))
+            len++;
+        changedDefines.insert(name.left(len));
+    }
+    if (!changedDefines.isEmpty()) {
+        foreach (const QString& line, lines) {
+            int i=0;
+            while (i<line.length()) {
+                if (!isIdentChar(line[i]) && !isDigitChar(line[i])) {
+                    i++;
+                    continue;
+                }
+                int start = i;
+                while (i<line.length() && (isIdentChar(line[i]) || isDigitChar(line[i])))
+                    i++;
+                if (changedDefines.contains(line.mid(start,i-start)))
+                    return false;
+            }
+        }
+    }
+    QStringList buffer;
+    buffer.append(QString("#include %1:%2").arg(fileName).arg(startLine));
+    buffer.append(mPreprocessor.expandMacrosInLines(lines));
+    // tokens closing the unmatched braces are added after this line
+    buffer.append(";");
+    mTokenizer.tokenize(buffer);
+    auto action = finally([this]{
+        internalClear();
+        mTokenizer.clear();
+    });
+    int bodyStart = -1;
+    for (int i=0;i<mTokenizer.tokenCount();i++) {
+        if (mTokenizer[i]->line > head)
+            break;
+        if (mTokenizer[i]->text=='(' && mTokenizer[i]->matchIndex>i) {
+            i = mTokenizer[i]->matchIndex;
+        } else if (mTokenizer[i]->text.startsWith('{')) {
+            int matchIndex = mTokenizer[i]->matchIndex;
+            if (matchIndex>i && mTokenizer[matchIndex]->line == newEndLine) {
+                bodyStart = i;
+                break;
+            }
+        }
+    }
+    if (bodyStart<0)
+        return false;
+    int bodyEnd = mTokenizer[bodyStart]->matchIndex;
+
+    // Remove statements of the old function body
+    auto removeBodyStatements = [this,&function,&fileName,&fileIncludes]() {
+        QList<PStatement> statements;
+        foreach (const PStatement& child, function->children) {
+            if (child->fileName != fileName
+                    || child->kind == StatementKind::skParameter
+                    || child->command == "this"
+                    || child->command == "__func__")
+                continue;
+            statements.append(child);
+        }
+        for (int i=0;i<statements.count();i++) {
+            foreach (const PStatement& child, statements[i]->children) {
+                statements.append(child);
+            }
+        }
+        QSet<const Statement*> removed;
+        for (int i=statements.count()-1;i>=0;i--) {
+            removed.insert(statements[i].get());
+            mStatementList.deleteStatement(statements[i]);
+        }
+        for (auto it=fileIncludes->statements.begin();it!=fileIncludes->statements.end();) {
+            if (removed.contains(it.value().get()))
+                it = fileIncludes->statements.erase(it);
+            else
+                ++it;
+        }
+    };
+    removeBodyStatements();
+
+    // Move statements and branches after the function
+    if (lineDelta!=0) {
+        QSet<const Statement*> moved;
+        foreach (const PStatement& statement, fileIncludes->statements) {
+            if (moved.contains(statement.get()))
+                continue;
+            moved.insert(statement.get());
+            if (statement->fileName == fileName && statement->line > lastChangedLine)
+                statement->line += lineDelta;
+            if (statement->definitionFileName == fileName && statement->definitionLine > lastChangedLine)
+                statement->definitionLine += lineDelta;
+        }
+        QMap<int,bool> branches;
+        for (auto it=fileIncludes->branches.begin();it!=fileIncludes->branches.end();++it) {
+            branches.insert(it.key()>lastChangedLine?it.key()+lineDelta:it.key(), it.value());
+        }
+        fileIncludes->branches = branches;
+    }
+
+    // Parse the new function body in the scope it's defined
+    PStatement outerScope = scopes[endIndex]->statement;
+    QVector<PCppScope> tailScopes = fileIncludes->scopes.takeScopes(endIndex+1);
+    fileIncludes->scopes.takeScopes(startIndex+1);
+    mCurrentFile = fileName;
+    mIsSystemHeader = isSystemHeaderFile(mCurrentFile) || isProjectHeaderFile(mCurrentFile);
+    mIsProjectFile = mProjectFiles.contains(mCurrentFile);
+    mIsHeader = isHFile(mCurrentFile);
+    QList<PStatement> outerScopes;
+    for (PStatement scope=outerScope;scope;scope=scope->parentScope.lock()) {
+        outerScopes.prepend(scope);
+    }
+    foreach (const PStatement& scope, outerScopes) {
+        mCurrentScope.append(scope);
+        mMemberAccessibilities.append(StatementAccessibility::None);
+    }
+    mCurrentMemberAccessibility = StatementAccessibility::None;
+    addSoloScopeLevel(function, startLine);
+#ifdef QT_DEBUG
+    mLastIndex = -1;
+#endif
+    mIndex = bodyStart+1;
+    while (mIndex<=bodyEnd) {
+        if (!handleStatement())
+            break;
+    }
+    if (mCurrentScope.count() != outerScopes.count()) {
+        // the body is not parsed as expected, leave it to the full parse
+        removeBodyStatements();
+        return false;
+    }
+    foreach (const PCppScope& scope, tailScopes) {
+        fileIncludes->scopes.addScope(
+                    scope->startLine>lastChangedLine?scope->startLine+lineDelta:scope->startLine,
+                    scope->statement);
+    }
+    // identifiers removed from the body are kept, the index is only used to skip files
+    indexIdentifiers(false);
+    mLastSourceBuffer = newBuffer;
+    emit onProgress(fileName,1,1);
+    return true;
+}
+
+
+void CppParser::indexIdentifiers(bool resetFiles)
+{
+    QString currentFile;
+    QSet<QString>* identifiers = nullptr;
+    QSet<QString> resetted;
+    for (int i=0;i<mTokenizer.tokenCount();i++) {
+        const QString& text = mTokenizer[i]->text;
+        if (text.startsWith('#')) {
+            // format: #include fullfilename:line
+            if (!text.startsWith("#include "))
+                continue;
+            int delimPos = text.lastIndexOf(':');
+            if (delimPos<0)
+                continue;
+            currentFile = text.mid(9,delimPos-9).trimmed();
+            identifiers = nullptr;
+            continue;
+        }
+        if (currentFile.isEmpty())
+            continue;
+        // a token may contain several words, like "std::vector<int>" or "*p"
+        int start = -1;
+        for (int j=0;j<=text.length();j++) {
+            bool identChar = j<text.length()
+                    && (CppTokenizer::isIdentChar(text[j]) || (start>=0 && text[j].isDigit()));
+            if (identChar) {
+                if (start<0)
+                    start = j;
+                continue;
+            }
+            if (start<0)
+                continue;
+            // files included again have no tokens, so only files with tokens are touched
+            if (!identifiers) {
+                identifiers = &mFileIdentifiers[currentFile];
+                if (resetFiles && !resetted.contains(currentFile)) {
+                    identifiers->clear();
+                    resetted.insert(currentFile);
+                }
+            }
+            identifiers->insert(text.mid(start,j-start));
+            start = -1;
+        }
+    }
+}
+
+void CppParser::internalParseFileList(const QStringList &files)
+{
+    if (!mEnabled)
+        return;
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1,QThread::idealThreadCount()));
+    // limit the number of preprocessed buffers kept in memory
+    int batchSize = pool.maxThreadCount()*2;
+    QElapsedTimer timer;
+    qint64 preprocessTime = 0;
+    qint64 tokenizeTime = 0;
+    qint64 parseTime = 0;
+    int i=0;
+    while (i<files.count() && !parsingCanceled()) {
+        QList<PPreprocessedUnit> units;
+        // Preprocessing must be sequential, because it depends on the headers
+        // and defines collected when preprocessing the previous files
+        timer.start();
+        while (i<files.count() && units.count()<batchSize && !parsingCanceled()) {
+            const QString& file = files[i];
+            i++;
+            mFilesScannedCount++;
+            emit onProgress(file,mFilesToScanCount,mFilesScannedCount);
+            if (mPreprocessor.scannedFiles().contains(file))
+                continue;
+            PPreprocessedUnit unit = std::make_shared<PreprocessedUnit>();
+            unit->fileName = file;
+            mPreprocessor.setScanOptions(mParseGlobalHeaders, mParseLocalHeaders);
+            mPreprocessor.preprocess(file, unit->tokenizer);
+            mPreprocessor.clearTempResults();
+            units.append(unit);
+        }
+        preprocessTime += timer.elapsed();
+
+        // Tokenizing only depends on the preprocessed text, so units are tokenized in parallel
+        timer.start();
+        foreach (const PPreprocessedUnit& unit, units) {
+            pool.start(new CppTokenizeTask(unit));
+        }
+        pool.waitForDone();
+        tokenizeTime += timer.elapsed();
+
+        // Statements are merged into the statement model in the same order as the sequential parse
+        timer.start();
+        foreach (const PPreprocessedUnit& unit, units) {
+            if (parsingCanceled())
+                break;
+            mTokenizer.takeTokens(unit->tokenizer);
+            internalParseTokens();
+        }
+        parseTime += timer.elapsed();
+    }
+    emit onProgress(tr("preprocess %1ms, tokenize %2ms, parse %3ms")
+                    .arg(preprocessTime).arg(tokenizeTime).arg(parseTime),
+                    mFilesToScanCount,mFilesScannedCount);
+}
+
 void CppParser::inheritClassStatement(const PStatement& derived, bool isStruct,
                                       const PStatement& base, StatementAccessibility access)
 {
@@ -4396,7 +4895,7 @@ void CppParser::inheritClassStatement(const PStatement& derived, bool isStruct,
         else
             access = StatementAccessibility::Private;
     }
-    foreach (const PStatement& statement, base->children) {
+    foreach (const PStatement& statement, mStatementList.childrenStatements(base)) {
         if (statement->accessibility == StatementAccessibility::Private
                 || statement->kind == StatementKind::skConstructor
                 || statement->kind == StatementKind::skDestructor)
@@ -5794,14 +6293,20 @@ void CppParser::internalInvalidateFile(const QString &fileName)
 
     // remove its include files list
     PFileIncludes p = findFileIncludes(fileName, true);
-    if (p) {
+    if (p && p->shared) {
+        // it's shared by other parsers, only remove its statements from this parser
+        foreach (const PStatement& statement, p->statements) {
+            if (statement->fileName==fileName)
+                mStatementList.deleteStatement(statement);
+        }
+    } else if (p) {
         //fPreprocessor.InvalidDefinesInFile(FileName); //we don't need this, since we reset defines after each parse
         //p->includeFiles.clear();
         //p->usings.clear();
         for (PStatement& statement:p->statements) {
             if (statement->fileName==fileName) {
                 mStatementList.deleteStatement(statement);
-            } else {
+            } else if (!statement->isShared()) {
                 statement->setHasDefinition(false);
                 statement->definitionFileName = statement->fileName;
                 statement->definitionLine = statement->line;
@@ -5825,8 +6330,12 @@ void CppParser::internalInvalidateFile(const QString &fileName)
         }
     }
 
+    mFileIdentifiers.remove(fileName);
+
     // delete it from scannedfiles
     mPreprocessor.removeScannedFile(fileName);
+    if (fileName == mLastSourceFile)
+        mLastSourceBuffer.clear();
 }
 
 void CppParser::internalInvalidateFiles(const QSet<QString> &files)
@@ -5835,6 +6344,343 @@ void CppParser::internalInvalidateFiles(const QSet<QString> &files)
         internalInvalidateFile(file);
 }
 
+void CppParser::loadSymbolCache()
+{
+    mSymbolCacheLoaded = true;
+    mSymbolCacheFileCount = 0;
+    if (mSymbolCacheFile.isEmpty() || !mParseGlobalHeaders)
+        return;
+    //only load it into an empty parser
+    if (!mPreprocessor.scannedFiles().isEmpty())
+        return;
+    PSymbolLayer layer;
+    {
+        QMutexLocker locker(&symbolLayersMutex);
+        layer = symbolLayers.value(mSymbolCacheFile).lock();
+        if (layer && !layer->isValid(mSymbolCacheKey))
+            layer.reset();
+        if (!layer) {
+            layer = readSymbolCache();
+            if (!layer)
+                return;
+            symbolLayers.insert(mSymbolCacheFile,layer);
+        }
+    }
+
+    //merge it into the parser, the shared statements and files are never modified
+    for (const PStatement& statement:layer->statements) {
+        mStatementList.add(statement);
+        if (statement->kind == StatementKind::skNamespace) {
+            PStatementList namespaceList = mNamespaces.value(statement->fullName,PStatementList());
+            if (!namespaceList) {
+                namespaceList=std::make_shared<StatementList>();
+                mNamespaces.insert(statement->fullName,namespaceList);
+            }
+            namespaceList->append(statement);
+        }
+    }
+    for (int i=0;i<layer->fileIncludesList.count();i++) {
+        mPreprocessor.addScannedFile(layer->fileIncludesList[i],layer->defineMaps[i]);
+    }
+    mInlineNamespaces.unite(layer->inlineNamespaces);
+    mUniqId = qMax(mUniqId,layer->uniqId);
+    mSymbolCacheFileCount = layer->fileIncludesList.count();
+    mSymbolLayer = layer;
+}
+
+PSymbolLayer CppParser::readSymbolCache()
+{
+    QFile file(mSymbolCacheFile);
+    if (!file.open(QFile::ReadOnly) || file.size()==0)
+        return PSymbolLayer();
+    uchar* mapped = file.map(0,file.size());
+    if (!mapped)
+        return PSymbolLayer();
+    auto action = finally([&file,mapped]{
+        file.unmap(mapped);
+    });
+    QByteArray data = QByteArray::fromRawData((const char*)mapped,file.size());
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_6);
+
+    quint32 magic;
+    qint32 version;
+    QString key;
+    stream>>magic>>version>>key;
+    if (magic!=SYMBOL_CACHE_MAGIC || version!=SYMBOL_CACHE_VERSION || key!=mSymbolCacheKey)
+        return PSymbolLayer();
+    qint32 uniqId;
+    qint32 fileCount;
+    stream>>uniqId>>fileCount;
+    if (stream.status()!=QDataStream::Ok || fileCount<=0)
+        return PSymbolLayer();
+
+    PSymbolLayer layer = std::make_shared<SymbolLayer>();
+    QFileInfo cacheInfo(mSymbolCacheFile);
+    layer->cacheKey = mSymbolCacheKey;
+    layer->cacheFile = SymbolLayerFile{mSymbolCacheFile, cacheInfo.size(),
+            cacheInfo.lastModified().toMSecsSinceEpoch()};
+    layer->uniqId = uniqId;
+    for (int i=0;i<fileCount;i++) {
+        SymbolLayerFile layerFile;
+        stream>>layerFile.fileName>>layerFile.size>>layerFile.lastModified;
+        // the whole cache is invalid if any cached header is changed
+        if (!layerFile.isUnchanged())
+            return PSymbolLayer();
+        PFileIncludes fileIncludes = std::make_shared<FileIncludes>();
+        fileIncludes->baseFile = layerFile.fileName;
+        fileIncludes->shared = true;
+        stream>>fileIncludes->includeFiles
+              >>fileIncludes->directIncludes
+              >>fileIncludes->usings
+              >>fileIncludes->branches;
+        qint32 defineCount;
+        stream>>defineCount;
+        PDefineMap defineMap = std::make_shared<DefineMap>();
+        for (int j=0;j<defineCount;j++) {
+            PDefine define = std::make_shared<Define>();
+            stream>>define->name>>define->args>>define->value
+                  >>define->filename>>define->hardCoded>>define->argList
+                  >>define->argUsed>>define->formatValue;
+            defineMap->insert(define->name,define);
+        }
+        if (stream.status()!=QDataStream::Ok)
+            return PSymbolLayer();
+        layer->files.append(layerFile);
+        layer->fileIncludesList.append(fileIncludes);
+        layer->defineMaps.append(defineMap);
+    }
+
+    qint32 statementCount;
+    stream>>statementCount;
+    if (stream.status()!=QDataStream::Ok || statementCount<0)
+        return PSymbolLayer();
+    QVector<PStatement>& statements = layer->statements;
+    statements.reserve(statementCount);
+    for (int i=0;i<statementCount;i++) {
+        PStatement statement = std::make_shared<Statement>();
+        qint32 parentIndex;
+        qint32 kind;
+        qint32 scope;
+        qint32 accessibility;
+        qint32 properties;
+        stream>>parentIndex;
+        // parents are always saved before their children
+        if (parentIndex>=i)
+            return PSymbolLayer();
+        if (parentIndex>=0)
+            statement->parentScope = statements[parentIndex];
+        stream>>statement->type>>statement->command>>statement->args
+              >>statement->value>>kind>>scope>>accessibility
+              >>statement->line>>statement->definitionLine
+              >>statement->fileName>>statement->definitionFileName
+              >>statement->friends>>statement->fullName
+              >>statement->usingList>>statement->noNameArgs>>properties;
+        statement->kind = static_cast<StatementKind>(kind);
+        statement->scope = static_cast<StatementScope>(scope);
+        statement->accessibility = static_cast<StatementAccessibility>(accessibility);
+        statement->properties = StatementProperties(QFlag(properties))
+                | StatementProperty::spShared;
+        statement->usageCount = -1;
+        if (parentIndex>=0)
+            statements[parentIndex]->children.insert(statement->command,statement);
+        statements.append(statement);
+        layer->memoryUsage += estimateMemoryUsage(statement);
+    }
+    if (stream.status()!=QDataStream::Ok)
+        return PSymbolLayer();
+
+    for (PFileIncludes& fileIncludes:layer->fileIncludesList) {
+        qint32 count;
+        QString fullName;
+        qint32 index;
+        stream>>count;
+        for (int j=0;j<count;j++) {
+            stream>>fullName>>index;
+            if (index<0 || index>=statements.count())
+                return PSymbolLayer();
+            fileIncludes->statements.insert(fullName,statements[index]);
+        }
+        stream>>count;
+        for (int j=0;j<count;j++) {
+            stream>>fullName>>index;
+            if (index<0 || index>=statements.count())
+                return PSymbolLayer();
+            fileIncludes->declaredStatements.insert(fullName,statements[index]);
+        }
+        stream>>count;
+        for (int j=0;j<count;j++) {
+            qint32 line;
+            stream>>line>>index;
+            if (index>=statements.count())
+                return PSymbolLayer();
+            fileIncludes->scopes.addScope(line,
+                                          index>=0?statements[index]:PStatement());
+        }
+    }
+    stream>>layer->inlineNamespaces;
+    if (stream.status()!=QDataStream::Ok)
+        return PSymbolLayer();
+    return layer;
+}
+
+SymbolLayerStatistics CppParser::symbolLayerStatistics()
+{
+    SymbolLayerStatistics statistics{0,0,0,0};
+    QMutexLocker locker(&symbolLayersMutex);
+    foreach (const std::weak_ptr<SymbolLayer>& layerPtr, symbolLayers) {
+        PSymbolLayer layer = layerPtr.lock();
+        if (!layer)
+            continue;
+        statistics.layerCount++;
+        // don't count the pointer we just locked
+        statistics.parserCount += layer.use_count()-1;
+        statistics.statementCount += layer->statements.count();
+        statistics.memoryUsage += layer->memoryUsage;
+    }
+    return statistics;
+}
+
+void CppParser::saveSymbolCache()
+{
+    if (mSymbolCacheFile.isEmpty() || !mParseGlobalHeaders)
+        return;
+    QSet<QString> fileSet;
+    foreach (const QString& file, mPreprocessor.scannedFiles()) {
+        if (::isSystemHeaderFile(file, mPreprocessor.includePaths())
+                && !::isSystemHeaderFile(file, mPreprocessor.projectIncludePaths())) {
+            fileSet.insert(file);
+        }
+    }
+    // a header can only be cached together with all the headers it includes
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        foreach (const QString& file, fileSet) {
+            PFileIncludes fileIncludes = mPreprocessor.includesList().value(file);
+            if (!fileIncludes) {
+                fileSet.remove(file);
+                changed = true;
+                continue;
+            }
+            foreach (const QString& includeFile, fileIncludes->includeFiles.keys()) {
+                if (!fileSet.contains(includeFile)) {
+                    fileSet.remove(file);
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+    QStringList files = fileSet.values();
+    files.sort();
+    //nothing new since the cache is loaded/saved
+    if (files.count()<=mSymbolCacheFileCount)
+        return;
+
+    //statements declared in cached headers, parents before children
+    QVector<PStatement> statements;
+    QHash<Statement*,int> statementIndexes;
+    QQueue<PStatement> queue;
+    foreach (const PStatement& statement, mStatementList.childrenStatements()) {
+        if (fileSet.contains(statement->fileName))
+            queue.enqueue(statement);
+    }
+    while (!queue.isEmpty()) {
+        PStatement statement = queue.dequeue();
+        statementIndexes.insert(statement.get(),statements.count());
+        statements.append(statement);
+        foreach (const PStatement& child, statement->children) {
+            if (fileSet.contains(child->fileName))
+                queue.enqueue(child);
+        }
+    }
+
+    QSaveFile file(mSymbolCacheFile);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return;
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_6);
+    stream<<SYMBOL_CACHE_MAGIC<<SYMBOL_CACHE_VERSION<<mSymbolCacheKey;
+    stream<<(qint32)mUniqId<<(qint32)files.count();
+    foreach (const QString& fileName, files) {
+        QFileInfo info(fileName);
+        PFileIncludes fileIncludes = mPreprocessor.includesList().value(fileName);
+        stream<<fileName<<(qint64)info.size()
+             <<(qint64)info.lastModified().toMSecsSinceEpoch();
+        stream<<fileIncludes->includeFiles
+             <<fileIncludes->directIncludes
+             <<fileIncludes->usings
+             <<fileIncludes->branches;
+        PDefineMap defineMap = mPreprocessor.fileDefines(fileName);
+        if (defineMap) {
+            stream<<(qint32)defineMap->count();
+            foreach (const PDefine& define, *defineMap) {
+                stream<<define->name<<define->args<<define->value
+                     <<define->filename<<define->hardCoded<<define->argList
+                     <<define->argUsed<<define->formatValue;
+            }
+        } else {
+            stream<<(qint32)0;
+        }
+    }
+
+    stream<<(qint32)statements.count();
+    foreach (const PStatement& statement, statements) {
+        PStatement parent = statement->parentScope.lock();
+        stream<<(qint32)(parent?statementIndexes.value(parent.get(),-1):-1);
+        stream<<statement->type<<statement->command<<statement->args
+             <<statement->value<<(qint32)statement->kind<<(qint32)statement->scope
+             <<(qint32)statement->accessibility
+             <<(qint32)statement->line<<(qint32)statement->definitionLine
+             <<statement->fileName<<statement->definitionFileName
+             <<statement->friends<<statement->fullName
+             <<statement->usingList<<statement->noNameArgs
+             <<(qint32)statement->properties;
+    }
+
+    foreach (const QString& fileName, files) {
+        PFileIncludes fileIncludes = mPreprocessor.includesList().value(fileName);
+        QList<QPair<QString,int>> refs;
+        if (fileIncludes) {
+            for (auto it=fileIncludes->statements.begin();it!=fileIncludes->statements.end();++it) {
+                int index = statementIndexes.value(it.value().get(),-1);
+                if (index>=0)
+                    refs.append(QPair<QString,int>(it.key(),index));
+            }
+        }
+        stream<<(qint32)refs.count();
+        for (const QPair<QString,int>& ref:refs)
+            stream<<ref.first<<(qint32)ref.second;
+        refs.clear();
+        if (fileIncludes) {
+            for (auto it=fileIncludes->declaredStatements.begin();it!=fileIncludes->declaredStatements.end();++it) {
+                int index = statementIndexes.value(it.value().get(),-1);
+                if (index>=0)
+                    refs.append(QPair<QString,int>(it.key(),index));
+            }
+        }
+        stream<<(qint32)refs.count();
+        for (const QPair<QString,int>& ref:refs)
+            stream<<ref.first<<(qint32)ref.second;
+        if (fileIncludes) {
+            const QVector<PCppScope>& scopes = fileIncludes->scopes.scopes();
+            stream<<(qint32)scopes.count();
+            for (const PCppScope& scope:scopes) {
+                stream<<(qint32)scope->startLine
+                     <<(qint32)(scope->statement?statementIndexes.value(scope->statement.get(),-1):-1);
+            }
+        } else {
+            stream<<(qint32)0;
+        }
+    }
+    stream<<mInlineNamespaces;
+    if (stream.status()!=QDataStream::Ok)
+        return;
+    if (file.commit())
+        mSymbolCacheFileCount = files.count();
+}
+
 QSet<QString> CppParser::calculateFilesToBeReparsed(const QString &fileName)
 {
     if (fileName.isEmpty())
@@ -6452,6 +7298,7 @@ void CppParser::setLanguage(ParserLanguage newLanguage)
             mCppTypeKeywords.unite(SDCCTypeKeywords);
         }
 #endif
+        updateAtomKeywords();
     }
 }
 
@@ -6482,6 +7329,179 @@ const QSet<QString> &CppParser::projectIncludePaths()
     return mPreprocessor.projectIncludePaths();
 }
 
+void CppParser::setSymbolCache(const QString &cacheFile, const QString &cacheKey)
+{
+    QMutexLocker locker(&mMutex);
+    mSymbolCacheFile = cacheFile;
+    mSymbolCacheKey = cacheKey;
+    mSymbolCacheLoaded = false;
+    mSymbolCacheFileCount = 0;
+}
+
+bool CppParser::enqueueParseRequest(const PParseRequest &request)
+{
+    QMutexLocker locker(&mQueueMutex);
+    request->enqueueTime = QDateTime::currentMSecsSinceEpoch();
+    int oldPos = -1;
+    if (request->isInvalidation) {
+        // queued parses of the file would be invalidated right after, drop them
+        for (int i=mParseRequests.count()-1;i>=0;i--) {
+            const PParseRequest& oldRequest = mParseRequests[i];
+            if (!oldRequest->isFileList && oldRequest->fileName == request->fileName) {
+                mParseRequests.removeAt(i);
+                mCoalescedRequests++;
+            }
+        }
+        int pos = 0;
+        while (pos<mParseRequests.count() && mParseRequests[pos]->isInvalidation)
+            pos++;
+        mParseRequests.insert(pos,request);
+        return finishEnqueue();
+    }
+    for (int i=0;i<mParseRequests.count();i++) {
+        const PParseRequest& oldRequest = mParseRequests[i];
+        if (oldRequest->isFileList != request->isFileList)
+            continue;
+        if (oldRequest->isInvalidation)
+            continue;
+        if (!request->isFileList && oldRequest->fileName != request->fileName)
+            continue;
+        // the new request supersedes the old one, but it has been waiting since then
+        request->enqueueTime = oldRequest->enqueueTime;
+        request->updateView = request->updateView || oldRequest->updateView;
+        request->highPriority = request->highPriority || oldRequest->highPriority;
+        request->onlyIfNotParsed = request->onlyIfNotParsed && oldRequest->onlyIfNotParsed;
+        mParseRequests.removeAt(i);
+        mCoalescedRequests++;
+        oldPos = i;
+        break;
+    }
+    if (request->highPriority) {
+        int pos = 0;
+        while (pos<mParseRequests.count() && mParseRequests[pos]->highPriority)
+            pos++;
+        mParseRequests.insert(pos,request);
+    } else if (oldPos>=0) {
+        mParseRequests.insert(oldPos,request);
+    } else {
+        mParseRequests.append(request);
+    }
+    return finishEnqueue();
+}
+
+bool CppParser::finishEnqueue()
+{
+    mMaxQueueDepth = qMax(mMaxQueueDepth, (int)mParseRequests.count());
+    mQueueCondition.wakeAll();
+    if (mQueueThreadRunning)
+        return false;
+    mQueueThreadRunning = true;
+    return true;
+}
+
+ParseQueueStatistics CppParser::parseQueueStatistics()
+{
+    QMutexLocker locker(&mQueueMutex);
+    ParseQueueStatistics statistics;
+    statistics.queueDepth = mParseRequests.count();
+    statistics.maxQueueDepth = mMaxQueueDepth;
+    statistics.processedRequests = mProcessedRequests;
+    statistics.coalescedRequests = mCoalescedRequests;
+    statistics.totalLatency = mTotalQueueLatency;
+    statistics.maxLatency = mMaxQueueLatency;
+    return statistics;
+}
+
+PParseRequest CppParser::takeParseRequest()
+{
+    QMutexLocker locker(&mQueueMutex);
+    while (true) {
+        if (mParseRequests.isEmpty()) {
+            mQueueThreadRunning = false;
+            return PParseRequest();
+        }
+        {
+            QMutexLocker stateLocker(&mMutex);
+            // let resetParser() run first
+            if (!mParsing && mLockCount==0 && !parsingCanceled())
+                break;
+        }
+        mQueueCondition.wait(&mQueueMutex);
+    }
+    PParseRequest request = mParseRequests.takeFirst();
+    qint64 latency = QDateTime::currentMSecsSinceEpoch() - request->enqueueTime;
+    mProcessedRequests++;
+    mTotalQueueLatency += latency;
+    mMaxQueueLatency = qMax(mMaxQueueLatency, latency);
+    return request;
+}
+
+void CppParser::requeueParseRequest(const PParseRequest &request)
+{
+    QMutexLocker locker(&mQueueMutex);
+    foreach (const PParseRequest& newRequest, mParseRequests) {
+        if (newRequest->isFileList == request->isFileList
+                && (request->isFileList || newRequest->fileName == request->fileName)
+                && (newRequest->isInvalidation || !request->isInvalidation))
+            return;
+    }
+    mProcessedRequests--;
+    mParseRequests.prepend(request);
+}
+
+void CppParser::waitForIdleAndStartParsing()
+{
+    QMutexLocker locker(&mQueueMutex);
+    while (true) {
+        {
+            QMutexLocker stateLocker(&mMutex);
+            if (!mParsing && mLockCount==0) {
+                mParsing = true;
+                return;
+            }
+        }
+        mQueueCondition.wait(&mQueueMutex);
+    }
+}
+
+void CppParser::cancelAndWaitForIdle()
+{
+    mCancelParsing.storeRelease(1);
+    waitForIdleAndStartParsing();
+    mCancelParsing.storeRelease(0);
+}
+
+bool CppParser::parsingCanceled() const
+{
+    return mCancelParsing.loadAcquire()!=0;
+}
+
+void CppParser::notifyStateChanged()
+{
+    QMutexLocker locker(&mQueueMutex);
+    mQueueCondition.wakeAll();
+}
+
+bool CppParser::parallelParsing() const
+{
+    return mParallelParsing;
+}
+
+void CppParser::setParallelParsing(bool newParallelParsing)
+{
+    mParallelParsing = newParallelParsing;
+}
+
+bool CppParser::incrementalParsing() const
+{
+    return mIncrementalParsing;
+}
+
+void CppParser::setIncrementalParsing(bool newIncrementalParsing)
+{
+    mIncrementalParsing = newIncrementalParsing;
+}
+
 bool CppParser::parseLocalHeaders() const
 {
     return mParseLocalHeaders;
@@ -6532,74 +7552,96 @@ void CppParser::setEnabled(bool newEnabled)
     }
 }
 
-CppFileParserThread::CppFileParserThread(
-        PCppParser parser,
-        QString fileName,
-        bool inProject,
-        bool onlyIfNotParsed,
-        bool updateView,
-        QObject *parent):QThread(parent),
-    mParser(parser),
-    mFileName(fileName),
-    mInProject(inProject),
-    mOnlyIfNotParsed(onlyIfNotParsed),
-    mUpdateView(updateView)
+CppParserQueueThread::CppParserQueueThread(PCppParser parser, QObject *parent):
+    QThread(parent),
+    mParser(parser)
 {
     connect(this,&QThread::finished,
             this,&QObject::deleteLater);
 }
 
-void CppFileParserThread::run()
+void CppParserQueueThread::run()
 {
-    if (mParser && !mParser->parsing()) {
-        mParser->parseFile(mFileName,mInProject,mOnlyIfNotParsed,mUpdateView);
+    if (!mParser)
+        return;
+    while (true) {
+        PParseRequest request = mParser->takeParseRequest();
+        if (!request)
+            break;
+        bool done;
+        if (request->isInvalidation) {
+            done = mParser->invalidateFile(request->fileName);
+        } else if (request->isFileList) {
+            done = mParser->parseFileList(request->updateView);
+        } else {
+            done = mParser->parseFile(request->fileName,request->inProject,
+                                      request->onlyIfNotParsed,request->updateView);
+        }
+        // the parser is locked again before we start, try it later
+        if (!done)
+            mParser->requeueParseRequest(request);
     }
 }
 
-CppFileListParserThread::CppFileListParserThread(PCppParser parser,
-                                                 bool updateView, QObject *parent):
-    QThread(parent),
-    mParser(parser),
-    mUpdateView(updateView)
+void parseFile(PCppParser parser, const QString& fileName, bool inProject, bool onlyIfNotParsed, bool updateView, bool highPriority)
 {
-    connect(this,&QThread::finished,
-            this,&QObject::deleteLater);
-}
-
-void CppFileListParserThread::run()
-{
-    if (mParser && !mParser->parsing()) {
-        mParser->parseFileList(mUpdateView);
+    if (!parser)
+        return;
+    if (!parser->enabled())
+        return;
+//    qDebug()<<"parsing "<<fileName;
+    PParseRequest request = std::make_shared<ParseRequest>();
+    request->isFileList = false;
+    request->isInvalidation = false;
+    request->fileName = fileName;
+    request->inProject = inProject;
+    request->onlyIfNotParsed = onlyIfNotParsed;
+    request->updateView = updateView;
+    request->highPriority = highPriority;
+    if (parser->enqueueParseRequest(request)) {
+        //delete when finished
+        CppParserQueueThread* thread = new CppParserQueueThread(parser);
+        thread->start();
     }
 }
 
-void parseFile(PCppParser parser, const QString& fileName, bool inProject, bool onlyIfNotParsed, bool updateView)
+void parseFileList(PCppParser parser, bool updateView)
 {
     if (!parser)
         return;
     if (!parser->enabled())
         return;
-//    qDebug()<<"parsing "<<fileName;
-    //delete when finished
-    CppFileParserThread* thread = new CppFileParserThread(parser,fileName,inProject,onlyIfNotParsed,updateView);
-    thread->connect(thread,
-                    &QThread::finished,
-                    thread,
-                    &QThread::deleteLater);
-    thread->start();
+    PParseRequest request = std::make_shared<ParseRequest>();
+    request->isFileList = true;
+    request->isInvalidation = false;
+    request->inProject = true;
+    request->onlyIfNotParsed = false;
+    request->updateView = updateView;
+    request->highPriority = false;
+    if (parser->enqueueParseRequest(request)) {
+        //delete when finished
+        CppParserQueueThread *thread = new CppParserQueueThread(parser);
+        thread->start();
+    }
 }
 
-void parseFileList(PCppParser parser, bool updateView)
+void invalidateFile(PCppParser parser, const QString &fileName)
 {
     if (!parser)
         return;
     if (!parser->enabled())
         return;
-    //delete when finished
-    CppFileListParserThread *thread = new CppFileListParserThread(parser,updateView);
-    thread->connect(thread,
-                    &QThread::finished,
-                    thread,
-                    &QThread::deleteLater);
-    thread->start();
+    PParseRequest request = std::make_shared<ParseRequest>();
+    request->isFileList = false;
+    request->isInvalidation = true;
+    request->fileName = fileName;
+    request->inProject = false;
+    request->onlyIfNotParsed = false;
+    request->updateView = false;
+    request->highPriority = true;
+    if (parser->enqueueParseRequest(request)) {
+        //delete when finished
+        CppParserQueueThread* thread = new CppParserQueueThread(parser);
+        thread->start();
+    }
 }
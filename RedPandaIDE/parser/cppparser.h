@@ -17,17 +17,53 @@
 #ifndef CPPPARSER_H
 #define CPPPARSER_H
 
+#include <QAtomicInt>
 #include <QMutex>
 #include <QObject>
 #include <QThread>
 #include <QVector>
+#include <QWaitCondition>
 #include "statementmodel.h"
 #include "cpptokenizer.h"
 #include "cpppreprocessor.h"
 
+struct ParseRequest {
+    bool isFileList; // parse the files to scan, instead of a single file
+    bool isInvalidation; // invalidate the file, instead of parsing it
+    QString fileName;
+    bool inProject;
+    bool onlyIfNotParsed;
+    bool updateView;
+    bool highPriority; // i.e. the file is in the focused editor
+    qint64 enqueueTime; // msecs since epoch
+};
+using PParseRequest = std::shared_ptr<ParseRequest>;
+
+struct ParseQueueStatistics {
+    int queueDepth;
+    int maxQueueDepth;
+    int processedRequests;
+    int coalescedRequests; // requests merged into / superseded by a newer one
+    qint64 totalLatency; // msecs from enqueue to start of parsing, for all processed requests
+    qint64 maxLatency;
+};
+
+struct SymbolLayerStatistics {
+    int layerCount;
+    int parserCount; // parsers using the layers
+    int statementCount;
+    qint64 memoryUsage; // estimated, in bytes
+};
+
+struct SymbolLayer;
+using PSymbolLayer = std::shared_ptr<SymbolLayer>;
+
+class CppParserQueueThread;
+
 class CppParser : public QObject
 {
     Q_OBJECT
+    friend class CppParserQueueThread;
 
 public:
     explicit CppParser(QObject *parent = nullptr);
@@ -103,15 +139,16 @@ public:
 
     QString getHeaderFileName(const QString& relativeTo, const QString& headerName, bool fromNext=false);// both
 
-    void invalidateFile(const QString& fileName);
+    // returns false if the parser is busy, see also invalidateFile(PCppParser,...)
+    bool invalidateFile(const QString& fileName);
     bool isLineVisible(const QString& fileName, int line);
     bool isIncludeLine(const QString &line);
     bool isIncludeNextLine(const QString &line);
     bool isProjectHeaderFile(const QString& fileName);
     bool isSystemHeaderFile(const QString& fileName);
-    void parseFile(const QString& fileName, bool inProject,
+    bool parseFile(const QString& fileName, bool inProject,
                    bool onlyIfNotParsed = false, bool updateView = true);
-    void parseFileList(bool updateView = true);
+    bool parseFileList(bool updateView = true);
     void parseHardDefines();
     bool parsing() const;
     void resetParser();
@@ -119,6 +156,8 @@ public:
     QSet<QString> scannedFiles();
 
     bool isFileParsed(const QString& filename);
+    // false if the identifier is surely not used in the file
+    bool mayReferTo(const QString& fileName, const QString& identifier);
 
     QString prettyPrintStatement(const PStatement& statement, const QString& filename, int line = -1);
 
@@ -140,6 +179,12 @@ public:
     bool parseGlobalHeaders() const;
     void setParseGlobalHeaders(bool newParseGlobalHeaders);
 
+    bool parallelParsing() const;
+    void setParallelParsing(bool newParallelParsing);
+
+    bool incrementalParsing() const;
+    void setIncrementalParsing(bool newIncrementalParsing);
+
     const QSet<QString>& includePaths();
     const QSet<QString>& projectIncludePaths();
 
@@ -152,6 +197,39 @@ public:
 
     QList<QString> namespaces();
 
+    /**
+     * @brief Use an on-disk cache for the symbols of system headers
+     *
+     * The cache is loaded before the first parse after resetParser(), and is
+     * rewritten after a parse that scanned system headers not in it.
+     * It is ignored when:
+     *  - cacheKey differs (it should cover the compiler set, language, hard
+     *    defines and include paths);
+     *  - any cached header's size or modification time changed;
+     *  - the cache format version changed.
+     * Only headers under the include paths of the compiler set are cached.
+     * @param cacheFile
+     * @param cacheKey
+     */
+    void setSymbolCache(const QString& cacheFile, const QString& cacheKey);
+    /**
+     * @brief Statistics of the system header symbols shared by the parsers
+     *
+     * Parsers using the same symbol cache share one read-only copy of the
+     * cached statements, instead of loading their own.
+     */
+    static SymbolLayerStatistics symbolLayerStatistics();
+
+    /**
+     * @brief Queue a parse request, to be run in the background when the parser is idle
+     *
+     * A queued request for the same file (or another file list request) is
+     * superseded by the new one. High priority requests are run first.
+     * @return true if there's no thread running the queue, and the caller should start one
+     */
+    bool enqueueParseRequest(const PParseRequest& request);
+    ParseQueueStatistics parseQueueStatistics();
+
 signals:
     void onProgress(const QString& fileName, int total, int current);
     void onBusy();
@@ -509,6 +587,13 @@ private:
     void handleUsing();
     void handleVar(const QString& typePrefix,bool isExtern,bool isStatic);
     void internalParse(const QString& fileName);
+    void internalParseTokens();
+    void updateAtomKeywords();
+    // the keyword type of the token, defaultType if it's not a keyword
+    KeywordType tokenKeywordType(int index, KeywordType defaultType) const;
+    void indexIdentifiers(bool resetFiles);
+    void internalParseFileList(const QStringList& files);
+    bool internalParseIncrementally(const QString& fileName);
 //    function FindMacroDefine(const Command: AnsiString): PStatement;
     void inheritClassStatement(
             const PStatement& derived,
@@ -521,6 +606,16 @@ private:
                                       const PStatement& scope) const;
     void internalInvalidateFile(const QString& fileName);
     void internalInvalidateFiles(const QSet<QString>& files);
+    void loadSymbolCache();
+    PSymbolLayer readSymbolCache();
+    void saveSymbolCache();
+    PParseRequest takeParseRequest();
+    bool parsingCanceled() const;
+    bool finishEnqueue();
+    void cancelAndWaitForIdle();
+    void requeueParseRequest(const PParseRequest& request);
+    void waitForIdleAndStartParsing();
+    void notifyStateChanged();
     QSet<QString> calculateFilesToBeReparsed(const QString& fileName);
 //    int calcKeyLenForStruct(const QString& word);
 //    {
@@ -705,11 +800,23 @@ private:
     int mFilesToScanCount; // count of files and files included in files that have to be scanned
     bool mParseLocalHeaders;
     bool mParseGlobalHeaders;
+    bool mParallelParsing;
+    bool mIncrementalParsing;
+    // comment-free text of the file last parsed by parseFile(), used to find the changed lines
+    QString mLastSourceFile;
+    QStringList mLastSourceBuffer;
     bool mIsProjectFile;
     int mLockCount; // lock(don't reparse) when we need to find statements in a batch
     bool mParsing;
     QHash<QString,PStatementList> mNamespaces;  // namespace and the statements in its scope
     QSet<QString> mInlineNamespaces;
+    QString mSymbolCacheFile;
+    QString mSymbolCacheKey;
+    bool mSymbolCacheLoaded;
+    int mSymbolCacheFileCount; // count of system headers in the symbol cache
+    PSymbolLayer mSymbolLayer; // keeps the shared statements loaded from the cache alive
+    // identifiers in the (preprocessed) tokens of each parsed file
+    QHash<QString,QSet<QString>> mFileIdentifiers;
 #ifdef QT_DEBUG
     int mLastIndex;
 #endif
@@ -718,60 +825,56 @@ private:
 #else
     QMutex mMutex;
 #endif
+    // Guards the parse request queue. Never lock it while holding mMutex.
+    QMutex mQueueMutex;
+    // Signaled when the queue changes, or the parser becomes idle/unlocked
+    QWaitCondition mQueueCondition;
+    QList<PParseRequest> mParseRequests;
+    bool mQueueThreadRunning;
+    // set by resetParser() and the destructor, the running parse stops early
+    QAtomicInt mCancelParsing;
+    int mMaxQueueDepth;
+    int mProcessedRequests;
+    int mCoalescedRequests;
+    qint64 mTotalQueueLatency;
+    qint64 mMaxQueueLatency;
     QMap<QString,KeywordType> mCppKeywords;
+    QVector<KeywordType> mAtomKeywords; // keyword types of the tokenizer's static atoms
     QSet<QString> mCppTypeKeywords;
 };
 using PCppParser = std::shared_ptr<CppParser>;
 
-class CppFileParserThread : public QThread {
+class CppParserQueueThread : public QThread {
     Q_OBJECT
 public:
-    explicit CppFileParserThread(
+    explicit CppParserQueueThread(
             PCppParser parser,
-            QString fileName,
-            bool inProject,
-            bool onlyIfNotParsed = false,
-            bool updateView = true,
             QObject *parent = nullptr);
 
 private:
     PCppParser mParser;
-    QString mFileName;
-    bool mInProject;
-    bool mOnlyIfNotParsed;
-    bool mUpdateView;
 
     // QThread interface
 protected:
     void run() override;
 };
-using PCppParserThread = std::shared_ptr<CppFileParserThread>;
-
-class CppFileListParserThread: public QThread {
-    Q_OBJECT
-public:
-    explicit CppFileListParserThread(
-            PCppParser parser,
-            bool updateView = true,
-            QObject *parent = nullptr);
-private:
-    PCppParser mParser;
-    bool mUpdateView;
-    // QThread interface
-protected:
-    void run() override;
-};
 
 void parseFile(
     PCppParser parser,
     const QString& fileName,
     bool inProject,
     bool onlyIfNotParsed = false,
-    bool updateView = true);
+    bool updateView = true,
+    bool highPriority = false);
 
 void parseFileList(
         PCppParser parser,
         bool updateView = true);
 
+// queued like parseFile(), so the invalidation is not lost when the parser is busy
+void invalidateFile(
+        PCppParser parser,
+        const QString& fileName);
+
 
 #endif // CPPPARSER_H
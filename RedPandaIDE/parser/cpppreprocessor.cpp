@@ -15,6 +15,7 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 #include "cpppreprocessor.h"
+#include "cpptokenizer.h"
 
 #include <QFile>
 #include <QTextCodec>
@@ -22,7 +23,8 @@
 #include <QMessageBox>
 #include "../utils.h"
 
-CppPreprocessor::CppPreprocessor()
+CppPreprocessor::CppPreprocessor():
+    mTokenizer(nullptr)
 {
 }
 
@@ -36,6 +38,7 @@ void CppPreprocessor::clear()
     mIncludesList.clear();
     mFileDefines.clear(); //dictionary to save defines for each headerfile;
     mScannedFiles.clear();
+    mSourceBuffer.clear();
 
     //option data for the parser
     //{ List of current project's include path }
@@ -55,6 +58,7 @@ void CppPreprocessor::clearTempResults()
     mFileName="";
     mBuffer.clear();
     mResult.clear();
+    mTokenizer=nullptr;
     mCurrentIncludes=nullptr;
     mIncludes.clear(); // stack of files we've stepped into. last one is current file, first one is source file
     mBranchResults.clear();// stack of branch results (boolean). last one is current branch, first one is outermost branch
@@ -169,6 +173,18 @@ void CppPreprocessor::preprocess(const QString &fileName)
     //    StringsToFile(mResult,"f:\\log.txt");
 }
 
+void CppPreprocessor::preprocess(const QString &fileName, CppTokenizer &tokenizer)
+{
+    clearTempResults();
+    mTokenizer = &tokenizer;
+    mTokenizer->beginTokenize();
+    mFileName = fileName;
+    openInclude(fileName);
+    preprocessBuffer();
+    flushResult();
+    mTokenizer = nullptr;
+}
+
 void CppPreprocessor::invalidDefinesInFile(const QString &fileName)
 {
     PDefineMap defineMap = mFileDefines.value(fileName,PDefineMap());
@@ -310,6 +326,43 @@ void CppPreprocessor::removeScannedFile(const QString &filename)
     mFileDefines.remove(filename);
 }
 
+void CppPreprocessor::addScannedFile(const PFileIncludes &fileIncludes, const PDefineMap &defines)
+{
+    mScannedFiles.insert(fileIncludes->baseFile);
+    mIncludesList.insert(fileIncludes->baseFile,fileIncludes);
+    if (defines && !defines->isEmpty())
+        mFileDefines.insert(fileIncludes->baseFile,defines);
+}
+
+QStringList CppPreprocessor::readSourceBuffer(const QString &fileName)
+{
+    QStringList bufferedText;
+    if (!mOnGetFileStream || !mOnGetFileStream(fileName,bufferedText)) {
+        bufferedText = readFileToLines(fileName);
+    }
+    return removeComments(bufferedText);
+}
+
+QStringList CppPreprocessor::expandMacrosInLines(const QStringList &lines)
+{
+    // lines must be comment-free and have no preprocessor directives
+    QStringList result;
+    mBuffer = lines;
+    mIndex = 0;
+    while (mIndex < mBuffer.count()) {
+        int startIndex = mIndex;
+        result.append(expandMacros());
+        // keep line numbers if the macro's arguments span several lines
+        for (int i=startIndex;i<mIndex;i++) {
+            result.append("");
+        }
+        mIndex++;
+    }
+    mBuffer.clear();
+    mIndex = 0;
+    return result;
+}
+
 QString CppPreprocessor::getNextPreprocessor()
 {
     skipToPreprocessor(); // skip until # at start of line
@@ -820,6 +873,7 @@ void CppPreprocessor::openInclude(const QString &fileName)
         // do NOT create a new item for a file that's already in the list
         mCurrentIncludes = std::make_shared<FileIncludes>();
         mCurrentIncludes->baseFile = fileName;
+        mCurrentIncludes->shared = false;
         mIncludesList.insert(fileName,mCurrentIncludes);
     }
 
@@ -858,6 +912,8 @@ void CppPreprocessor::openInclude(const QString &fileName)
     mFileName = parsedFile->fileName;
     parsedFile->buffer = removeComments(parsedFile->buffer);
     mBuffer = parsedFile->buffer;
+    if (mIncludes.count()==1)
+        mSourceBuffer = mBuffer;
 
 //    for (int i=0;i<mBuffer.count();i++) {
 //        mBuffer[i] = mBuffer[i].trimmed();
@@ -1210,23 +1266,42 @@ void CppPreprocessor::skipToEndOfPreprocessor()
 
 void CppPreprocessor::skipToPreprocessor()
 {
+    // the lines of the last preprocessor line won't be changed anymore
+    flushResult();
     int bufferCount = mBuffer.count();
 // Increment until a line begins with a #
     while ((mIndex < bufferCount) && !mBuffer[mIndex].startsWith('#')) {
         if (getCurrentBranch()==BranchResult::isTrue) { // if not skipping, expand current macros
             int startIndex = mIndex;
             QString expanded = expandMacros();
-            mResult.append(expanded);
+            addResultLine(expanded);
             for (int i=startIndex;i<mIndex;i++) {
-                mResult.append("");
+                addResultLine("");
             }
             //mResult.append(expandMacros(mBuffer[mIndex],1));
         } else // If skipping due to a failed branch, clear line
-            mResult.append("");
+            addResultLine("");
         mIndex++;
     }
 }
 
+void CppPreprocessor::addResultLine(const QString &line)
+{
+    if (mTokenizer && mResult.isEmpty())
+        mTokenizer->addLine(line);
+    else
+        mResult.append(line);
+}
+
+void CppPreprocessor::flushResult()
+{
+    if (!mTokenizer)
+        return;
+    foreach (const QString& line, mResult)
+        mTokenizer->addLine(line);
+    mResult.clear();
+}
+
 bool CppPreprocessor::isWordChar(const QChar &ch)
 {
     if (ch=='_'
@@ -45,6 +45,8 @@ struct ParsedFile {
 };
 using PParsedFile = std::shared_ptr<ParsedFile>;
 
+class CppTokenizer;
+
 class CppPreprocessor
 {
     enum class ContentType {
@@ -71,6 +73,10 @@ public:
     void addHardDefineByLine(const QString& line);
     void setScanOptions(bool parseSystem, bool parseLocal);
     void preprocess(const QString& fileName);
+    // Preprocess the file and stream the result lines into the tokenizer as
+    // soon as they are final, result() will be empty.
+    // The caller finishes the tokenizing with tokenizer.endTokenize().
+    void preprocess(const QString& fileName, CppTokenizer& tokenizer);
 
     void dumpDefinesTo(const QString& fileName) const;
     void dumpIncludesListTo(const QString& fileName) const;
@@ -79,11 +85,22 @@ public:
     void clearIncludePaths();
     void clearProjectIncludePaths();
     void removeScannedFile(const QString& filename);
+    void addScannedFile(const PFileIncludes& fileIncludes, const PDefineMap& defines);
+    PDefineMap fileDefines(const QString& filename) const {
+        return mFileDefines.value(filename,PDefineMap());
+    }
 
     const QStringList& result() const{
         return mResult;
     };
 
+    // comment-free text of the last preprocessed source file
+    const QStringList& sourceBuffer() const {
+        return mSourceBuffer;
+    }
+    QStringList readSourceBuffer(const QString& fileName);
+    QStringList expandMacrosInLines(const QStringList& lines);
+
     QHash<QString, PFileIncludes> &includesList();
 
     const QHash<QString, PFileIncludes> &includesList() const;
@@ -115,6 +132,8 @@ private:
     void preprocessBuffer();
     void skipToEndOfPreprocessor();
     void skipToPreprocessor();
+    void addResultLine(const QString& line);
+    void flushResult();
     QString getNextPreprocessor();
     void handleBranch(const QString& line);
     void handleDefine(const QString& line);
@@ -244,7 +263,8 @@ private:
     int mIndex; // points to current file buffer.
     QString mFileName;
     QStringList mBuffer;
-    QStringList mResult;
+    QStringList mResult; // lines not sent to mTokenizer yet, when streaming
+    CppTokenizer* mTokenizer;
     PFileIncludes mCurrentIncludes;
     int mPreProcIndex;    
     QList<PParsedFile> mIncludes; // stack of files we've stepped into. last one is current file, first one is source file
@@ -258,6 +278,7 @@ private:
     QHash<QString,PFileIncludes> mIncludesList;
     QHash<QString, PDefineMap> mFileDefines; //dictionary to save defines for each headerfile;
     QSet<QString> mScannedFiles;
+    QStringList mSourceBuffer;
 
     //option data for the parser
     //{ List of current project's include path }
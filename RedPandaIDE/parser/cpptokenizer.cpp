@@ -20,16 +20,59 @@
 #include <QTextStream>
 #include <QDebug>
 
-CppTokenizer::CppTokenizer()
+namespace {
+struct StaticAtoms {
+    QHash<QString,int> atoms;
+    QVector<QString> texts;
+};
+
+const StaticAtoms& staticAtoms()
+{
+    // keywords are filled by initParser(), so the table is built on its first use
+    static const StaticAtoms result = []{
+        StaticAtoms atoms;
+        atoms.texts<<"("<<")"<<"{"<<"}"<<"]"<<";"<<","<<":"<<"::"<<"."<<"="<<"<"<<">"<<"*"<<"&";
+        Q_ASSERT(atoms.texts.count() == CppTokenizer::AtomFirstKeyword);
+        QStringList keywords = CppKeywords.keys();
+#ifdef ENABLE_SDCC
+        keywords.append(SDCCKeywords.keys());
+#endif
+        foreach (const QString& keyword, keywords) {
+            if (!atoms.texts.contains(keyword))
+                atoms.texts.append(keyword);
+        }
+        for (int i=0;i<atoms.texts.count();i++)
+            atoms.atoms.insert(atoms.texts[i],i);
+        return atoms;
+    }();
+    return result;
+}
+}
+
+CppTokenizer::CppTokenizer():
+    mHasLines(false)
 {
 
 }
 
+int CppTokenizer::staticAtomCount()
+{
+    return staticAtoms().texts.count();
+}
+
+const QString &CppTokenizer::staticAtomText(int atom)
+{
+    return staticAtoms().texts[atom];
+}
+
 void CppTokenizer::clear()
 {
     mTokenList.clear();
-    mBuffer.clear();
+    // copied on write, when the first new text is interned
+    mAtoms = staticAtoms().atoms;
+    mAtomTexts = staticAtoms().texts;
     mBufferStr.clear();
+    mHasLines = false;
     mLastToken.clear();
     mUnmatchedBraces.clear();
     mUnmatchedBrackets.clear();
@@ -38,17 +81,30 @@ void CppTokenizer::clear()
 }
 
 void CppTokenizer::tokenize(const QStringList &buffer)
+{
+    beginTokenize();
+    foreach (const QString& line, buffer)
+        addLine(line);
+    endTokenize();
+}
+
+void CppTokenizer::beginTokenize()
 {
     clear();
+}
 
-    mBuffer = buffer;
-    if (mBuffer.isEmpty())
-        return;
-    mBufferStr = mBuffer[0];
-    for (int i=1;i<mBuffer.size();i++) {
+void CppTokenizer::addLine(const QString &line)
+{
+    if (mHasLines)
         mBufferStr+='\n';
-        mBufferStr+=mBuffer[i];
-    }
+    mBufferStr+=line;
+    mHasLines = true;
+}
+
+void CppTokenizer::endTokenize()
+{
+    if (!mHasLines)
+        return;
     mStart = mBufferStr.data();
     mCurrent = mStart;
     mLineCount = mStart;
@@ -74,6 +130,22 @@ void CppTokenizer::tokenize(const QStringList &buffer)
     while (!mUnmatchedParenthesis.isEmpty()) {
         addToken(")",mCurrentLine,TokenType::RightParenthesis);
     }
+    //reduce memory usage, tokens don't refer to the buffer
+    mBufferStr.clear();
+    mStart = nullptr;
+    mCurrent = nullptr;
+    mLineCount = nullptr;
+    mHasLines = false;
+}
+
+void CppTokenizer::takeTokens(CppTokenizer &other)
+{
+    clear();
+    mTokenList.swap(other.mTokenList);
+    mAtoms.swap(other.mAtoms);
+    mAtomTexts.swap(other.mAtomTexts);
+    mLambdas.swap(other.mLambdas);
+    other.clear();
 }
 
 void CppTokenizer::dumpTokens(const QString &fileName)
@@ -82,8 +154,8 @@ void CppTokenizer::dumpTokens(const QString &fileName)
 
     if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
         QTextStream stream(&file);
-        foreach (const PToken& token,mTokenList) {
-            stream<<QString("%1,%2,%3").arg(token->line).arg(token->text).arg(token->matchIndex)
+        foreach (const Token& token,mTokenList) {
+            stream<<QString("%1,%2,%3").arg(token.line).arg(token.text).arg(token.matchIndex)
 #if QT_VERSION >= QT_VERSION_CHECK(5,15,0)
                  <<Qt::endl;
 #else
@@ -93,51 +165,61 @@ void CppTokenizer::dumpTokens(const QString &fileName)
     }
 }
 
+int CppTokenizer::internAtom(const QString &text)
+{
+    auto it = mAtoms.constFind(text);
+    if (it != mAtoms.constEnd())
+        return it.value();
+    int atom = mAtomTexts.count();
+    mAtoms.insert(text,atom);
+    mAtomTexts.append(text);
+    return atom;
+}
+
 void CppTokenizer::addToken(const QString &sText, int iLine, TokenType tokenType)
 {
-    PToken token = std::make_shared<Token>();
-    token->text = sText;
-    token->line = iLine;
-#ifdef Q_DEBUG
-    token->matchIndex = 1000000000;
-#endif
+    Token token;
+    token.atom = internAtom(sText);
+    token.text = mAtomTexts[token.atom];
+    token.line = iLine;
+    token.matchIndex = -1;
     switch(tokenType) {
     case TokenType::LeftBrace:
-        token->matchIndex=-1;
+        token.matchIndex=-1;
         mUnmatchedBraces.push_back(mTokenList.count());
         break;
     case TokenType::RightBrace:
         if (mUnmatchedBraces.isEmpty()) {
-            token->matchIndex=-1;
+            token.matchIndex=-1;
         } else {
-            token->matchIndex = mUnmatchedBraces.last();
-            mTokenList[token->matchIndex]->matchIndex=mTokenList.count();
+            token.matchIndex = mUnmatchedBraces.last();
+            mTokenList[token.matchIndex].matchIndex=mTokenList.count();
             mUnmatchedBraces.pop_back();
         }
         break;
     case TokenType::LeftBracket:
-        token->matchIndex=-1;
+        token.matchIndex=-1;
         mUnmatchedBrackets.push_back(mTokenList.count());
         break;
     case TokenType::RightBracket:
         if (mUnmatchedBrackets.isEmpty()) {
-            token->matchIndex=-1;
+            token.matchIndex=-1;
         } else {
-            token->matchIndex = mUnmatchedBrackets.last();
-            mTokenList[token->matchIndex]->matchIndex=mTokenList.count();
+            token.matchIndex = mUnmatchedBrackets.last();
+            mTokenList[token.matchIndex].matchIndex=mTokenList.count();
             mUnmatchedBrackets.pop_back();
         }
         break;
     case TokenType::LeftParenthesis:
-        token->matchIndex=-1;
+        token.matchIndex=-1;
         mUnmatchedParenthesis.push_back(mTokenList.count());
         break;
     case TokenType::RightParenthesis:
         if (mUnmatchedParenthesis.isEmpty()) {
-            token->matchIndex=-1;
+            token.matchIndex=-1;
         } else {
-            token->matchIndex = mUnmatchedParenthesis.last();
-            mTokenList[token->matchIndex]->matchIndex=mTokenList.count();
+            token.matchIndex = mUnmatchedParenthesis.last();
+            mTokenList[token.matchIndex].matchIndex=mTokenList.count();
             mUnmatchedParenthesis.pop_back();
         }
         break;
@@ -18,6 +18,8 @@
 #define CPPTOKENIZER_H
 
 #include <QObject>
+#include <QHash>
+#include <QVector>
 #include "parserutils.h"
 
 class CppTokenizer
@@ -35,22 +37,50 @@ class CppTokenizer
     };
 
 public:
+    // Atoms of the punctuations, followed by the atoms of the keywords.
+    // These atoms are the same in all tokenizers; atoms of other texts are
+    // only unique in the tokenizer that produced them.
+    enum StaticAtom {
+        AtomLeftParenthesis,
+        AtomRightParenthesis,
+        AtomLeftBrace,
+        AtomRightBrace,
+        AtomRightBracket,
+        AtomSemicolon,
+        AtomComma,
+        AtomColon,
+        AtomScope, // ::
+        AtomDot,
+        AtomAssign,
+        AtomLess,
+        AtomGreater,
+        AtomPointer, // *
+        AtomReference, // &
+        AtomFirstKeyword
+    };
     struct Token {
-      QString text;
+      QString text; // shares its data with the other tokens of the same text
       int line;
       int matchIndex;
+      int atom;
     };
-    using PToken = std::shared_ptr<Token>;
-    using TokenList = QVector<PToken>;
+    // tokens are stored by value, in one block
+    using TokenList = QVector<Token>;
     explicit CppTokenizer();
     CppTokenizer(const CppTokenizer&)=delete;
     CppTokenizer& operator=(const CppTokenizer&)=delete;
 
     void clear();
     void tokenize(const QStringList& buffer);
+    // tokenize lines as they are produced, without collecting them in a list:
+    // beginTokenize(), addLine() for each line, then endTokenize()
+    void beginTokenize();
+    void addLine(const QString& line);
+    void endTokenize();
+    void takeTokens(CppTokenizer& other);
     void dumpTokens(const QString& fileName);
-    const PToken& operator[](int i) const {
-        return mTokenList[i];
+    const Token* operator[](int i) const {
+        return &mTokenList.at(i);
     }
     int tokenCount() const {
         return mTokenList.count();
@@ -58,6 +88,8 @@ public:
     static bool isIdentChar(const QChar& ch) {
             return ch=='_' || ch.isLetter() ;
     }
+    static int staticAtomCount();
+    static const QString& staticAtomText(int atom);
     int lambdasCount() const {
         return mLambdas.count();
     }
@@ -73,7 +105,7 @@ private:
     void addToken(const QString& sText, int iLine, TokenType tokenType);
     void advance();
     void countLines();
-    PToken getToken(int index);
+    int internAtom(const QString& text);
 
     QString getForInit();
     QString getNextToken(
@@ -157,14 +189,17 @@ private:
     }
 
 private:
-    QStringList mBuffer;
     QString mBufferStr;
+    bool mHasLines;
     QChar* mStart;
     QChar* mCurrent;
     QChar* mLineCount;
     int mCurrentLine;
     QString mLastToken;
     TokenList mTokenList;
+    // the string interner of the current buffer, texts -> atoms
+    QHash<QString,int> mAtoms;
+    QVector<QString> mAtomTexts;
     QList<int> mLambdas;
     QVector<int> mUnmatchedBraces; // stack of indices for unmatched '{'
     QVector<int> mUnmatchedBrackets; // stack of indices for unmatched '['
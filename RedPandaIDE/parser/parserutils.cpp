@@ -594,6 +594,13 @@ void CppScopes::removeLastScope()
         mScopes.pop_back();
 }
 
+QVector<PCppScope> CppScopes::takeScopes(int from)
+{
+    QVector<PCppScope> result = mScopes.mid(from);
+    mScopes.resize(qMin(from,mScopes.size()));
+    return result;
+}
+
 void CppScopes::clear()
 {
     mScopes.clear();
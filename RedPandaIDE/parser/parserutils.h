@@ -157,7 +157,8 @@ enum StatementProperty {
     spConstexpr =           0x0080,
     spFunctionPointer =     0x0100,
     spOperatorOverloading = 0x0200,
-    spDummyStatement     =  0x0400
+    spDummyStatement     =  0x0400,
+    spShared =              0x0800 // in the shared system header layer, read-only
 };
 
 Q_DECLARE_FLAGS(StatementProperties, StatementProperty)
@@ -166,8 +167,6 @@ Q_DECLARE_OPERATORS_FOR_FLAGS(StatementProperties)
 
 
 
-using PStatementMathPosition = std::shared_ptr<StatementMatchPosition>;
-
 struct Statement;
 using PStatement = std::shared_ptr<Statement>;
 using StatementList = QList<PStatement>;
@@ -197,11 +196,6 @@ struct Statement {
 
     // fields for code completion
     int usageCount; //Usage Count
-    int matchPosTotal; // total of matched positions
-    int matchPosSpan; // distance between the first match pos and the last match pos;
-    int firstMatchLength; // length of first match;
-    int caseMatched; // if match with case
-    QList<PStatementMathPosition> matchPositions;
 
     // definiton line/filename is valid
     bool hasDefinition() {
@@ -210,6 +204,10 @@ struct Statement {
     void setHasDefinition(bool on) {
         properties.setFlag(StatementProperty::spHasDefinition,on);
     }
+    // statement is shared by parsers, don't modify it
+    bool isShared() {
+        return properties.testFlag(StatementProperty::spShared);
+    }
     // statement in project
     bool inProject() {
         return properties.testFlag(StatementProperty::spInProject);
@@ -287,7 +285,11 @@ public:
     void addScope(int line, PStatement scopeStatement);
     PStatement lastScope();
     void removeLastScope();
+    QVector<PCppScope> takeScopes(int from);
     void clear();
+    const QVector<PCppScope>& scopes() const {
+        return mScopes;
+    }
 private:
     QVector<PCppScope> mScopes;
 };
@@ -301,6 +303,7 @@ struct FileIncludes {
     StatementMap declaredStatements; // statements declared in this file (full name as key)
     CppScopes scopes; // int is start line of the statement scope
     QMap<int,bool> branches;
+    bool shared = false; // shared by parsers, don't modify it
     bool isLineVisible(int line);
 };
 using PFileIncludes = std::shared_ptr<FileIncludes>;
@@ -31,7 +31,14 @@ void StatementModel::add(const PStatement& statement)
     }
     PStatement parent = statement->parentScope.lock();
     if (parent) {
-        addMember(parent->children,statement);
+        //shared statements are read-only, keep the child in this model
+        if (parent->isShared()) {
+            addMember(mSharedParentChildren[parent.get()],statement);
+            auto it = mMergedChildren.find(parent.get());
+            if (it!=mMergedChildren.end())
+                addMember(it.value(),statement);
+        } else
+            addMember(parent->children,statement);
     } else {
         addMember(mGlobalStatements,statement);
     }
@@ -50,7 +57,22 @@ void StatementModel::deleteStatement(const PStatement& statement)
     PStatement parent = statement->parentScope.lock();
     int count = 0;
     if (parent) {
-        count = deleteMember(parent->children,statement);
+        //shared statements are read-only, only children added by this model are removed
+        if (parent->isShared()) {
+            auto it = mSharedParentChildren.find(parent.get());
+            if (it!=mSharedParentChildren.end()) {
+                count = deleteMember(it.value(),statement);
+                if (it.value().isEmpty()) {
+                    mSharedParentChildren.erase(it);
+                    mMergedChildren.remove(parent.get());
+                } else {
+                    auto mergedIt = mMergedChildren.find(parent.get());
+                    if (mergedIt!=mMergedChildren.end())
+                        deleteMember(mergedIt.value(),statement);
+                }
+            }
+        } else
+            count = deleteMember(parent->children,statement);
     } else {
         count = deleteMember(mGlobalStatements,statement);
     }
@@ -65,6 +87,18 @@ const StatementMap &StatementModel::childrenStatements(const PStatement& stateme
 {
     if (!statement) {
         return mGlobalStatements;
+    } else if (statement->isShared() && !mSharedParentChildren.isEmpty()) {
+        auto it = mSharedParentChildren.find(statement.get());
+        if (it==mSharedParentChildren.end())
+            return statement->children;
+        auto mergedIt = mMergedChildren.find(statement.get());
+        if (mergedIt==mMergedChildren.end()) {
+            StatementMap merged = statement->children;
+            for (auto childIt=it.value().begin();childIt!=it.value().end();++childIt)
+                merged.insert(childIt.key(),childIt.value());
+            mergedIt = mMergedChildren.insert(statement.get(),merged);
+        }
+        return mergedIt.value();
     } else {
         return statement->children;
     }
@@ -79,6 +113,8 @@ const StatementMap &StatementModel::childrenStatements(std::weak_ptr<Statement>
 void StatementModel::clear() {
     mCount=0;
     mGlobalStatements.clear();
+    mSharedParentChildren.clear();
+    mMergedChildren.clear();
 #ifdef QT_DEBUG
     mAllStatements.clear();
 #endif
@@ -18,6 +18,7 @@
 #define STATEMENTMODEL_H
 
 #include <QObject>
+#include <QHash>
 #include <QTextStream>
 #include "parserutils.h"
 
@@ -47,6 +48,11 @@ private:
 private:
     int mCount;
     StatementMap mGlobalStatements;  //may have overloaded functions, so use PStatementList to store
+    // children this parser added to shared (read-only) statements, such as
+    // a specialization of std::hash declared in namespace std
+    QHash<const Statement*, StatementMap> mSharedParentChildren;
+    // shared children plus the added ones, built when first asked for
+    mutable QHash<const Statement*, StatementMap> mMergedChildren;
 #ifdef QT_DEBUG
     StatementList mAllStatements;
 #endif
@@ -712,10 +712,10 @@ void Project::renameUnit(PProjectUnit& unit, const QString &newFileName)
         editor->saveAs(newFileName,true);
     } else {
         if (mParser)
-            mParser->invalidateFile(unit->fileName());
+            invalidateFile(mParser,unit->fileName());
         copyFile(unit->fileName(),newFileName,true);
         if (mParser)
-            mParser->parseFile(newFileName,true);
+            parseFile(mParser,newFileName,true);
     }
 
     internalRemoveUnit(unit,false,true);
@@ -27,9 +27,13 @@
 #include <QScreen>
 #include <QDesktopWidget>
 #include <QRegularExpression>
+#include <QThread>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QRunnable>
+#include <QThreadPool>
+#include "compiler/compilerprobecache.h"
 #ifdef Q_OS_LINUX
 #include <sys/sysinfo.h>
 #endif
@@ -251,6 +255,9 @@ QString Settings::Dirs::data(Settings::Dirs::DataType dataType) const
         return ":/themes";
     case DataType::Template:
         return includeTrailingPathDelimiter(appResourceDir()) + "templates";
+    case DataType::ParserCache:
+    case DataType::CompileCache:
+        return config(dataType);
     }
     return "";
 }
@@ -271,6 +278,10 @@ QString Settings::Dirs::config(Settings::Dirs::DataType dataType) const
         return includeTrailingPathDelimiter(configDir)+"themes";
     case DataType::Template:
         return includeTrailingPathDelimiter(configDir) + "templates";
+    case DataType::ParserCache:
+        return includeTrailingPathDelimiter(configDir) + "parsercache";
+    case DataType::CompileCache:
+        return includeTrailingPathDelimiter(configDir) + "compilecache";
     }
     return "";
 }
@@ -2386,7 +2397,9 @@ QStringList Settings::CompilerSet::defines(bool isCpp) {
     arguments.append(NULL_FILE);
 
     QFileInfo ccompiler(mCCompiler);
-    QByteArray output = getCompilerOutput(ccompiler.absolutePath(),ccompiler.fileName(),arguments);
+    // the custom params may include files, which can change without the compiler
+    QByteArray output = getCompilerOutput(ccompiler.absolutePath(),ccompiler.fileName(),arguments,
+                                          !mUseCustomCompileParams);
     // 'cpp.exe -dM -E -x c++ -std=c++17 NUL'
 //    qDebug()<<"------------------";
     QStringList result;
@@ -2492,7 +2505,8 @@ void Settings::CompilerSet::setGCCDirectories(const QString& binDir)
     arguments.append("-v");
     arguments.append("-E");
     arguments.append(NULL_FILE);
-    QByteArray output = getCompilerOutput(binDir,c_prog,arguments);
+    // the search dirs may be created or removed without changing the compiler
+    QByteArray output = getCompilerOutput(binDir,c_prog,arguments,false);
 
     int delimPos1 = output.indexOf("#include <...> search starts here:");
     int delimPos2 = output.indexOf("End of search list.");
@@ -2514,7 +2528,7 @@ void Settings::CompilerSet::setGCCDirectories(const QString& binDir)
     arguments.append("-E");
     arguments.append("-v");
     arguments.append(NULL_FILE);
-    output = getCompilerOutput(binDir,c_prog,arguments);
+    output = getCompilerOutput(binDir,c_prog,arguments,false);
     //gcc -xc++ -E -v NUL
 
     delimPos1 = output.indexOf("#include <...> search starts here:");
@@ -2534,7 +2548,7 @@ void Settings::CompilerSet::setGCCDirectories(const QString& binDir)
     arguments.clear();
     arguments.append("-print-search-dirs");
     arguments.append(NULL_FILE);
-    output = getCompilerOutput(binDir,c_prog,arguments);
+    output = getCompilerOutput(binDir,c_prog,arguments,false);
     // bin dirs
     QByteArray targetStr = QByteArray("programs: =");
     delimPos1 = output.indexOf(targetStr);
@@ -2634,7 +2648,7 @@ void Settings::CompilerSet::setSDCCDirectories(const QString& binDir)
         if (!mCompileOptions[key].isEmpty())
             arguments.append(pOption->setting + mCompileOptions[key]);
     }
-    QByteArray output = getCompilerOutput(binDir,c_prog,arguments);
+    QByteArray output = getCompilerOutput(binDir,c_prog,arguments,false);
 
     //bindirs
     QByteArray targetStr = QByteArray("programs:");
@@ -2763,20 +2777,23 @@ void Settings::CompilerSet::setIniOptions(const QByteArray &value)
    }
 }
 
-QByteArray Settings::CompilerSet::getCompilerOutput(const QString &binDir, const QString &binFile, const QStringList &arguments)
-{
-    QProcessEnvironment env;
-    env.insert("LANG","en");
-    QString path = binDir;
-    env.insert("PATH",path);
-    QByteArray result = runAndGetOutput(
-                includeTrailingPathDelimiter(binDir)+binFile,
-                binDir,
-                arguments,
-                QByteArray(),
-                false,
-                env);
-    return result.trimmed();
+QByteArray Settings::CompilerSet::getCompilerOutput(const QString &binDir, const QString &binFile, const QStringList &arguments, bool persistent)
+{
+    QString compiler = includeTrailingPathDelimiter(binDir)+binFile;
+    return CompilerProbeCache::getInstance()->getOutput(compiler, arguments, persistent, [&]{
+        QProcessEnvironment env;
+        env.insert("LANG","en");
+        QString path = binDir;
+        env.insert("PATH",path);
+        QByteArray result = runAndGetOutput(
+                    compiler,
+                    binDir,
+                    arguments,
+                    QByteArray(),
+                    false,
+                    env);
+        return result.trimmed();
+    });
 }
 
 Settings::CompilerSet::CompilationStage Settings::CompilerSet::compilationStage() const
@@ -3116,6 +3133,8 @@ void Settings::CompilerSets::clearSets()
 void Settings::CompilerSets::findSets()
 {
     clearSets();
+    // search dirs and custom arguments may have changed since the compilers were probed
+    CompilerProbeCache::getInstance()->clear();
     QSet<QString> searched;
 
     QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
@@ -3166,6 +3185,33 @@ void Settings::CompilerSets::saveSets()
     mSettings->mSettings.setValue(SETTING_COMPILTER_SETS_COUNT,(int)mList.size());
 
     mSettings->mSettings.endGroup();
+    prefetchProbes();
+}
+
+namespace {
+class CompilerProbeRunnable : public QRunnable {
+public:
+    explicit CompilerProbeRunnable(Settings::PCompilerSet compilerSet):
+        mCompilerSet(compilerSet) {
+    }
+    void run() override {
+        // outputs are kept by the probe cache
+        mCompilerSet->defines(true);
+        mCompilerSet->defines(false);
+        CompilerProbeCache::getInstance()->flush();
+    }
+private:
+    Settings::PCompilerSet mCompilerSet;
+};
+}
+
+void Settings::CompilerSets::prefetchProbes()
+{
+    for (const PCompilerSet& pSet:mList) {
+        // probe a copy, the set may be changed in the gui thread meanwhile
+        QThreadPool::globalInstance()->start(
+                    new CompilerProbeRunnable(std::make_shared<CompilerSet>(*pSet)));
+    }
 }
 
 void Settings::CompilerSets::loadSets()
@@ -3191,6 +3237,7 @@ void Settings::CompilerSets::loadSets()
     }
     PCompilerSet pCurrentSet = defaultSet();
     if (pCurrentSet) {
+        prefetchProbes();
         QString msg;
 //        if (!pCurrentSet->dirsValid(msg)) {
 //            if (QMessageBox::warning(nullptr,QObject::tr("Confirm"),
@@ -3799,6 +3846,26 @@ void Settings::Environment::setUseCustomTerminal(bool newUseCustomTerminal)
     mUseCustomTerminal = newUseCustomTerminal;
 }
 
+bool Settings::Environment::enableCompileCache() const
+{
+    return mEnableCompileCache;
+}
+
+void Settings::Environment::setEnableCompileCache(bool newEnableCompileCache)
+{
+    mEnableCompileCache = newEnableCompileCache;
+}
+
+int Settings::Environment::compileCacheMaxSize() const
+{
+    return mCompileCacheMaxSize;
+}
+
+void Settings::Environment::setCompileCacheMaxSize(int newCompileCacheMaxSize)
+{
+    mCompileCacheMaxSize = newCompileCacheMaxSize;
+}
+
 void Settings::Environment::checkAndSetTerminal()
 {
     if (isTerminalValid()) return;
@@ -3931,6 +3998,8 @@ void Settings::Environment::doSave()
 
     saveValue("hide_non_support_files_file_view",mHideNonSupportFilesInFileView);
     saveValue("open_files_in_single_instance",mOpenFilesInSingleInstance);
+    saveValue("enable_compile_cache",mEnableCompileCache);
+    saveValue("compile_cache_max_size",mCompileCacheMaxSize);
 }
 
 QString Settings::Environment::interfaceFont() const
@@ -4048,6 +4117,26 @@ void Settings::Executor::setCaseMemoryLimit(size_t newCaseMemoryLimit)
     mCaseMemoryLimit = newCaseMemoryLimit;
 }
 
+bool Settings::Executor::caseLimitBySystem() const
+{
+    return mCaseLimitBySystem;
+}
+
+void Settings::Executor::setCaseLimitBySystem(bool newCaseLimitBySystem)
+{
+    mCaseLimitBySystem = newCaseLimitBySystem;
+}
+
+bool Settings::Executor::runCasesInParallel() const
+{
+    return mRunCasesInParallel;
+}
+
+void Settings::Executor::setRunCasesInParallel(bool newRunCasesInParallel)
+{
+    mRunCasesInParallel = newRunCasesInParallel;
+}
+
 bool Settings::Executor::convertHTMLToTextForExpected() const
 {
     return mConvertHTMLToTextForExpected;
@@ -4174,6 +4263,8 @@ void Settings::Executor::doSave()
     saveValue("case_memory_limit",mCaseMemoryLimit);
     remove("case_timeout");
     saveValue("enable_case_limit", mEnableCaseLimit);
+    saveValue("case_limit_by_system", mCaseLimitBySystem);
+    saveValue("run_cases_in_parallel", mRunCasesInParallel);
 }
 
 bool Settings::Executor::pauseConsole() const
@@ -4221,6 +4312,8 @@ void Settings::Executor::doLoad()
     if (boolValue("enable_time_limit", true)) {
         mEnableCaseLimit=true;
     }
+    mCaseLimitBySystem = boolValue("case_limit_by_system", false);
+    mRunCasesInParallel = boolValue("run_cases_in_parallel", true);
 }
 
 
@@ -4533,6 +4626,26 @@ void Settings::CodeCompletion::setShareParser(bool newShareParser)
     mShareParser = newShareParser;
 }
 
+bool Settings::CodeCompletion::parallelParsing() const
+{
+    return mParallelParsing;
+}
+
+void Settings::CodeCompletion::setParallelParsing(bool newParallelParsing)
+{
+    mParallelParsing = newParallelParsing;
+}
+
+bool Settings::CodeCompletion::incrementalParsing() const
+{
+    return mIncrementalParsing;
+}
+
+void Settings::CodeCompletion::setIncrementalParsing(bool newIncrementalParsing)
+{
+    mIncrementalParsing = newIncrementalParsing;
+}
+
 bool Settings::CodeCompletion::hideSymbolsStartsWithUnderLine() const
 {
     return mHideSymbolsStartsWithUnderLine;
@@ -4672,6 +4785,8 @@ void Settings::CodeCompletion::doSave()
     saveValue("hide_symbols_start_with_two_underline", mHideSymbolsStartsWithTwoUnderLine);
     saveValue("hide_symbols_start_with_underline", mHideSymbolsStartsWithUnderLine);
     saveValue("share_parser",mShareParser);
+    saveValue("parallel_parsing",mParallelParsing);
+    saveValue("incremental_parsing",mIncrementalParsing);
 }
 
 
@@ -4724,6 +4839,8 @@ void Settings::CodeCompletion::doLoad()
 //#endif
     //mClearWhenEditorHidden = boolValue("clear_when_editor_hidden",doClear);
     mShareParser = boolValue("share_parser",shouldShare);
+    mParallelParsing = boolValue("parallel_parsing",QThread::idealThreadCount()>1);
+    mIncrementalParsing = boolValue("incremental_parsing",true);
 }
 
 Settings::CodeFormatter::CodeFormatter(Settings *settings):
@@ -95,7 +95,9 @@ public:
             ColorScheme,
             IconSet,
             Theme,
-            Template
+            Template,
+            ParserCache,
+            CompileCache
         };
         explicit Dirs(Settings * settings);
         QString appDir() const;
@@ -609,6 +611,12 @@ public:
 
         QList<TerminalItem> loadTerminalList() const;
 
+        bool enableCompileCache() const;
+        void setEnableCompileCache(bool newEnableCompileCache);
+
+        int compileCacheMaxSize() const;
+        void setCompileCacheMaxSize(int newCompileCacheMaxSize);
+
     private:
         bool isTerminalValid();
         void checkAndSetTerminal();
@@ -631,6 +639,8 @@ public:
         bool mUseCustomTerminal;
         bool mHideNonSupportFilesInFileView;
         bool mOpenFilesInSingleInstance;
+        bool mEnableCompileCache;
+        int mCompileCacheMaxSize; // in MB
         // _Base interface
     protected:
         void doSave() override;
@@ -691,6 +701,11 @@ public:
         bool shareParser();
         void setShareParser(bool newShareParser);
 
+        bool parallelParsing() const;
+        void setParallelParsing(bool newParallelParsing);
+        bool incrementalParsing() const;
+        void setIncrementalParsing(bool newIncrementalParsing);
+
     private:
         int mWidth;
         int mHeight;
@@ -709,6 +724,8 @@ public:
         bool mHideSymbolsStartsWithUnderLine;
         //bool mClearWhenEditorHidden;
         bool mShareParser;
+        bool mParallelParsing;
+        bool mIncrementalParsing;
 
         // _Base interface
     protected:
@@ -945,6 +962,12 @@ public:
         size_t caseMemoryLimit() const;
         void setCaseMemoryLimit(size_t newCaseMemoryLimit);
 
+        bool caseLimitBySystem() const;
+        void setCaseLimitBySystem(bool newCaseLimitBySystem);
+
+        bool runCasesInParallel() const;
+        void setRunCasesInParallel(bool newRunCasesInParallel);
+
         bool convertHTMLToTextForInput() const;
         void setConvertHTMLToTextForInput(bool newConvertHTMLToTextForInput);
 
@@ -984,6 +1007,8 @@ public:
         bool mEnableCaseLimit;
         qulonglong mCaseTimeout; //ms
         qulonglong mCaseMemoryLimit; //kb
+        bool mCaseLimitBySystem;
+        bool mRunCasesInParallel;
 
     protected:
         void doSave() override;
@@ -1481,8 +1506,9 @@ public:
         void setUserInput();
 
 
+        // outputs that depend on more than the compiler are only cached in memory
         QByteArray getCompilerOutput(const QString& binDir, const QString& binFile,
-                                     const QStringList& arguments);
+                                     const QStringList& arguments, bool persistent = true);
     private:
         bool mFullLoaded;
         // Executables, most are hardcoded
@@ -1542,6 +1568,8 @@ public:
         void findSets();
         void saveSets();
         void loadSets();
+        // probe the predefined macros in the background, so resetting parsers won't wait for the compiler
+        void prefetchProbes();
         void saveDefaultIndex();
         void deleteSet(int index);
         void saveSet(int index);
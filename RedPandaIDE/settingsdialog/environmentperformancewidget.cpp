@@ -54,15 +54,24 @@ void EnvironmentPerformanceWidget::doLoad()
 //    }
 //#endif
     ui->chkEditorsShareParser->setChecked(pSettings->codeCompletion().shareParser());
+    ui->chkParallelParsing->setChecked(pSettings->codeCompletion().parallelParsing());
+    ui->chkIncrementalParsing->setChecked(pSettings->codeCompletion().incrementalParsing());
     ui->spinMaxUndoMemory->setValue(pSettings->editor().undoMemoryUsage());
+    ui->grpCompileCache->setChecked(pSettings->environment().enableCompileCache());
+    ui->spinCompileCacheMaxSize->setValue(pSettings->environment().compileCacheMaxSize());
 }
 
 void EnvironmentPerformanceWidget::doSave()
 {
     //pSettings->codeCompletion().setClearWhenEditorHidden(ui->chkClearWhenEditorHidden->isChecked());
     pSettings->codeCompletion().setShareParser(ui->chkEditorsShareParser->isChecked());
+    pSettings->codeCompletion().setParallelParsing(ui->chkParallelParsing->isChecked());
+    pSettings->codeCompletion().setIncrementalParsing(ui->chkIncrementalParsing->isChecked());
 
     pSettings->codeCompletion().save();
     pSettings->editor().setUndoMemoryUsage(ui->spinMaxUndoMemory->value());
     pSettings->editor().save();
+    pSettings->environment().setEnableCompileCache(ui->grpCompileCache->isChecked());
+    pSettings->environment().setCompileCacheMaxSize(ui->spinCompileCacheMaxSize->value());
+    pSettings->environment().save();
 }
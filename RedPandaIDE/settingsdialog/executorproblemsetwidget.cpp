@@ -27,6 +27,9 @@ ExecutorProblemSetWidget::ExecutorProblemSetWidget(const QString& name, const QS
     ui->cbProblemCaseValidateType->addItem(tr("Exact"));
     ui->cbProblemCaseValidateType->addItem(tr("Ignore leading/trailing spaces"));
     ui->cbProblemCaseValidateType->addItem(tr("Ignore spaces"));
+#ifndef Q_OS_LINUX
+    ui->chkCaseLimitBySystem->setVisible(false);
+#endif
 
 }
 
@@ -45,6 +48,7 @@ void ExecutorProblemSetWidget::doLoad()
 
     ui->cbProblemCaseValidateType->setCurrentIndex((int)(pSettings->executor().problemCaseValidateType()));
     ui->chkRedirectStderr->setChecked(pSettings->executor().redirectStderrToToolLog());
+    ui->chkRunCasesInParallel->setChecked(pSettings->executor().runCasesInParallel());
 
     ui->cbFont->setCurrentFont(QFont(pSettings->executor().caseEditorFontName()));
     ui->spinFontSize->setValue(pSettings->executor().caseEditorFontSize());
@@ -53,6 +57,7 @@ void ExecutorProblemSetWidget::doLoad()
 
     ui->spinCaseTimeout->setValue(pSettings->executor().caseTimeout());
     ui->spinMemoryLimit->setValue(pSettings->executor().caseMemoryLimit());
+    ui->chkCaseLimitBySystem->setChecked(pSettings->executor().caseLimitBySystem());
 }
 
 void ExecutorProblemSetWidget::doSave()
@@ -64,12 +69,14 @@ void ExecutorProblemSetWidget::doSave()
     pSettings->executor().setConvertHTMLToTextForExpected(ui->chkConvertExpectedHTML->isChecked());
     pSettings->executor().setProblemCaseValidateType((ProblemCaseValidateType)(ui->cbProblemCaseValidateType->currentIndex()));
     pSettings->executor().setRedirectStderrToToolLog(ui->chkRedirectStderr->isChecked());
+    pSettings->executor().setRunCasesInParallel(ui->chkRunCasesInParallel->isChecked());
     pSettings->executor().setCaseEditorFontName(ui->cbFont->currentFont().family());
     pSettings->executor().setCaseEditorFontOnlyMonospaced(ui->chkOnlyMonospaced->isChecked());
     pSettings->executor().setCaseEditorFontSize(ui->spinFontSize->value());
     pSettings->executor().setEnableCaseLimit(ui->grpEnableTimeout->isChecked());
     pSettings->executor().setCaseTimeout(ui->spinCaseTimeout->value());
     pSettings->executor().setCaseMemoryLimit(ui->spinMemoryLimit->value());
+    pSettings->executor().setCaseLimitBySystem(ui->chkCaseLimitBySystem->isChecked());
 
     pSettings->executor().save();
     pMainWindow->applySettings();
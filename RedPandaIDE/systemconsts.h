@@ -68,6 +68,7 @@
 #define RES_EXT "res"
 #define H_EXT "h"
 #define OBJ_EXT "o"
+#define DEP_EXT "d"
 #define LST_EXT "lst"
 #define DEF_EXT "def"
 #define LIB_EXT "a"
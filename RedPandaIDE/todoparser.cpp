@@ -19,11 +19,64 @@
 #include "editor.h"
 #include "editorlist.h"
 
+#include <QCryptographicHash>
+#include <QFileInfo>
 #include <QRegularExpression>
+#include <algorithm>
 
 
+#define TODO_FLUSH_INTERVAL 100
+
 static QRegularExpression todoReg("\\b(todo|fixme)\\b", QRegularExpression::CaseInsensitiveOption);
+
+namespace {
+// A cheap test before running the syntaxer and the regexp.
+// Every match of todoReg contains "todo" or "fixme" (ignoring ascii case).
+template<typename Char>
+bool mayContainTodo(const Char* data, int length)
+{
+    for (int i=0;i+4<=length;i++) {
+        uint c = data[i] | 0x20;
+        if (c == 't') {
+            if ((data[i+1] | 0x20) == 'o'
+                    && (data[i+2] | 0x20) == 'd'
+                    && (data[i+3] | 0x20) == 'o')
+                return true;
+        } else if (c == 'f' && i+5<=length) {
+            if ((data[i+1] | 0x20) == 'i'
+                    && (data[i+2] | 0x20) == 'x'
+                    && (data[i+3] | 0x20) == 'm'
+                    && (data[i+4] | 0x20) == 'e')
+                return true;
+        }
+    }
+    return false;
+}
+
+bool mayContainTodo(const QString& line)
+{
+    return mayContainTodo(line.utf16(), line.length());
+}
+
+bool mayContainTodo(const QByteArray& content)
+{
+    // readFileToLines() only reads 8 bit encodings, which are all ascii compatible
+    return mayContainTodo((const uchar*)content.constData(), content.length());
+}
+
+QByteArray hashContents(const QStringList& lines)
+{
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    foreach (const QString& line, lines) {
+        hash.addData((const char*)line.constData(), line.length()*sizeof(QChar));
+        hash.addData("\n",1);
+    }
+    return hash.result();
+}
+}
+
 TodoParser::TodoParser(QObject *parent) : QObject(parent),
+    mIndex(std::make_shared<TodoIndex>()),
 #if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
     mMutex()
 #else
@@ -39,25 +92,8 @@ void TodoParser::parseFile(const QString &filename,bool isForProject)
     if (mThread) {
         return;
     }
-    mThread = new TodoThread(filename);
-    connect(mThread,&QThread::finished,
-            [this] {
-        QMutexLocker locker(&mMutex);
-        if (mThread) {
-            mThread->deleteLater();
-            mThread = nullptr;
-        }
-    });
-    if (!isForProject) {
-        connect(mThread, &TodoThread::parseStarted,
-            pMainWindow, &MainWindow::onTodoParseStarted);
-    }
-    connect(mThread, &TodoThread::parsingFile,
-            pMainWindow, &MainWindow::onTodoParsingFile);
-    connect(mThread, &TodoThread::todoFound,
-            pMainWindow, &MainWindow::onTodoFound);
-    connect(mThread, &TodoThread::parseFinished,
-            pMainWindow, &MainWindow::onTodoParseFinished);
+    mThread = new TodoThread(filename, mIndex);
+    connectThread(!isForProject);
     mThread->start();
 }
 
@@ -67,7 +103,23 @@ void TodoParser::parseFiles(const QStringList &files)
     if (mThread) {
         return;
     }
-    mThread = new TodoThread(files);
+    mThread = new TodoThread(files, mIndex);
+    connectThread(true);
+    mThread->start();
+}
+
+bool TodoParser::parsing() const
+{
+    return (mThread!=nullptr);
+}
+
+void TodoParser::removeFile(const QString &filename)
+{
+    mIndex->remove(filename);
+}
+
+void TodoParser::connectThread(bool clearOnStart)
+{
     connect(mThread,&QThread::finished,
             [this] {
         QMutexLocker locker(&mMutex);
@@ -76,29 +128,25 @@ void TodoParser::parseFiles(const QStringList &files)
             mThread = nullptr;
         }
     });
-    connect(mThread, &TodoThread::parseStarted,
+    if (clearOnStart) {
+        connect(mThread, &TodoThread::parseStarted,
             pMainWindow, &MainWindow::onTodoParseStarted);
-    connect(mThread, &TodoThread::parsingFile,
-            pMainWindow, &MainWindow::onTodoParsingFile);
-    connect(mThread, &TodoThread::todoFound,
-            pMainWindow, &MainWindow::onTodoFound);
+    }
+    connect(mThread, &TodoThread::todosFound,
+            pMainWindow, &MainWindow::onTodosFound);
     connect(mThread, &TodoThread::parseFinished,
             pMainWindow, &MainWindow::onTodoParseFinished);
-    mThread->start();
 }
 
-bool TodoParser::parsing() const
-{
-    return (mThread!=nullptr);
-}
-
-TodoThread::TodoThread(const QString &filename, QObject *parent): QThread(parent)
+TodoThread::TodoThread(const QString &filename, PTodoIndex index, QObject *parent): QThread(parent),
+    mIndex(index)
 {
     mFilename = filename;
     mParseFiles = false;
 }
 
-TodoThread::TodoThread(const QStringList &files, QObject *parent): QThread(parent)
+TodoThread::TodoThread(const QStringList &files, PTodoIndex index, QObject *parent): QThread(parent),
+    mIndex(index)
 {
     mFiles = files;
     mParseFiles = true;
@@ -108,7 +156,9 @@ void TodoThread::parseFile()
 {
     QSynedit::PSyntaxer syntaxer = syntaxerManager.getSyntaxer(QSynedit::ProgrammingLanguage::CPP);
     emit parseStarted();
+    mFlushTimer.start();
     doParseFile(mFilename,syntaxer);
+    flushTodos(true);
     emit parseFinished();
 }
 
@@ -116,22 +166,63 @@ void TodoThread::parseFiles()
 {
     QSynedit::PSyntaxer highlighter = syntaxerManager.getSyntaxer(QSynedit::ProgrammingLanguage::CPP);
     emit parseStarted();
+    mFlushTimer.start();
     foreach(const QString& filename,mFiles) {
         doParseFile(filename,highlighter);
+        flushTodos(false);
     }
+    flushTodos(true);
     emit parseFinished();
 }
 
 void TodoThread::doParseFile(const QString &filename, QSynedit::PSyntaxer syntaxer)
 {
-    emit parsingFile(filename);
+    QList<PTodoItem> items;
     QStringList lines;
-    if (!pMainWindow->editorList()->getContentFromOpenedEditor(filename,lines)) {
-        lines = readFileToLines(filename);
+    if (pMainWindow->editorList()->getContentFromOpenedEditor(filename,lines)) {
+        QByteArray hash = hashContents(lines);
+        if (!mIndex->findByContentHash(filename, hash, items)) {
+            items = findTodos(filename, lines, syntaxer);
+            mIndex->update(filename, QDateTime(), -1, hash, items);
+        }
+    } else {
+        QFileInfo info(filename);
+        QDateTime modified = info.lastModified();
+        qint64 size = info.size();
+        if (!mIndex->findByFileInfo(filename, modified, size, items)) {
+            // most files have no todos, don't decode them
+            if (mayContainTodo(readFileToByteArray(filename))) {
+                lines = readFileToLines(filename);
+                items = findTodos(filename, lines, syntaxer);
+            }
+            mIndex->update(filename, modified, size, QByteArray(), items);
+        }
+    }
+    mParsedFiles.append(filename);
+    mFoundItems.append(items);
+}
+
+QList<PTodoItem> TodoThread::findTodos(const QString &filename, const QStringList &lines, QSynedit::PSyntaxer syntaxer)
+{
+    QList<PTodoItem> items;
+    int lastCandidate = -1;
+    QVector<bool> candidates(lines.count());
+    for (int i=0;i<lines.count();i++) {
+        if (mayContainTodo(lines[i])) {
+            candidates[i] = true;
+            lastCandidate = i;
+        }
     }
     syntaxer->resetState();
-    for (int i =0;i<lines.count();i++) {
+    // lines after the last candidate can't contain todos
+    for (int i =0;i<=lastCandidate;i++) {
         syntaxer->setLine(lines[i],i);
+        if (!candidates[i]) {
+            // still scan the line, the comment state goes on to the next lines
+            while (!syntaxer->eol())
+                syntaxer->next();
+            continue;
+        }
         while (!syntaxer->eol()) {
             QSynedit::PTokenAttribute attr;
             attr = syntaxer->getTokenAttribute();
@@ -139,19 +230,31 @@ void TodoThread::doParseFile(const QString &filename, QSynedit::PSyntaxer syntax
                 QString token = syntaxer->getToken();
                 int pos = token.indexOf(todoReg);
                 if (pos>=0) {
-                    emit todoFound(
-                                filename,
-                                i+1,
-                                pos+syntaxer->getTokenPos(),
-                                lines[i].trimmed()
-                                );
+                    PTodoItem item = std::make_shared<TodoItem>();
+                    item->filename = filename;
+                    item->lineNo = i+1;
+                    item->ch = pos+syntaxer->getTokenPos();
+                    item->line = lines[i].trimmed();
+                    items.append(item);
                     break;
                 }
             }
             syntaxer->next();
         }
     }
+    return items;
+}
 
+void TodoThread::flushTodos(bool force)
+{
+    if (mParsedFiles.isEmpty())
+        return;
+    if (!force && mFlushTimer.elapsed() < TODO_FLUSH_INTERVAL)
+        return;
+    emit todosFound(mParsedFiles, mFoundItems);
+    mParsedFiles.clear();
+    mFoundItems.clear();
+    mFlushTimer.restart();
 }
 
 void TodoThread::run()
@@ -163,50 +266,78 @@ void TodoThread::run()
     }
 }
 
+bool TodoIndex::findByFileInfo(const QString &filename, const QDateTime &modified, qint64 size, QList<PTodoItem> &items)
+{
+    QMutexLocker locker(&mMutex);
+    auto it = mEntries.constFind(filename);
+    if (it == mEntries.constEnd()
+            || !it->contentHash.isEmpty()
+            || it->size != size
+            || it->modified != modified)
+        return false;
+    items = it->items;
+    return true;
+}
+
+bool TodoIndex::findByContentHash(const QString &filename, const QByteArray &hash, QList<PTodoItem> &items)
+{
+    QMutexLocker locker(&mMutex);
+    auto it = mEntries.constFind(filename);
+    if (it == mEntries.constEnd()
+            || it->contentHash != hash)
+        return false;
+    items = it->items;
+    return true;
+}
+
+void TodoIndex::update(const QString &filename, const QDateTime &modified, qint64 size, const QByteArray &hash, const QList<PTodoItem> &items)
+{
+    QMutexLocker locker(&mMutex);
+    FileEntry& entry = mEntries[filename];
+    entry.modified = modified;
+    entry.size = size;
+    entry.contentHash = hash;
+    entry.items = items;
+}
+
+void TodoIndex::remove(const QString &filename)
+{
+    QMutexLocker locker(&mMutex);
+    mEntries.remove(filename);
+}
+
 TodoModel::TodoModel(QObject *parent) : QAbstractListModel(parent)
 {
     mIsForProject=false;
 }
 
-void TodoModel::addItem(const QString &filename, int lineNo, int ch, const QString &line)
+void TodoModel::setTodosForFile(const QString &filename, const QList<PTodoItem> &items)
 {
-    QList<PTodoItem> &items=getItems(mIsForProject);
-    int pos=-1;
-    for (int i=0;i<items.count();i++) {
-        int comp=QString::compare(filename,items[i]->filename);
-        if (comp<0) {
-            pos=i;
-            break;
-        } else if (comp==0) {
-            if (lineNo<items[i]->lineNo)  {
-                pos=i;
-                break;
-            }
-        }
+    QList<PTodoItem> &fileItems=getItems(mIsForProject);
+    int first, last;
+    findFileRange(fileItems,filename,first,last);
+    if (last>first) {
+        beginRemoveRows(QModelIndex(),first,last-1);
+        fileItems.erase(fileItems.begin()+first,fileItems.begin()+last);
+        endRemoveRows();
     }
-    if (pos<0) {
-        pos=items.count();
-    }
-    beginInsertRows(QModelIndex(),pos,pos);
-    PTodoItem item = std::make_shared<TodoItem>();
-    item->filename = filename;
-    item->lineNo = lineNo;
-    item->ch = ch;
-    item->line = line;
-    items.insert(pos,item);
+    if (items.isEmpty())
+        return;
+    beginInsertRows(QModelIndex(),first,first+items.count()-1);
+    for (int i=0;i<items.count();i++)
+        fileItems.insert(first+i,items[i]);
     endInsertRows();
 }
 
 void TodoModel::removeTodosForFile(const QString &filename)
 {
     QList<PTodoItem> &items=getItems(mIsForProject);
-    for(int i=items.count()-1;i>=0;i--) {
-        PTodoItem item = items[i];
-        if (item->filename==filename) {
-            beginRemoveRows(QModelIndex(),i,i);
-            items.removeAt(i);
-            endRemoveRows();
-        }
+    int first, last;
+    findFileRange(items,filename,first,last);
+    if (last>first) {
+        beginRemoveRows(QModelIndex(),first,last-1);
+        items.erase(items.begin()+first,items.begin()+last);
+        endRemoveRows();
     }
 }
 
@@ -240,6 +371,21 @@ QList<PTodoItem> &TodoModel::getItems(bool forProject)
     return forProject?mProjectItems:mItems;
 }
 
+void TodoModel::findFileRange(const QList<PTodoItem> &items, const QString &filename, int &first, int &last) const
+{
+    // items are sorted by filename, then by line no
+    auto begin = std::lower_bound(items.begin(),items.end(),filename,
+                                  [](const PTodoItem& item, const QString& name){
+        return QString::compare(item->filename,name)<0;
+    });
+    auto end = std::upper_bound(begin,items.end(),filename,
+                                [](const QString& name, const PTodoItem& item){
+        return QString::compare(name,item->filename)<0;
+    });
+    first = begin - items.begin();
+    last = end - items.begin();
+}
+
 const QList<PTodoItem> &TodoModel::getConstItems(bool forProject) const
 {
     return forProject?mProjectItems:mItems;
@@ -21,6 +21,9 @@
 #include <QThread>
 #include <QMutex>
 #include <QAbstractListModel>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
 #include "syntaxermanager.h"
 #include "qsynedit/constants.h"
 
@@ -33,18 +36,49 @@ struct TodoItem {
 
 using PTodoItem = std::shared_ptr<TodoItem>;
 
+/*
+ * Todos found in each file, so unchanged files are not parsed again.
+ * Files on disk are checked by their modification time and size, files
+ * opened in editors by the hash of their contents.
+ * It's shared by the todo threads, so all methods are thread safe.
+ */
+class TodoIndex {
+public:
+    bool findByFileInfo(const QString& filename, const QDateTime& modified, qint64 size,
+                        QList<PTodoItem>& items);
+    bool findByContentHash(const QString& filename, const QByteArray& hash,
+                           QList<PTodoItem>& items);
+    void update(const QString& filename, const QDateTime& modified, qint64 size,
+                const QByteArray& hash, const QList<PTodoItem>& items);
+    void remove(const QString& filename);
+private:
+    struct FileEntry {
+        QDateTime modified;
+        qint64 size;
+        QByteArray contentHash;
+        QList<PTodoItem> items;
+    };
+    QHash<QString,FileEntry> mEntries;
+    QMutex mMutex;
+};
+
+using PTodoIndex = std::shared_ptr<TodoIndex>;
+
 class TodoModel : public QAbstractListModel {
     Q_OBJECT
 public:
     explicit TodoModel(QObject* parent=nullptr);
-    void addItem(const QString& filename, int lineNo,
-                 int ch, const QString& line);
+    // items must be sorted by line no
+    void setTodosForFile(const QString& filename, const QList<PTodoItem>& items);
     void removeTodosForFile(const QString& filename);
     void clear();
     void clear(bool forProject);
     PTodoItem getItem(const QModelIndex& index);
 private:
     QList<PTodoItem> &getItems(bool forProject);
+    // the range [first,last) of the items of the file
+    void findFileRange(const QList<PTodoItem>& items, const QString& filename,
+                       int& first, int& last) const;
     const QList<PTodoItem> &getConstItems(bool forProject) const;
 private:
     QList<PTodoItem> mItems;
@@ -66,21 +100,28 @@ class TodoThread: public QThread
 {
     Q_OBJECT
 public:
-    explicit TodoThread(const QString& filename, QObject* parent = nullptr);
-    explicit TodoThread(const QStringList& files, QObject* parent = nullptr);
+    explicit TodoThread(const QString& filename, PTodoIndex index, QObject* parent = nullptr);
+    explicit TodoThread(const QStringList& files, PTodoIndex index, QObject* parent = nullptr);
 signals:
     void parseStarted();
-    void parsingFile(const QString& fileName);
-    void todoFound(const QString& filename, int lineNo, int ch, const QString& line);
+    // todos of the parsed files, in batches
+    void todosFound(const QStringList& files, const QList<PTodoItem>& items);
     void parseFinished();
 private:
     void parseFile();
     void parseFiles();
     void doParseFile(const QString& filename, QSynedit::PSyntaxer syntaxer);
+    QList<PTodoItem> findTodos(const QString& filename, const QStringList& lines,
+                               QSynedit::PSyntaxer syntaxer);
+    void flushTodos(bool force);
 private:
     QString mFilename;
     QStringList mFiles;
     bool mParseFiles;
+    PTodoIndex mIndex;
+    QStringList mParsedFiles;
+    QList<PTodoItem> mFoundItems;
+    QElapsedTimer mFlushTimer;
 
     // QThread interface
 protected:
@@ -97,9 +138,13 @@ public:
     void parseFile(const QString& filename,bool isForProject);
     void parseFiles(const QStringList& files);
     bool parsing() const;
+    void removeFile(const QString& filename);
 
+private:
+    void connectThread(bool clearOnStart);
 private:
     TodoThread* mThread;
+    PTodoIndex mIndex;
 #if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
     QRecursiveMutex mMutex;
 #else
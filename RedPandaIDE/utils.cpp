@@ -12,6 +12,8 @@
 #include "parser/cppparser.h"
 #include "compiler/executablerunner.h"
 #include <QComboBox>
+#include <QCryptographicHash>
+#include <QDir>
 #ifdef Q_OS_WIN
 #include <QDesktopServices>
 #include <windows.h>
@@ -309,6 +311,8 @@ void resetCppParser(std::shared_ptr<CppParser> parser, int compilerSetIndex)
     parser->setEnabled(true);
     parser->setParseGlobalHeaders(true);
     parser->setParseLocalHeaders(true);
+    parser->setParallelParsing(pSettings->codeCompletion().parallelParsing());
+    parser->setIncrementalParsing(pSettings->codeCompletion().incrementalParsing());
     // Set options depending on the current compiler set
     if (compilerSetIndex<0) {
         compilerSetIndex=pSettings->compilerSets().defaultIndex();
@@ -334,7 +338,8 @@ void resetCppParser(std::shared_ptr<CppParser> parser, int compilerSetIndex)
             parser->addIncludePath(file);
         }
         // Set defines
-        for (QString define:compilerSet->defines(parser->language()==ParserLanguage::CPlusPlus)) {
+        QStringList defines = compilerSet->defines(parser->language()==ParserLanguage::CPlusPlus);
+        for (QString define:defines) {
             parser->addHardDefineByLine(define);
         }
 //        // add a Red Pand C++ 's own macro
@@ -344,6 +349,25 @@ void resetCppParser(std::shared_ptr<CppParser> parser, int compilerSetIndex)
         parser->addHardDefineByLine("#define __LINE__  1");
         parser->addHardDefineByLine("#define __DATE__  1");
         parser->addHardDefineByLine("#define __TIME__  1");
+
+        // symbols of system headers are cached on disk, for the same compiler set/language/defines/include paths
+        QStringList cacheKeys;
+        cacheKeys.append(compilerSet->name());
+        cacheKeys.append(compilerSet->CCompiler());
+        cacheKeys.append(compilerSet->cppCompiler());
+        cacheKeys.append(QString::number(parser->language()));
+        QStringList includePaths = parser->includePaths().values();
+        includePaths.sort();
+        cacheKeys.append(includePaths);
+        cacheKeys.append(defines);
+        QString cacheKey = cacheKeys.join("\n");
+        QString cacheDir = pSettings->dirs().config(Settings::Dirs::DataType::ParserCache);
+        QDir().mkpath(cacheDir);
+        parser->setSymbolCache(
+                    includeTrailingPathDelimiter(cacheDir)
+                    +QString::fromLatin1(QCryptographicHash::hash(cacheKey.toUtf8(),QCryptographicHash::Sha1).toHex())
+                    +".cache",
+                    cacheKey);
     }
     parser->parseHardDefines();
     pMainWindow->disconnect(parser.get(),
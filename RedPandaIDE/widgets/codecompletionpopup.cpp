@@ -28,6 +28,7 @@
 #include <QDebug>
 #include <QApplication>
 #include <QPainter>
+#include <algorithm>
 
 CodeCompletionPopup::CodeCompletionPopup(QWidget *parent) :
     QWidget(parent),
@@ -60,6 +61,9 @@ CodeCompletionPopup::CodeCompletionPopup(QWidget *parent) :
 
     mHideSymbolsStartWithTwoUnderline = false;
     mHideSymbolsStartWithUnderline = false;
+    mFilteredHideUnderline = false;
+    mFilteredHideTwoUnderline = false;
+    mFilterValid = false;
 }
 
 CodeCompletionPopup::~CodeCompletionPopup()
@@ -90,6 +94,7 @@ void CodeCompletionPopup::prepareSearch(
     QCursor oldCursor = cursor();
     setCursor(Qt::CursorShape::WaitCursor);
 
+    mFilterValid = false;
     mMemberPhrase = memberExpression.join("");
     mMemberOperator = memberOperator;
     switch(type) {
@@ -302,15 +307,75 @@ static bool nameComparator(PStatement statement1,PStatement statement2) {
     return statement1->command < statement2->command;
 }
 
-static bool defaultComparator(PStatement statement1,PStatement statement2) {
-    if (statement1->matchPosSpan!=statement2->matchPosSpan)
-        return statement1->matchPosSpan < statement2->matchPosSpan;
-    if (statement1->firstMatchLength != statement2->firstMatchLength)
-        return statement1->firstMatchLength > statement2->firstMatchLength;
-    if (statement1->matchPosTotal != statement2->matchPosTotal)
-        return statement1->matchPosTotal < statement2->matchPosTotal;
-    if (statement1->caseMatched != statement2->caseMatched)
-        return statement1->caseMatched > statement2->caseMatched;
+// Match the phrase against the command as a subsequence, taking the first
+// occurrence of each char. Scores are written to score; the matched runs are
+// appended to positions if it's not null.
+static bool matchCompletion(const QString& command, const QString& phrase, bool ignoreCase,
+                            CompletionMatchScore& score, QVector<StatementMatchPosition>* positions)
+{
+    int pos = 0;
+    int lastPos = -10;
+    int firstStart = -1;
+    int firstEnd = -1;
+    score.matchPosTotal = 0;
+    score.caseMatched = 0;
+    foreach (const QChar& ch, phrase) {
+        uint foldedCh = ignoreCase ? QChar::toCaseFolded(ch.unicode()) : ch.unicode();
+        while (pos<command.length()) {
+            if (command[pos] == ch)
+                break;
+            if (ignoreCase && QChar::toCaseFolded(command[pos].unicode()) == foldedCh)
+                break;
+            pos++;
+        }
+        if (pos>=command.length())
+            return false;
+        if (pos == lastPos+1) {
+            if (positions)
+                positions->last().end++;
+            if (firstEnd == pos)
+                firstEnd++;
+        } else {
+            if (positions)
+                positions->append(StatementMatchPosition{pos, pos+1});
+            if (firstStart<0) {
+                firstStart = pos;
+                firstEnd = pos+1;
+            }
+        }
+        if (ch==command[pos])
+            score.caseMatched++;
+        score.matchPosTotal += pos;
+        lastPos = pos;
+        pos+=1;
+    }
+    if (firstStart>=0) {
+        score.firstMatchLength = firstEnd - firstStart;
+        score.matchPosSpan = lastPos + 1 - firstStart;
+    } else {
+        score.firstMatchLength = 0;
+        score.matchPosSpan = 0;
+    }
+    return true;
+}
+
+// <0 if score1 is the better match, >0 if score2 is
+static int compareMatchScores(const CompletionMatchScore& score1, const CompletionMatchScore& score2)
+{
+    if (score1.matchPosSpan != score2.matchPosSpan)
+        return score1.matchPosSpan - score2.matchPosSpan;
+    if (score1.firstMatchLength != score2.firstMatchLength)
+        return score2.firstMatchLength - score1.firstMatchLength;
+    if (score1.matchPosTotal != score2.matchPosTotal)
+        return score1.matchPosTotal - score2.matchPosTotal;
+    return score2.caseMatched - score1.caseMatched;
+}
+
+static bool defaultComparator(const PStatement& statement1, const CompletionMatchScore& score1,
+                        const PStatement& statement2, const CompletionMatchScore& score2) {
+    int result = compareMatchScores(score1, score2);
+    if (result!=0)
+        return result<0;
     // Show user template first
     if (statement1->kind == StatementKind::skUserCodeSnippet) {
         if (statement2->kind != StatementKind::skUserCodeSnippet)
@@ -330,15 +395,11 @@ static bool defaultComparator(PStatement statement1,PStatement statement2) {
         return nameComparator(statement1,statement2);
 }
 
-static bool sortByScopeComparator(PStatement statement1,PStatement statement2){
-    if (statement1->matchPosSpan!=statement2->matchPosSpan)
-        return statement1->matchPosSpan < statement2->matchPosSpan;
-    if (statement1->firstMatchLength != statement2->firstMatchLength)
-        return statement1->firstMatchLength > statement2->firstMatchLength;
-    if (statement1->matchPosTotal != statement2->matchPosTotal)
-        return statement1->matchPosTotal < statement2->matchPosTotal;
-    if (statement1->caseMatched != statement2->caseMatched)
-        return statement1->caseMatched > statement2->caseMatched;
+static bool sortByScopeComparator(const PStatement& statement1, const CompletionMatchScore& score1,
+                        const PStatement& statement2, const CompletionMatchScore& score2) {
+    int result = compareMatchScores(score1, score2);
+    if (result!=0)
+        return result<0;
     // Show user template first
     if (statement1->kind == StatementKind::skUserCodeSnippet) {
         if (statement2->kind != StatementKind::skUserCodeSnippet)
@@ -374,15 +435,11 @@ static bool sortByScopeComparator(PStatement statement1,PStatement statement2){
         return nameComparator(statement1,statement2);
 }
 
-static bool sortWithUsageComparator(PStatement statement1,PStatement statement2) {
-    if (statement1->matchPosSpan!=statement2->matchPosSpan)
-        return statement1->matchPosSpan < statement2->matchPosSpan;
-    if (statement1->firstMatchLength != statement2->firstMatchLength)
-        return statement1->firstMatchLength > statement2->firstMatchLength;
-    if (statement1->matchPosTotal != statement2->matchPosTotal)
-        return statement1->matchPosTotal < statement2->matchPosTotal;
-    if (statement1->caseMatched != statement2->caseMatched)
-        return statement1->caseMatched > statement2->caseMatched;
+static bool sortWithUsageComparator(const PStatement& statement1, const CompletionMatchScore& score1,
+                        const PStatement& statement2, const CompletionMatchScore& score2) {
+    int result = compareMatchScores(score1, score2);
+    if (result!=0)
+        return result<0;
     // Show user template first
     if (statement1->kind == StatementKind::skUserCodeSnippet) {
         if (statement2->kind != StatementKind::skUserCodeSnippet)
@@ -406,15 +463,11 @@ static bool sortWithUsageComparator(PStatement statement1,PStatement statement2)
         return nameComparator(statement1,statement2);
 }
 
-static bool sortByScopeWithUsageComparator(PStatement statement1,PStatement statement2){
-    if (statement1->matchPosSpan!=statement2->matchPosSpan)
-        return statement1->matchPosSpan < statement2->matchPosSpan;
-    if (statement1->firstMatchLength != statement2->firstMatchLength)
-        return statement1->firstMatchLength > statement2->firstMatchLength;
-    if (statement1->matchPosTotal != statement2->matchPosTotal)
-        return statement1->matchPosTotal < statement2->matchPosTotal;
-    if (statement1->caseMatched != statement2->caseMatched)
-        return statement1->caseMatched > statement2->caseMatched;
+static bool sortByScopeWithUsageComparator(const PStatement& statement1, const CompletionMatchScore& score1,
+                        const PStatement& statement2, const CompletionMatchScore& score2) {
+    int result = compareMatchScores(score1, score2);
+    if (result!=0)
+        return result<0;
     // Show user template first
     if (statement1->kind == StatementKind::skUserCodeSnippet) {
         if (statement2->kind != StatementKind::skUserCodeSnippet)
@@ -459,86 +512,47 @@ void CodeCompletionPopup::filterList(const QString &member)
 {
     QMutexLocker locker(&mMutex);
     mCompletionStatementList.clear();
-//    if (!mParser)
-//        return;
-//    if (!mParser->enabled())
-//        return;
     //we don't need to freeze here since we use smart pointers
     //  and data have been retrieved from the parser
 
-    mCompletionStatementList.clear();
-    mCompletionStatementList.reserve(mFullCompletionStatementList.size());
     bool hideSymbolsTwoUnderline = mHideSymbolsStartWithTwoUnderline && !member.startsWith("__") ;
     bool hideSymbolsUnderline = mHideSymbolsStartWithUnderline && !member.startsWith("_") ;
-    int len = member.length();
-    foreach (const PStatement& statement, mFullCompletionStatementList) {
-
-        int matched = 0;
-        int caseMatched = 0;
-        QString command = statement->command;
-        int pos = 0;
-        int lastPos = -10;
-        int totalPos = 0;
-        statement->matchPositions.clear();
-        if (hideSymbolsTwoUnderline && statement->command.startsWith("__")) {
-            continue;
-        } else if (hideSymbolsUnderline && statement->command.startsWith("_")) {
-            continue;
-        } else {
-            foreach (const QChar& ch, member) {
-                if (mIgnoreCase)
-                    pos = command.indexOf(ch,pos,Qt::CaseInsensitive);
-                else
-                    pos = command.indexOf(ch,pos,Qt::CaseSensitive);
-                if (pos<0) {
-                    break;
-                }
-                if (pos == lastPos+1) {
-                    statement->matchPositions.last()->end++;
-                } else {
-                    PStatementMathPosition matchPosition=std::make_shared<StatementMatchPosition>();
-                    matchPosition->start = pos;
-                    matchPosition->end = pos+1;
-                    statement->matchPositions.append(matchPosition);
-                }
-                if (ch==command[pos])
-                    caseMatched++;
-                matched++;
-                totalPos += pos;
-                lastPos = pos;
-                pos+=1;
-            }
-        }
-
-        if (mIgnoreCase && matched== len) {
-            statement->caseMatched = caseMatched;
-            statement->matchPosTotal = totalPos;
-            if (member.length()>0) {
-                statement->firstMatchLength = statement->matchPositions.front()->end - statement->matchPositions.front()->start;
-                statement->matchPosSpan = statement->matchPositions.last()->end - statement->matchPositions.front()->start;
-            } else
-                statement->firstMatchLength = 0;
-            mCompletionStatementList.append(statement);
-        } else if (caseMatched == len) {
-            statement->caseMatched = caseMatched;
-            statement->matchPosTotal = totalPos;
-            if (member.length()>0) {
-                statement->firstMatchLength = statement->matchPositions.front()->end - statement->matchPositions.front()->start;
-                statement->matchPosSpan = statement->matchPositions.last()->end - statement->matchPositions.front()->start;
-            } else
-                statement->firstMatchLength = 0;
-            mCompletionStatementList.append(statement);
-        } else {
-            statement->matchPositions.clear();
-            statement->caseMatched = 0;
-            statement->matchPosTotal = 0;
-            statement->firstMatchLength = 0;
-            statement->matchPosSpan = 0;
-        }
+    // A statement matching the phrase also matches its prefixes, so when the
+    // phrase grows we only need to check the statements matched last time.
+    bool narrow = mFilterValid
+            && member.startsWith(mFilteredPhrase)
+            && hideSymbolsTwoUnderline == mFilteredHideTwoUnderline
+            && hideSymbolsUnderline == mFilteredHideUnderline;
+    mMatchScores.resize(mFullCompletionStatementList.size());
+    QVector<int> matchedIndexes;
+    matchedIndexes.reserve(narrow?mMatchedIndexes.size():mFullCompletionStatementList.size());
+    auto checkStatement = [&](int i) {
+        const PStatement& statement = mFullCompletionStatementList[i];
+        if (hideSymbolsTwoUnderline && statement->command.startsWith("__"))
+            return;
+        if (hideSymbolsUnderline && statement->command.startsWith("_"))
+            return;
+        if (matchCompletion(statement->command, member, mIgnoreCase, mMatchScores[i], nullptr))
+            matchedIndexes.append(i);
+    };
+    if (narrow) {
+        foreach (int i, mMatchedIndexes)
+            checkStatement(i);
+    } else {
+        for (int i=0;i<mFullCompletionStatementList.size();i++)
+            checkStatement(i);
     }
+    mMatchedIndexes.swap(matchedIndexes);
+    mFilteredPhrase = member;
+    mFilteredHideTwoUnderline = hideSymbolsTwoUnderline;
+    mFilteredHideUnderline = hideSymbolsUnderline;
+    mFilterValid = true;
+    mModel->setMatchPhrase(member, mIgnoreCase);
+
     if (mRecordUsage) {
         int usageCount;
-        foreach (const PStatement& statement,mCompletionStatementList) {
+        foreach (int i, mMatchedIndexes) {
+            const PStatement& statement = mFullCompletionStatementList[i];
             if (statement->usageCount == -1) {
                 PSymbolUsage usage = pMainWindow->symbolUsageManager()->findUsage(statement->fullName);
                 if (usage) {
@@ -549,25 +563,27 @@ void CodeCompletionPopup::filterList(const QString &member)
                 statement->usageCount = usageCount;
             }
         }
-        if (mSortByScope) {
-            std::sort(mCompletionStatementList.begin(),
-                      mCompletionStatementList.end(),
-                      sortByScopeWithUsageComparator);
-        } else {
-            std::sort(mCompletionStatementList.begin(),
-                      mCompletionStatementList.end(),
-                      sortWithUsageComparator);
-        }
-    } else if (mSortByScope) {
-        std::sort(mCompletionStatementList.begin(),
-                  mCompletionStatementList.end(),
-                  sortByScopeComparator);
+    }
+    bool (*comparator)(const PStatement&, const CompletionMatchScore&,
+                       const PStatement&, const CompletionMatchScore&);
+    if (mRecordUsage) {
+        comparator = mSortByScope ? sortByScopeWithUsageComparator : sortWithUsageComparator;
     } else {
-        std::sort(mCompletionStatementList.begin(),
-                  mCompletionStatementList.end(),
-                  defaultComparator);
+        comparator = mSortByScope ? sortByScopeComparator : defaultComparator;
     }
-    //    }
+    // only the best mShowCount matches are sorted, the others follow them
+    QVector<int> sortedIndexes = mMatchedIndexes;
+    int count = std::min(sortedIndexes.size(), mShowCount);
+    std::partial_sort(sortedIndexes.begin(), sortedIndexes.begin()+count, sortedIndexes.end(),
+                      [this,comparator](int i1, int i2) {
+        return comparator(mFullCompletionStatementList[i1], mMatchScores[i1],
+                          mFullCompletionStatementList[i2], mMatchScores[i2]);
+    });
+    // partial_sort shuffles the rest, put them back in the order they were found
+    std::sort(sortedIndexes.begin()+count, sortedIndexes.end());
+    mCompletionStatementList.reserve(sortedIndexes.size());
+    foreach (int i, sortedIndexes)
+        mCompletionStatementList.append(mFullCompletionStatementList[i]);
 }
 
 void CodeCompletionPopup::getKeywordCompletionFor(const QSet<QString> &customKeywords)
@@ -1149,6 +1165,7 @@ bool CodeCompletionPopup::ignoreCase() const
 void CodeCompletionPopup::setIgnoreCase(bool newIgnoreCase)
 {
     mIgnoreCase = newIgnoreCase;
+    mFilterValid = false;
 }
 
 bool CodeCompletionPopup::showCodeSnippets() const
@@ -1206,10 +1223,10 @@ void CodeCompletionPopup::hideEvent(QHideEvent *event)
     QMutexLocker locker(&mMutex);
     mListView->setKeypressedCallback(nullptr);
     mCompletionStatementList.clear();
-//    foreach (PStatement statement, mFullCompletionStatementList) {
-//        statement->matchPositions.clear();
-//    }
     mFullCompletionStatementList.clear();
+    mMatchScores.clear();
+    mMatchedIndexes.clear();
+    mFilterValid = false;
     mIncludedFiles.clear();
     mUsings.clear();
     mAddedStatements.clear();
@@ -1230,7 +1247,8 @@ bool CodeCompletionPopup::event(QEvent *event)
 
 CodeCompletionListModel::CodeCompletionListModel(const StatementList *statements, QObject *parent):
     QAbstractListModel(parent),
-    mStatements(statements)
+    mStatements(statements),
+    mIgnoreCase(false)
 {
 
 }
@@ -1278,6 +1296,25 @@ QPixmap CodeCompletionListModel::statementIcon(const QModelIndex &index) const
     return pIconsManager->getPixmapForStatement(statement);
 }
 
+QVector<StatementMatchPosition> CodeCompletionListModel::matchPositions(const QModelIndex &index) const
+{
+    QVector<StatementMatchPosition> positions;
+    if (!index.isValid())
+        return positions;
+    if (index.row()>=mStatements->count())
+        return positions;
+    CompletionMatchScore score;
+    if (!matchCompletion(mStatements->at(index.row())->command, mMatchPhrase, mIgnoreCase, score, &positions))
+        positions.clear();
+    return positions;
+}
+
+void CodeCompletionListModel::setMatchPhrase(const QString &phrase, bool ignoreCase)
+{
+    mMatchPhrase = phrase;
+    mIgnoreCase = ignoreCase;
+}
+
 void CodeCompletionListModel::notifyUpdated()
 {
     beginResetModel();
@@ -1307,18 +1344,18 @@ void CodeCompletionListItemDelegate::paint(QPainter *painter, const QStyleOption
         QString text = statement->command;
         int pos=0;
         int y=option.rect.bottom()-painter->fontMetrics().descent();
-        foreach (const PStatementMathPosition& matchPosition, statement->matchPositions) {
-            if (pos<matchPosition->start) {
-                QString t = text.mid(pos,matchPosition->start-pos);
+        foreach (const StatementMatchPosition& matchPosition, mModel->matchPositions(index)) {
+            if (pos<matchPosition.start) {
+                QString t = text.mid(pos,matchPosition.start-pos);
                 painter->setPen(normalColor);
                 painter->drawText(x,y,t);
                 x+=painter->fontMetrics().horizontalAdvance(t);
             }
-            QString t = text.mid(matchPosition->start, matchPosition->end-matchPosition->start);
+            QString t = text.mid(matchPosition.start, matchPosition.end-matchPosition.start);
             painter->setPen(mMatchedColor);
             painter->drawText(x,y,t);
             x+=painter->fontMetrics().horizontalAdvance(t);
-            pos=matchPosition->end;
+            pos=matchPosition.end;
         }
         if (pos<text.length()) {
             QString t = text.mid(pos,text.length()-pos);
@@ -31,10 +31,23 @@ public:
     QVariant data(const QModelIndex &index, int role) const override;
     PStatement statement(const QModelIndex &index) const;
     QPixmap statementIcon(const QModelIndex &index) const;
+    QVector<StatementMatchPosition> matchPositions(const QModelIndex &index) const;
+    void setMatchPhrase(const QString& phrase, bool ignoreCase);
     void notifyUpdated();
 
 private:
     const StatementList* mStatements;
+    QString mMatchPhrase;
+    bool mIgnoreCase;
+};
+
+// how well a statement matches the phrase typed, smaller is better
+// except firstMatchLength and caseMatched
+struct CompletionMatchScore {
+    int matchPosSpan; // distance between the first match pos and the last match pos;
+    int firstMatchLength; // length of first match;
+    int matchPosTotal; // total of matched positions
+    int caseMatched; // if match with case
 };
 
 enum class CodeCompletionType {
@@ -168,6 +181,12 @@ private:
     //QList<PStatement> mCodeInsStatements; //temporary (user code template) statements created when show code suggestion
     StatementList mFullCompletionStatementList;
     StatementList mCompletionStatementList;
+    QVector<CompletionMatchScore> mMatchScores; // indexed like mFullCompletionStatementList
+    QVector<int> mMatchedIndexes; // statements in mFullCompletionStatementList matching mFilteredPhrase
+    QString mFilteredPhrase;
+    bool mFilteredHideUnderline;
+    bool mFilteredHideTwoUnderline;
+    bool mFilterValid;
     QSet<QString> mIncludedFiles;
     QSet<QString> mUsings;
     QSet<QString> mAddedStatements;
@@ -101,6 +101,17 @@ void IssuesModel::addIssue(PCompileIssue issue)
     endInsertRows();
 }
 
+void IssuesModel::addIssues(const QList<PCompileIssue> &issues)
+{
+    if (issues.isEmpty())
+        return;
+    beginInsertRows(QModelIndex(),mIssues.size(),mIssues.size()+issues.count()-1);
+    foreach (const PCompileIssue& issue, issues) {
+        mIssues.push_back(issue);
+    }
+    endInsertRows();
+}
+
 void IssuesModel::clearIssues()
 {
     QSet<QString> issueFiles;
@@ -155,6 +166,11 @@ void IssuesTable::addIssue(PCompileIssue issue)
     mModel->addIssue(issue);
 }
 
+void IssuesTable::addIssues(const QList<PCompileIssue> &issues)
+{
+    mModel->addIssues(issues);
+}
+
 PCompileIssue IssuesTable::issue(const QModelIndex &index)
 {
     if (!index.isValid())
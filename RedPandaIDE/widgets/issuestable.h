@@ -30,6 +30,7 @@ public:
 
 public slots:
     void addIssue(PCompileIssue issue);
+    void addIssues(const QList<PCompileIssue>& issues);
     void clearIssues();
 
     void setErrorColor(QColor color);
@@ -68,6 +69,7 @@ public:
 
 public slots:
     void addIssue(PCompileIssue issue);
+    void addIssues(const QList<PCompileIssue>& issues);
 
     PCompileIssue issue(const QModelIndex& index);
     PCompileIssue issue(const int row);
@@ -25,17 +25,21 @@
 #include "../project.h"
 #include "../settings.h"
 #include "../systemconsts.h"
+#include "../filesearcher.h"
 #include <QMessageBox>
 #include <QDebug>
 #include <QProgressDialog>
 #include <QCompleter>
 #include <QStack>
 #include <QFileDialog>
+#include <algorithm>
 
 
 SearchInFileDialog::SearchInFileDialog(QWidget *parent) :
     QDialog(parent),
-    ui(new Ui::SearchInFileDialog)
+    ui(new Ui::SearchInFileDialog),
+    mFileSearcher(nullptr),
+    mProgressDlg(nullptr)
 {
     setWindowFlag(Qt::WindowContextHelpButtonHint,false);
     ui->setupUi(this);
@@ -48,6 +52,10 @@ SearchInFileDialog::SearchInFileDialog(QWidget *parent) :
 
 SearchInFileDialog::~SearchInFileDialog()
 {
+    FileSearcher* searcher = mFileSearcher;
+    cancelFileSearch();
+    if (searcher)
+        searcher->wait();
     delete ui;
 }
 
@@ -166,15 +174,6 @@ void SearchInFileDialog::doSearch(bool replace)
             ui->txtFilters->setText("*.*");
         }
         QDir rootDir(ui->txtFolder->text());
-        // loop through editors, add results to message control
-        QProgressDialog progressDlg(
-                    tr("Searching..."),
-                    tr("Abort"),
-                    0,
-                    1,
-                    pMainWindow);
-
-        progressDlg.setWindowModality(Qt::WindowModal);
         QStack<QDir> dirs;
         QSet<QString> searched;
         QList<QFileInfo> files;
@@ -197,53 +196,17 @@ void SearchInFileDialog::doSearch(bool replace)
                 files.append(entry);
             }
         }
-        progressDlg.setMaximum(files.count());
-        int i=0;
+        FileSearcher* searcher = new FileSearcher(keyword, mSearchOptions);
         foreach (const QFileInfo &info, files) {
             QString curFilename =  info.absoluteFilePath();
-            i++;
-            progressDlg.setValue(i);
-            progressDlg.setLabelText(tr("Searching...")+"<br/>"+curFilename);
-
-            if (progressDlg.wasCanceled())
-                break;
             Editor * e = pMainWindow->editorList()->getOpenedEditorByFilename(curFilename);
             if (e) {
-                fileSearched++;
-                PSearchResultTreeItem parentItem = batchFindInEditor(
-                            e,
-                            e->filename(),
-                            keyword);
-                int t = parentItem->results.size();
-                findCount+=t;
-                if (t>0) {
-                    fileHitted++;
-                    results->results.append(parentItem);
-                }
-            } else if (fileExists(curFilename)) {
-                QSynedit::QSynEdit editor;
-                QByteArray realEncoding;
-                try{
-                    editor.document()->loadFromFile(curFilename,ENCODING_AUTO_DETECT, realEncoding);
-                } catch (QSynedit::BinaryFileError e) {
-                    continue;
-                } catch (FileError e) {
-                    continue;
-                }
-                fileSearched++;
-                PSearchResultTreeItem parentItem = batchFindInEditor(
-                            &editor,
-                            curFilename,
-                            keyword);
-                int t = parentItem->results.size();
-                findCount+=t;
-                if (t>0) {
-                    fileHitted++;
-                    results->results.append(parentItem);
-                }
+                searcher->addOpenedFile(e->filename(), e->document()->snapshot()->contents());
+            } else {
+                searcher->addFile(curFilename, ENCODING_AUTO_DETECT);
             }
         }
-        pMainWindow->searchResultModel()->notifySearchResultsUpdated();
+        startFileSearch(searcher, results);
     } else if (ui->rbCurrentFile->isChecked()) {
         PSearchResults results = pMainWindow->searchResultModel()->addSearchResults(
                     keyword,
@@ -274,68 +237,99 @@ void SearchInFileDialog::doSearch(bool replace)
                     SearchFileScope::wholeProject
                     );
         QByteArray projectEncoding = pMainWindow->project()->options().encoding;
-        QProgressDialog progressDlg(
-                    tr("Searching..."),
-                    tr("Abort"),
-                    0,
-                    pMainWindow->project()->unitList().count(),
-                    pMainWindow);
-
-        progressDlg.setWindowModality(Qt::WindowModal);
-        int i=0;
+        FileSearcher* searcher = new FileSearcher(keyword, mSearchOptions);
         foreach (PProjectUnit unit, pMainWindow->project()->unitList()) {
-            i++;
-            progressDlg.setValue(i);
-            progressDlg.setLabelText(tr("Searching...")+"<br/>"+unit->fileName());
-
-            if (progressDlg.wasCanceled())
-                break;
             Editor * e = pMainWindow->project()->unitEditor(unit);
-            QString curFilename =  unit->fileName();
             if (e) {
-                fileSearched++;
-                PSearchResultTreeItem parentItem = batchFindInEditor(
-                            e,
-                            e->filename(),
-                            keyword);
-                int t = parentItem->results.size();
-                findCount+=t;
-                if (t>0) {
-                    fileHitted++;
-                    results->results.append(parentItem);
-                }
-            } else if (fileExists(curFilename)) {
-                QSynedit::QSynEdit editor;
+                searcher->addOpenedFile(e->filename(), e->document()->snapshot()->contents());
+            } else {
                 QByteArray encoding=unit->encoding();
                 if (encoding==ENCODING_PROJECT)
                     encoding = projectEncoding;
-                QByteArray realEncoding;
-                try {
-                    editor.document()->loadFromFile(curFilename,encoding, realEncoding);
-                } catch (QSynedit::BinaryFileError e) {
-                    continue;
-                } catch (FileError e) {
-                    continue;
-                }
-                fileSearched++;
-                PSearchResultTreeItem parentItem = batchFindInEditor(
-                            &editor,
-                            curFilename,
-                            keyword);
-                int t = parentItem->results.size();
-                findCount+=t;
-                if (t>0) {
-                    fileHitted++;
-                    results->results.append(parentItem);
-                }
+                searcher->addFile(unit->fileName(), encoding);
             }
         }
-        pMainWindow->searchResultModel()->notifySearchResultsUpdated();
+        startFileSearch(searcher, results);
     }
     pMainWindow->showSearchPanel(replace);
 
 }
 
+void SearchInFileDialog::startFileSearch(FileSearcher *searcher, PSearchResults results)
+{
+    cancelFileSearch();
+    mFileSearcher = searcher;
+    mFileSearchResults = results;
+    connect(searcher, &FileSearcher::searchProgress,
+            this, &SearchInFileDialog::onFileSearchProgress);
+    connect(searcher, &QThread::finished,
+            this, &SearchInFileDialog::onFileSearchFinished);
+    connect(searcher, &QThread::finished,
+            searcher, &QObject::deleteLater);
+    // not modal, the ide can be used while searching
+    mProgressDlg = new QProgressDialog(
+                tr("Searching..."),
+                tr("Abort"),
+                0,
+                searcher->fileCount(),
+                pMainWindow);
+    mProgressDlg->setWindowModality(Qt::NonModal);
+    connect(mProgressDlg, &QProgressDialog::canceled,
+            searcher, &FileSearcher::cancel);
+    pMainWindow->searchResultModel()->notifySearchResultsUpdated();
+    searcher->start();
+}
+
+void SearchInFileDialog::cancelFileSearch()
+{
+    if (!mFileSearcher)
+        return;
+    disconnect(mFileSearcher, nullptr, this, nullptr);
+    mFileSearcher->cancel();
+    mFileSearcher = nullptr;
+    mFileSearchResults.reset();
+    if (mProgressDlg) {
+        mProgressDlg->deleteLater();
+        mProgressDlg = nullptr;
+    }
+}
+
+void SearchInFileDialog::takeFileSearchResults()
+{
+    if (!mFileSearcher)
+        return;
+    QList<PSearchResultTreeItem> items = mFileSearcher->takeFoundItems();
+    if (items.isEmpty())
+        return;
+    // files are searched in no particular order, keep them sorted by name
+    foreach (const PSearchResultTreeItem& item, items) {
+        auto it = std::lower_bound(
+                    mFileSearchResults->results.begin(),
+                    mFileSearchResults->results.end(),
+                    item,
+                    [](const PSearchResultTreeItem& item1, const PSearchResultTreeItem& item2) {
+            return QString::compare(item1->filename, item2->filename, PATH_SENSITIVITY)<0;
+        });
+        mFileSearchResults->results.insert(it, item);
+    }
+    pMainWindow->searchResultModel()->notifySearchResultsUpdated();
+}
+
+void SearchInFileDialog::onFileSearchProgress(int searchedCount, int fileCount)
+{
+    takeFileSearchResults();
+    if (mProgressDlg) {
+        mProgressDlg->setMaximum(fileCount);
+        mProgressDlg->setValue(searchedCount);
+    }
+}
+
+void SearchInFileDialog::onFileSearchFinished()
+{
+    takeFileSearchResults();
+    cancelFileSearch();
+}
+
 int SearchInFileDialog::execute(QSynedit::QSynEdit *editor, const QString &sSearch, const QString &sReplace,
                           QSynedit::SearchMathedProc matchCallback,
                           QSynedit::SearchConfirmAroundProc confirmAroundCallback)
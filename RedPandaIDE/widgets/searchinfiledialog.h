@@ -26,8 +26,11 @@ class SearchInFileDialog;
 }
 
 struct SearchResultTreeItem;
+struct SearchResults;
 class QTabBar;
+class QProgressDialog;
 class Editor;
+class FileSearcher;
 class SearchInFileDialog : public QDialog
 {
     Q_OBJECT
@@ -51,8 +54,14 @@ private slots:
 
    void on_btnChangeFolder_clicked();
 
+   void onFileSearchProgress(int searchedCount, int fileCount);
+   void onFileSearchFinished();
+
 private:
    void doSearch(bool replace);
+   void startFileSearch(FileSearcher* searcher, std::shared_ptr<SearchResults> results);
+   void cancelFileSearch();
+   void takeFileSearchResults();
    int execute(QSynedit::QSynEdit* editor, const QString& sSearch,
                const QString& sReplace,
                QSynedit::SearchMathedProc matchCallback = nullptr,
@@ -63,6 +72,9 @@ private:
     QSynedit::SearchOptions mSearchOptions;
     QSynedit::PSynSearchBase mBasicSearchEngine;
     QSynedit::PSynSearchBase mRegexSearchEngine;
+    FileSearcher* mFileSearcher;
+    std::shared_ptr<SearchResults> mFileSearchResults;
+    QProgressDialog* mProgressDlg;
 
     // QWidget interface
 protected:
@@ -21,6 +21,12 @@ APP_VERSION = 2.25
 RedPandaIDE.depends = astyle consolepauser qsynedit
 qsynedit.depends = redpanda_qt_utils
 
+# micro-benchmarks, not installed
+CONFIG(benchmarks) {
+    SUBDIRS += benchmarks
+    benchmarks.depends = qsynedit redpanda_qt_utils
+}
+
 win32: {
 SUBDIRS += \
 	redpanda-win-git-askpass
@@ -0,0 +1,44 @@
+# settings shared by the benchmarks, they link to the libs built by Red_Panda_CPP.pro
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+contains(QMAKE_HOST.arch, x86_64):{
+    DEFINES += ARCH_X86_64=1
+} else: {
+    contains(QMAKE_HOST.arch, i386):{
+        DEFINES += ARCH_X86=1
+    }
+    contains(QMAKE_HOST.arch, i686):{
+        DEFINES += ARCH_X86=1
+    }
+}
+
+win32: {
+DEFINES += _WIN32_WINNT=0x0601
+}
+
+msvc {
+    DEFINES += NOMINMAX
+}
+
+CONFIG(debug_and_release_target) {
+    CONFIG(debug, debug|release) {
+        OBJ_OUT_PWD = debug/
+    }
+    CONFIG(release, debug|release) {
+        OBJ_OUT_PWD = release/
+    }
+}
+
+INCLUDEPATH += $$PWD/../libs/qsynedit $$PWD/../libs/redpanda_qt_utils
+
+gcc | clang {
+LIBS += $$OUT_PWD/../../libs/qsynedit/$${OBJ_OUT_PWD}libqsynedit.a \
+        $$OUT_PWD/../../libs/redpanda_qt_utils/$${OBJ_OUT_PWD}libredpanda_qt_utils.a
+}
+msvc {
+LIBS += $$OUT_PWD/../../libs/qsynedit/$${OBJ_OUT_PWD}qsynedit.lib \
+        $$OUT_PWD/../../libs/redpanda_qt_utils/$${OBJ_OUT_PWD}redpanda_qt_utils.lib
+LIBS += advapi32.lib user32.lib
+}
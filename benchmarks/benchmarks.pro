@@ -0,0 +1,9 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    documentload \
+    gdbmiparser \
+    parsercache \
+    parsertokens \
+    searcher \
+    syntaxscan
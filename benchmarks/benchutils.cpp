@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "benchutils.h"
+#include <QProcess>
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+static QByteArray runCompiler(const QString& compiler, const QStringList& arguments, bool readStdErr)
+{
+    QProcess process;
+    process.setProgram(compiler);
+    process.setArguments(arguments);
+    process.start();
+    process.closeWriteChannel();
+    process.waitForFinished(30000);
+    return readStdErr?process.readAllStandardError():process.readAllStandardOutput();
+}
+
+QStringList compilerIncludeDirs(const QString& compiler)
+{
+    QStringList result;
+    QByteArray output = runCompiler(compiler, {"-xc++", "-E", "-v", "-"}, true);
+    bool inList = false;
+    foreach (const QByteArray& line, output.split('\n')) {
+        QString s = QString::fromLocal8Bit(line).trimmed();
+        if (s.startsWith("#include <...> search starts here:")) {
+            inList = true;
+        } else if (s.startsWith("End of search list.")) {
+            break;
+        } else if (inList && !s.isEmpty()) {
+            result.append(s);
+        }
+    }
+    return result;
+}
+
+QStringList compilerDefines(const QString& compiler)
+{
+    QStringList result;
+    QByteArray output = runCompiler(compiler, {"-xc++", "-dM", "-E", "-"}, false);
+    foreach (const QByteArray& line, output.split('\n')) {
+        QString s = QString::fromLocal8Bit(line).trimmed();
+        if (s.startsWith("#define"))
+            result.append(s);
+    }
+    return result;
+}
+
+qint64 peakMemoryUsage()
+{
+#ifdef Q_OS_WIN
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return -1;
+    return counters.PeakWorkingSetSize / 1024;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage)!=0)
+        return -1;
+#ifdef Q_OS_MACOS
+    return usage.ru_maxrss / 1024; // in bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef BENCHUTILS_H
+#define BENCHUTILS_H
+
+#include <QStringList>
+
+// include dirs of a gcc compatible c++ compiler, in search order
+QStringList compilerIncludeDirs(const QString& compiler);
+
+// predefined macros of a gcc compatible c++ compiler, as "#define" lines
+QStringList compilerDefines(const QString& compiler);
+
+// peak resident memory of this process in KB, -1 if unknown
+qint64 peakMemoryUsage();
+
+#endif // BENCHUTILS_H
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Load time of Document::loadFromFile on large files.
+ *
+ * Usage: documentload [size in MB ...]
+ *   size: sizes of the generated files, default 1 50 200
+ *
+ * Each size is tested with an ascii file and an utf-8 file. The files are
+ * written just before they are loaded, so they are read from the page cache.
+ */
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include "qsynedit/document.h"
+
+static bool generateFile(const QString& fileName, qint64 size, bool ascii)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate))
+        return false;
+    QByteArray block;
+    for (int i=0;block.size()<1024*1024;i++) {
+        block += "2022-10-01 12:00:" + QByteArray::number(i%60).rightJustified(2,'0')
+                + " [info] worker " + QByteArray::number(i%16)
+                + (ascii?" processed request ":" \xe5\xa4\x84\xe7\x90\x86\xe4\xba\x86\xe8\xaf\xb7\xe6\xb1\x82 ")
+                + QByteArray::number(i) + "\n";
+    }
+    for (qint64 written=0;written<size;written+=block.size()) {
+        if (file.write(block)!=block.size())
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    QList<int> sizes;
+    for (int i=1;i<argc;i++)
+        sizes.append(std::max(1,atoi(argv[i])));
+    if (sizes.isEmpty())
+        sizes = {1, 50, 200};
+
+    QTemporaryDir dir;
+    foreach (int size, sizes) {
+        for (int kind=0;kind<2;kind++) {
+            bool ascii = (kind==0);
+            QString fileName = dir.filePath("document.txt");
+            if (!generateFile(fileName, size * 1024LL * 1024, ascii)) {
+                out<<"Can't write "<<fileName<<"\n";
+                return 1;
+            }
+            qint64 fileSize = QFileInfo(fileName).size();
+            QSynedit::Document document(QFont(), QFont());
+            QByteArray realEncoding;
+            QElapsedTimer timer;
+            timer.start();
+            try {
+                document.loadFromFile(fileName, ENCODING_AUTO_DETECT, realEncoding);
+            } catch (const FileError& e) {
+                out<<e.reason()<<"\n";
+                return 1;
+            }
+            qint64 time = timer.elapsed();
+            out<<QString("%1 MB %2: %3 ms, %4 lines, %5, %6 MB/s\n")
+                 .arg(size, 4).arg(ascii?"ascii":"utf-8")
+                 .arg(time).arg(document.count())
+                 .arg(QString(realEncoding))
+                 .arg(time>0?fileSize / 1024.0 / 1024 * 1000 / time:0.0, 0, 'f', 1);
+            QFile::remove(fileName);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,12 @@
+QT += core
+
+include(../benchmarks.pri)
+
+INCLUDEPATH += ../../RedPandaIDE
+
+SOURCES += \
+    main.cpp \
+    ../../RedPandaIDE/gdbmiresultparser.cpp
+
+HEADERS += \
+    ../../RedPandaIDE/gdbmiresultparser.h
@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Parse time of large GDB/MI result records.
+ *
+ * Usage: gdbmiparser [transcript ...]
+ *   transcript: gdb/mi log. A line starting with "-" (optionally after a
+ *               token) is a command, a "^done," line is the result of the
+ *               last command.
+ *
+ * Only the ParseObject/ParseValue api is used, so the benchmark also builds
+ * against older versions of the parser.
+ */
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <cctype>
+#include "gdbmiresultparser.h"
+
+using ParseObject = GDBMIResultParser::ParseObject;
+using ParseValue = GDBMIResultParser::ParseValue;
+
+struct Record {
+    QString command;
+    QByteArray result; // the record after "^done,"
+};
+
+// -var-list-children of a std::vector<std::string> with count elements
+static Record varListChildren(int count)
+{
+    QByteArray record = "numchild=\"" + QByteArray::number(count) + "\",children=[";
+    for (int i=0;i<count;i++) {
+        if (i>0)
+            record += ',';
+        QByteArray index = QByteArray::number(i);
+        record += "child={name=\"var1.[" + index + "]\",exp=\"[" + index + "]\",numchild=\"0\","
+                "value=\"\\\"item " + index + " with a \\\\\\\"quoted\\\\\\\" part\\\"\","
+                "type=\"std::__cxx11::basic_string<char, std::char_traits<char>, std::allocator<char> >\","
+                "thread-id=\"1\"}";
+    }
+    record += "],has_more=\"0\"";
+    return Record{"-var-list-children", record};
+}
+
+static Record dataDisassemble(int count)
+{
+    QByteArray record = "asm_insns=[";
+    for (int i=0;i<count;i++) {
+        if (i>0)
+            record += ',';
+        record += "{address=\"0x" + QByteArray::number(0x401136 + i*4, 16).rightJustified(16,'0') + "\","
+                "func-name=\"main\",offset=\"" + QByteArray::number(i*4) + "\","
+                "inst=\"mov    -0x" + QByteArray::number(i%64, 16) + "(%rbp),%eax\"}";
+    }
+    record += ']';
+    return Record{"-data-disassemble", record};
+}
+
+static QList<Record> readTranscript(const QString& fileName)
+{
+    QList<Record> records;
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly))
+        return records;
+    QString command;
+    while (!file.atEnd()) {
+        QByteArray line = file.readLine().trimmed();
+        int i = 0;
+        while (i<line.length() && isdigit(line[i]))
+            i++;
+        if (i<line.length() && line[i]=='-') {
+            int end = line.indexOf(' ', i);
+            if (end<0)
+                end = line.length();
+            command = QString::fromUtf8(line.mid(i, end-i));
+        } else if (line.mid(i).startsWith("^done,")) {
+            records.append(Record{command, line.mid(i+6)});
+        }
+    }
+    return records;
+}
+
+// read the values like the DebugReader handlers do
+static qint64 readValues(GDBMIResultType type, const ParseObject& multiValues)
+{
+    qint64 total = 0;
+    if (type == GDBMIResultType::ListVarChildren) {
+        QList<ParseValue> children = multiValues["children"].array();
+        foreach (const ParseValue& child, children) {
+            ParseObject childObj = child.object();
+            total += childObj["name"].value().length();
+            total += childObj["exp"].value().length();
+            total += childObj["numchild"].intValue(0);
+            total += childObj["value"].value().length();
+            total += childObj["type"].value().length();
+        }
+    } else if (type == GDBMIResultType::Disassembly) {
+        QList<ParseValue> insns = multiValues["asm_insns"].array();
+        foreach (const ParseValue& insn, insns) {
+            ParseObject obj = insn.object();
+            bool ok;
+            total += obj["address"].hexValue(ok) & 1;
+            total += obj["func-name"].value().length();
+            total += obj["offset"].intValue(0);
+            total += obj["inst"].value().length();
+        }
+    }
+    return total;
+}
+
+static void run(QTextStream& out, const QString& name, const QList<Record>& records, int runs)
+{
+    qint64 bytes = 0;
+    foreach (const Record& record, records)
+        bytes += record.result.length();
+    QElapsedTimer timer;
+    qint64 parseTime = 0;
+    qint64 readTime = 0;
+    qint64 checksum = 0;
+    for (int i=0;i<runs;i++) {
+        foreach (const Record& record, records) {
+            GDBMIResultParser parser;
+            GDBMIResultType type;
+            ParseObject multiValues;
+            timer.start();
+            bool ok = parser.parse(record.result, record.command, type, multiValues);
+            parseTime += timer.nsecsElapsed();
+            if (!ok)
+                continue;
+            timer.start();
+            checksum += readValues(type, multiValues);
+            readTime += timer.nsecsElapsed();
+        }
+    }
+    out<<QString("%1: %2 records, %3 KB, parse %4 ms, read %5 ms (%6)\n")
+         .arg(name).arg(records.count()).arg(bytes / 1024)
+         .arg(parseTime / 1000000.0 / runs, 0, 'f', 2)
+         .arg(readTime / 1000000.0 / runs, 0, 'f', 2)
+         .arg(checksum);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+    const int runs = 10;
+
+    run(out, "-var-list-children 10000", {varListChildren(10000)}, runs);
+    run(out, "-data-disassemble 20000", {dataDisassemble(20000)}, runs);
+    for (int i=1;i<argc;i++) {
+        QString fileName = QString::fromLocal8Bit(argv[i]);
+        QList<Record> records = readTranscript(fileName);
+        if (records.isEmpty()) {
+            out<<"No result records in "<<fileName<<"\n";
+            continue;
+        }
+        run(out, fileName, records, runs);
+    }
+    return 0;
+}
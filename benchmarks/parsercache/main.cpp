@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Cold vs. warm parse time of a file including <bits/stdc++.h>, with the
+ * on-disk symbol cache of system headers.
+ *
+ * Usage: parsercache [compiler [warm runs]]
+ *   compiler: gcc compatible c++ compiler used to get the include dirs and
+ *             the predefined macros, default "g++"
+ */
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include "parser/cppparser.h"
+#include "parser/parserutils.h"
+#include "../benchutils.h"
+
+struct ParseResult {
+    qint64 time;
+    int scannedFiles;
+    int globalStatements;
+};
+
+static ParseResult parseOnce(const QString& fileName,
+                             const QStringList& includeDirs,
+                             const QStringList& defines,
+                             const QString& cacheFile,
+                             const QString& cacheKey)
+{
+    // configured like resetCppParser()
+    CppParser parser;
+    parser.resetParser();
+    parser.setEnabled(true);
+    parser.setParseGlobalHeaders(true);
+    parser.setParseLocalHeaders(true);
+    parser.clearIncludePaths();
+    foreach (const QString& dir, includeDirs)
+        parser.addIncludePath(dir);
+    foreach (const QString& define, defines)
+        parser.addHardDefineByLine(define);
+    parser.setSymbolCache(cacheFile, cacheKey);
+    parser.parseHardDefines();
+
+    QElapsedTimer timer;
+    timer.start();
+    parser.parseFile(fileName, false);
+    ParseResult result;
+    result.time = timer.elapsed();
+    result.scannedFiles = parser.scannedFiles().count();
+    result.globalStatements = parser.statementList().childrenStatements().count();
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    QTextStream out(stdout);
+    QString compiler = argc>1?QString::fromLocal8Bit(argv[1]):QString("g++");
+    int warmRuns = argc>2?std::max(1,atoi(argv[2])):5;
+
+    initParser();
+    QStringList includeDirs = compilerIncludeDirs(compiler);
+    QStringList defines = compilerDefines(compiler);
+    if (includeDirs.isEmpty()) {
+        out<<"Can't get the include dirs of "<<compiler<<"\n";
+        return 1;
+    }
+
+    QTemporaryDir dir;
+    QString fileName = dir.filePath("main.cpp");
+    QFile file(fileName);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate))
+        return 1;
+    file.write("#include <bits/stdc++.h>\nint main() {\n    return 0;\n}\n");
+    file.close();
+    QString cacheFile = dir.filePath("symbols.cache");
+    QString cacheKey = QStringList{compiler, includeDirs.join('\n'), defines.join('\n')}.join('\n');
+
+    ParseResult cold = parseOnce(fileName, includeDirs, defines, cacheFile, cacheKey);
+    out<<QString("cold: %1 ms, %2 files, %3 global statements\n")
+         .arg(cold.time).arg(cold.scannedFiles).arg(cold.globalStatements);
+    if (!QFile::exists(cacheFile)) {
+        out<<"the symbol cache is not written\n";
+        return 1;
+    }
+
+    qint64 total = 0;
+    qint64 best = -1;
+    for (int i=0;i<warmRuns;i++) {
+        // each run creates a new parser, the cache is loaded from disk
+        ParseResult warm = parseOnce(fileName, includeDirs, defines, cacheFile, cacheKey);
+        if (warm.scannedFiles != cold.scannedFiles || warm.globalStatements != cold.globalStatements) {
+            out<<QString("warm run %1 differs: %2 files, %3 global statements\n")
+                 .arg(i+1).arg(warm.scannedFiles).arg(warm.globalStatements);
+        }
+        total += warm.time;
+        best = (best<0)?warm.time:std::min(best, warm.time);
+    }
+    out<<QString("warm: %1 ms average, %2 ms best, %3 runs\n")
+         .arg(total/warmRuns).arg(best).arg(warmRuns);
+    return 0;
+}
@@ -0,0 +1,26 @@
+QT += core gui widgets
+
+include(../benchmarks.pri)
+
+INCLUDEPATH += ../../RedPandaIDE
+
+SOURCES += \
+    main.cpp \
+    ../benchutils.cpp \
+    ../../RedPandaIDE/parser/cppparser.cpp \
+    ../../RedPandaIDE/parser/cpppreprocessor.cpp \
+    ../../RedPandaIDE/parser/cpptokenizer.cpp \
+    ../../RedPandaIDE/parser/parserutils.cpp \
+    ../../RedPandaIDE/parser/statementmodel.cpp
+
+HEADERS += \
+    ../benchutils.h \
+    ../../RedPandaIDE/parser/cppparser.h \
+    ../../RedPandaIDE/parser/cpppreprocessor.h \
+    ../../RedPandaIDE/parser/cpptokenizer.h \
+    ../../RedPandaIDE/parser/parserutils.h \
+    ../../RedPandaIDE/parser/statementmodel.h
+
+win32: {
+LIBS += -lpsapi
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Preprocess+tokenize time, full parse time and peak memory of a file
+ * including <bits/stdc++.h>, without the symbol cache.
+ *
+ * Usage: parsertokens [compiler [runs]]
+ *   compiler: gcc compatible c++ compiler used to get the include dirs and
+ *             the predefined macros, default "g++"
+ *
+ * The peak memory of the tokenize runs is printed before any parse runs, so
+ * it only counts the preprocessor and the tokenizer. The parse time includes
+ * the preprocessing and the tokenizing.
+ */
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include "parser/cppparser.h"
+#include "parser/cpppreprocessor.h"
+#include "parser/cpptokenizer.h"
+#include "parser/parserutils.h"
+#include "qt_utils/utils.h"
+#include "../benchutils.h"
+
+static qint64 tokenizeOnce(const QString& fileName,
+                           const QStringList& includeDirs,
+                           const QStringList& defines,
+                           int& tokenCount)
+{
+    CppPreprocessor preprocessor;
+    CppTokenizer tokenizer;
+    foreach (const QString& dir, includeDirs)
+        preprocessor.addIncludePath(includeTrailingPathDelimiter(dir));
+    // like CppParser::addHardDefineByLine()
+    foreach (const QString& define, defines)
+        preprocessor.addHardDefineByLine(define.mid(1).trimmed());
+    preprocessor.setScanOptions(true, true);
+
+    QElapsedTimer timer;
+    timer.start();
+    preprocessor.preprocess(fileName, tokenizer);
+    preprocessor.clearTempResults();
+    tokenizer.endTokenize();
+    qint64 time = timer.elapsed();
+    tokenCount = tokenizer.tokenCount();
+    return time;
+}
+
+static qint64 parseOnce(const QString& fileName,
+                        const QStringList& includeDirs,
+                        const QStringList& defines,
+                        int& globalStatements)
+{
+    // configured like resetCppParser(), without the symbol cache
+    CppParser parser;
+    parser.resetParser();
+    parser.setEnabled(true);
+    parser.setParseGlobalHeaders(true);
+    parser.setParseLocalHeaders(true);
+    parser.clearIncludePaths();
+    foreach (const QString& dir, includeDirs)
+        parser.addIncludePath(dir);
+    foreach (const QString& define, defines)
+        parser.addHardDefineByLine(define);
+    parser.parseHardDefines();
+
+    QElapsedTimer timer;
+    timer.start();
+    parser.parseFile(fileName, false);
+    qint64 time = timer.elapsed();
+    globalStatements = parser.statementList().childrenStatements().count();
+    return time;
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    QTextStream out(stdout);
+    QString compiler = argc>1?QString::fromLocal8Bit(argv[1]):QString("g++");
+    int runs = argc>2?std::max(1,atoi(argv[2])):5;
+
+    initParser();
+    QStringList includeDirs = compilerIncludeDirs(compiler);
+    QStringList defines = compilerDefines(compiler);
+    if (includeDirs.isEmpty()) {
+        out<<"Can't get the include dirs of "<<compiler<<"\n";
+        return 1;
+    }
+
+    QTemporaryDir dir;
+    QString fileName = dir.filePath("main.cpp");
+    QFile file(fileName);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate))
+        return 1;
+    file.write("#include <bits/stdc++.h>\nint main() {\n    return 0;\n}\n");
+    file.close();
+
+    out<<QString("peak memory at start: %1 KB\n").arg(peakMemoryUsage());
+
+    qint64 best = -1;
+    int tokenCount = 0;
+    for (int i=0;i<runs;i++) {
+        qint64 time = tokenizeOnce(fileName, includeDirs, defines, tokenCount);
+        best = (best<0)?time:std::min(best, time);
+    }
+    out<<QString("preprocess+tokenize: %1 ms best of %2, %3 tokens, peak memory %4 KB\n")
+         .arg(best).arg(runs).arg(tokenCount).arg(peakMemoryUsage());
+
+    best = -1;
+    int globalStatements = 0;
+    for (int i=0;i<runs;i++) {
+        qint64 time = parseOnce(fileName, includeDirs, defines, globalStatements);
+        best = (best<0)?time:std::min(best, time);
+    }
+    out<<QString("parse: %1 ms best of %2, %3 global statements, peak memory %4 KB\n")
+         .arg(best).arg(runs).arg(globalStatements).arg(peakMemoryUsage());
+    return 0;
+}
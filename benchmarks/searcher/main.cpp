@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * BasicSearcher::findAll vs. the QString::indexOf loop it replaced.
+ *
+ * Usage: searcher [file [runs]]
+ *   file: text to search in, default a generated c++ text of about 8MB
+ */
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include "qsynedit/searcher/basicsearcher.h"
+
+using namespace QSynedit;
+
+// findAll() as it was before the dedicated matcher
+class IndexOfSearcher : public BaseSearcher
+{
+public:
+    int length(int aIndex) override {
+        if (aIndex<0 || aIndex >= mResults.length())
+            return 0;
+        return pattern().length();
+    }
+    int result(int aIndex) override {
+        if (aIndex<0 || aIndex >= mResults.length())
+            return -1;
+        return mResults[aIndex];
+    }
+    int resultCount() override {
+        return mResults.count();
+    }
+    int findAll(const QString &text) override {
+        mResults.clear();
+        if (pattern().isEmpty())
+            return 0;
+        int start=0;
+        int next=-1;
+        while (true) {
+            if (options().testFlag(ssoMatchCase)) {
+                next = text.indexOf(pattern(),start,Qt::CaseSensitive);
+            } else {
+                next = text.indexOf(pattern(),start,Qt::CaseInsensitive);
+            }
+            if (next<0) {
+                break;
+            }
+            start = next + pattern().length();
+            if (options().testFlag(ssoWholeWord)) {
+                if (((next<=0) || isDelimitChar(text[next-1]))
+                        &&
+                        ( (start>=text.length()) || isDelimitChar(text[start]) )
+                     ) {
+                    mResults.append(next);
+                }
+            } else {
+                mResults.append(next);
+            }
+        }
+        return mResults.size();
+    }
+    QString replace(const QString &, const QString &aReplacement) override {
+        return aReplacement;
+    }
+private:
+    QList<int> mResults;
+};
+
+static QString generateText(int functionCount)
+{
+    QString text;
+    QTextStream stream(&text);
+    for (int i=0;i<functionCount;i++) {
+        stream<<"/* Compute the Sum of the series, function "<<i<<" */\n"
+              <<"int sumSeries"<<i<<"(int count, int step) {\n"
+              <<"    int sum = 0;\n"
+              <<"    for (int i=0;i<count;i++) {\n"
+              <<"        sum += step * i + "<<i<<"; // accumulate the partial SUM\n"
+              <<"    }\n"
+              <<"    return sum;\n"
+              <<"}\n\n";
+    }
+    return text;
+}
+
+static qint64 timeFindAll(BaseSearcher& searcher, const QString& text, int runs, int& count)
+{
+    QElapsedTimer timer;
+    timer.start();
+    for (int i=0;i<runs;i++)
+        count = searcher.findAll(text);
+    return timer.nsecsElapsed() / runs;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+    int runs = argc>2?std::max(1,atoi(argv[2])):10;
+
+    QString text;
+    if (argc>1) {
+        QFile file(QString::fromLocal8Bit(argv[1]));
+        if (!file.open(QFile::ReadOnly)) {
+            out<<"Can't open "<<argv[1]<<"\n";
+            return 1;
+        }
+        text = QString::fromUtf8(file.readAll());
+    } else {
+        text = generateText(40000);
+    }
+    out<<QString("%1 chars\n").arg(text.length());
+
+    struct Case {
+        QString pattern;
+        SearchOptions options;
+    };
+    QList<Case> cases{
+        {"sum", ssoMatchCase},
+        {"sum", SearchOptions()},
+        {"sum", SearchOptions(ssoMatchCase) | ssoWholeWord},
+        {"sum", ssoWholeWord},
+        {"i", SearchOptions(ssoMatchCase) | ssoWholeWord},
+        {"accumulate the partial", ssoMatchCase},
+        {"ACCUMULATE THE PARTIAL", SearchOptions()},
+        {"compute the sum of the series", ssoWholeWord},
+        {"not in the text at all", ssoMatchCase},
+        {"not in the text at all", SearchOptions()},
+    };
+
+    bool allEqual = true;
+    foreach (const Case& c, cases) {
+        BasicSearcher searcher;
+        IndexOfSearcher reference;
+        searcher.setPattern(c.pattern);
+        searcher.setOptions(c.options);
+        reference.setPattern(c.pattern);
+        reference.setOptions(c.options);
+
+        int count = 0;
+        int referenceCount = 0;
+        qint64 time = timeFindAll(searcher, text, runs, count);
+        qint64 referenceTime = timeFindAll(reference, text, runs, referenceCount);
+
+        bool equal = (count == referenceCount);
+        for (int i=0;equal && i<count;i++)
+            equal = (searcher.result(i) == reference.result(i));
+        allEqual = allEqual && equal;
+
+        QString mode = c.options.testFlag(ssoMatchCase)?"case":"nocase";
+        if (c.options.testFlag(ssoWholeWord))
+            mode += ",word";
+        out<<QString("%1 [%2]: %3 hits, findAll %4 us, indexOf %5 us, x%6%7\n")
+             .arg("\""+c.pattern+"\"", -32).arg(mode, -11)
+             .arg(count, 7)
+             .arg(time / 1000.0, 9, 'f', 1)
+             .arg(referenceTime / 1000.0, 9, 'f', 1)
+             .arg(time>0?(double)referenceTime / time:0.0, 0, 'f', 2)
+             .arg(equal?"":" RESULTS DIFFER");
+    }
+    return allEqual?0:1;
+}
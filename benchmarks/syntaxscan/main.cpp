@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Per-keystroke cost of syntax rescanning in QSynEdit on a large c++ file.
+ *
+ * Usage: syntaxscan [file [keystrokes]]
+ *   file: c++ source to edit, default a generated file of about 50k lines
+ */
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include "qsynedit/qsynedit.h"
+#include "qsynedit/syntaxer/cpp.h"
+
+using QSynedit::BufferCoord;
+using QSynedit::EditCommand;
+
+static QStringList generateLines(int functionCount)
+{
+    QStringList lines;
+    lines.append("#include <cstdio>");
+    lines.append("");
+    for (int i=0;i<functionCount;i++) {
+        lines.append(QString("/* function %1").arg(i));
+        lines.append(" * generated for the benchmark */");
+        lines.append(QString("int func%1(int a, int b) {").arg(i));
+        lines.append("    int sum = 0;");
+        lines.append("    for (int i=0;i<a;i++) {");
+        lines.append(QString("        sum += b * i + %1; // accumulate").arg(i));
+        lines.append("    }");
+        lines.append("    printf(\"%d\\n\", sum);");
+        lines.append("    return sum;");
+        lines.append("}");
+        lines.append("");
+    }
+    return lines;
+}
+
+// what every keystroke cost before the rescan stopped on converged states
+static qint64 fullRescan(const QSynedit::PDocument& document)
+{
+    QSynedit::CppSyntaxer syntaxer;
+    QElapsedTimer timer;
+    timer.start();
+    syntaxer.resetState();
+    for (int i=0;i<document->count();i++) {
+        syntaxer.setLine(document->getLine(i), i);
+        syntaxer.nextToEol();
+    }
+    return timer.nsecsElapsed();
+}
+
+// type the text at the given position, then delete it with backspace
+static double typeAndErase(QSynedit::QSynEdit& edit, int line, const QString& text, int times)
+{
+    QElapsedTimer timer;
+    qint64 total = 0;
+    for (int n=0;n<times;n++) {
+        edit.setCaretXY(BufferCoord{1, line});
+        foreach (const QChar& ch, text) {
+            timer.start();
+            if (ch == '\n')
+                edit.processCommand(EditCommand::LineBreak);
+            else
+                edit.processCommand(EditCommand::Char, ch);
+            total += timer.nsecsElapsed();
+        }
+        for (int i=0;i<text.length();i++) {
+            timer.start();
+            edit.processCommand(EditCommand::DeleteLastChar);
+            total += timer.nsecsElapsed();
+        }
+    }
+    return total / 1000.0 / (2.0 * text.length() * times);
+}
+
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+    QTextStream out(stdout);
+    int times = argc>2?std::max(1,atoi(argv[2])):20;
+
+    QStringList lines;
+    if (argc>1) {
+        QFile file(QString::fromLocal8Bit(argv[1]));
+        if (!file.open(QFile::ReadOnly)) {
+            out<<"Can't open "<<argv[1]<<"\n";
+            return 1;
+        }
+        lines = QString::fromUtf8(file.readAll()).split('\n');
+    } else {
+        lines = generateLines(4600);
+    }
+
+    QSynedit::QSynEdit edit;
+    edit.resize(800, 600);
+    edit.document()->setContents(lines);
+    edit.setSyntaxer(std::make_shared<QSynedit::CppSyntaxer>());
+    edit.setUseCodeFolding(true);
+    // backspace must undo the line break exactly
+    edit.setOptions(edit.getOptions() & ~QSynedit::EditorOptions(QSynedit::eoAutoIndent));
+    int lineCount = edit.document()->count();
+    out<<QString("%1 lines\n").arg(lineCount);
+
+    qint64 fullTotal = 0;
+    for (int i=0;i<times;i++)
+        fullTotal += fullRescan(edit.document());
+    out<<QString("full rescan: %1 us\n").arg(fullTotal / 1000.0 / times, 0, 'f', 1);
+
+    // an identifier typed near the top only changes its own line
+    out<<QString("keystroke at line 10: %1 us\n")
+         .arg(typeAndErase(edit, 10, "abc", times), 0, 'f', 1);
+    out<<QString("keystroke at line %1: %2 us\n").arg(lineCount/2)
+         .arg(typeAndErase(edit, lineCount/2, "abc", times), 0, 'f', 1);
+    // an unclosed comment changes the states down to the next comment end
+    out<<QString("comment opened at line 10: %1 us\n")
+         .arg(typeAndErase(edit, 10, "/*", times), 0, 'f', 1);
+    // lines added and removed, folds are rescanned
+    out<<QString("line break at line 10: %1 us\n")
+         .arg(typeAndErase(edit, 10, "\n", times), 0, 'f', 1);
+    return 0;
+}
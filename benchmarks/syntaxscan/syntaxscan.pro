@@ -0,0 +1,6 @@
+QT += core gui widgets
+
+include(../benchmarks.pri)
+
+SOURCES += \
+    main.cpp
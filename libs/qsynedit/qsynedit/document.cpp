@@ -25,11 +25,120 @@
 #include "qsynedit.h"
 #include <QMessageBox>
 #include <cmath>
+#include <cstring>
+#include <limits>
 #include "qt_utils/charsetinfo.h"
 #include <QDebug>
 
 namespace QSynedit {
 
+#define SNAPSHOT_CHUNK_SIZE 512
+
+namespace {
+const quint64 ALL_ONES = 0x0101010101010101ULL;
+const quint64 ALL_HIGH_BITS = 0x8080808080808080ULL;
+
+inline quint64 loadWord(const char* p)
+{
+    quint64 word;
+    memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+// true if any byte in the word may be a control char or a non ascii char
+inline bool mayHaveSpecialByte(quint64 word)
+{
+    return ((word - ALL_ONES * 0x20) | word) & ALL_HIGH_BITS;
+}
+
+/*
+ * Splits the content into lines and classifies its bytes in one pass.
+ * Words of 8 printable ascii chars are skipped at once, only the others are
+ * checked byte by byte. Like QFile::readLine(), only '\n' ends a line.
+ */
+void scanContent(const QByteArray& content, int start, QVector<ContentLineRange>& lines,
+                 bool& binary, bool& allAscii)
+{
+    const char* data = content.constData();
+    int size = content.length();
+    binary = false;
+    allAscii = true;
+    lines.clear();
+    int lineStart = start;
+    int i = start;
+    while (i<size) {
+        if (i+8<=size && !mayHaveSpecialByte(loadWord(data+i))) {
+            i+=8;
+            continue;
+        }
+        unsigned char ch = data[i];
+        if (ch>=0x80) {
+            allAscii = false;
+        } else if (ch=='\n') {
+            int len = i - lineStart;
+            if (len>0 && data[i-1]=='\r')
+                len--;
+            lines.append(ContentLineRange{lineStart, len});
+            lineStart = i+1;
+        } else if (ch<' ' && ch!='\t' && ch!='\r') {
+            binary = true;
+            return;
+        }
+        i++;
+    }
+    if (lineStart<size) {
+        int len = size - lineStart;
+        if (data[size-1]=='\r')
+            len--;
+        lines.append(ContentLineRange{lineStart, len});
+    }
+}
+
+// strict utf-8 check: no overlong forms, surrogates or code points above 0x10FFFF
+bool isValidUTF8(const char* data, int size)
+{
+    int i=0;
+    while (i<size) {
+        if (i+8<=size && (loadWord(data+i) & ALL_HIGH_BITS)==0) {
+            i+=8;
+            continue;
+        }
+        unsigned char ch = data[i];
+        if (ch<0x80) {
+            i++;
+            continue;
+        }
+        int trailCount;
+        uint codePoint;
+        if (ch>=0xC2 && ch<=0xDF) {
+            trailCount = 1;
+            codePoint = ch & 0x1F;
+        } else if (ch>=0xE0 && ch<=0xEF) {
+            trailCount = 2;
+            codePoint = ch & 0x0F;
+        } else if (ch>=0xF0 && ch<=0xF4) {
+            trailCount = 3;
+            codePoint = ch & 0x07;
+        } else {
+            return false;
+        }
+        if (i+trailCount>=size)
+            return false;
+        for (int j=1;j<=trailCount;j++) {
+            unsigned char trail = data[i+j];
+            if ((trail & 0xC0)!=0x80)
+                return false;
+            codePoint = (codePoint << 6) | (trail & 0x3F);
+        }
+        if ((trailCount==2 && (codePoint<0x800 || (codePoint>=0xD800 && codePoint<=0xDFFF)))
+                || (trailCount==3 && (codePoint<0x10000 || codePoint>0x10FFFF)))
+            return false;
+        i+=trailCount+1;
+    }
+    return true;
+}
+}
+
 Document::Document(const QFont& font, const QFont& nonAsciiFont, QObject *parent):
       QObject(parent),
       mFontMetrics(font),
@@ -43,9 +152,12 @@ Document::Document(const QFont& font, const QFont& nonAsciiFont, QObject *parent
 {
     mAppendNewLineAtEOF = true;
     mNewlineType = NewlineType::Windows;
-    mIndexOfLongestLine = -1;
+    mColumnsDirty = false;
     mUpdateCount = 0;
+    mVersion = 0;
+    mSnapshotUsed = 0;
     mCharWidth =  mFontMetrics.horizontalAdvance("M");
+    resetCharColumnsCache();
 }
 
 static void listIndexOutOfBounds(int index) {
@@ -125,23 +237,16 @@ int Document::blockEnded(int index)
 
 int Document::lengthOfLongestLine() {
     QMutexLocker locker(&mMutex);
-    if (mIndexOfLongestLine < 0) {
-        int MaxLen = -1;
-        mIndexOfLongestLine = -1;
-        if (mLines.count() > 0 ) {
-            for (int i=0;i<mLines.size();i++) {
-                int len = lineColumns(i);
-                if (len > MaxLen) {
-                    MaxLen = len;
-                    mIndexOfLongestLine = i;
-                }
-            }
+    if (mColumnsDirty) {
+        for (int i=0;i<mLines.size();i++) {
+            if (mLines[i]->columns<0)
+                calculateLineColumns(i);
         }
+        mColumnsDirty = false;
     }
-    if (mIndexOfLongestLine >= 0)
-        return mLines[mIndexOfLongestLine]->columns;
-    else
+    if (mColumnsCount.isEmpty())
         return 0;
+    return mColumnsCount.lastKey();
 }
 
 QString Document::lineBreak() const
@@ -173,8 +278,9 @@ void Document::insertItem(int Index, const QString &s)
     beginUpdate();
     PDocumentLine line = std::make_shared<DocumentLine>();
     line->lineText = s;
-    mIndexOfLongestLine = -1;
+    invalidateSnapshot(Index);
     mLines.insert(Index,line);
+    calculateLineColumns(Index);
     endUpdate();
 }
 
@@ -183,8 +289,9 @@ void Document::addItem(const QString &s)
     beginUpdate();
     PDocumentLine line = std::make_shared<DocumentLine>();
     line->lineText = s;
-    mIndexOfLongestLine = -1;
+    invalidateSnapshot(mLines.count());
     mLines.append(line);
+    calculateLineColumns(mLines.count()-1);
     endUpdate();
 }
 
@@ -247,7 +354,6 @@ void Document::setContents(const QStringList &text)
     });
     internalClear();
     if (text.count() > 0) {
-        mIndexOfLongestLine = -1;
         int FirstAdded = mLines.count();
 
         foreach (const QString& s,text) {
@@ -268,6 +374,61 @@ QStringList Document::contents()
     return result;
 }
 
+PDocumentSnapshot Document::snapshot()
+{
+    if (mSnapshotUsed.loadAcquire()) {
+        PDocumentSnapshot result = std::atomic_load(&mSnapshot);
+        if (result)
+            return result;
+    }
+    // the first reader publishes the snapshot, the writers keep it updated after that
+    QMutexLocker locker(&mMutex);
+    mSnapshotUsed.storeRelease(1);
+    PDocumentSnapshot result = std::atomic_load(&mSnapshot);
+    if (!result || result->version()!=mVersion) {
+        publishSnapshot();
+        result = std::atomic_load(&mSnapshot);
+    }
+    return result;
+}
+
+void Document::invalidateSnapshot(int fromIndex)
+{
+    mVersion++;
+    int chunk = fromIndex / SNAPSHOT_CHUNK_SIZE;
+    if (chunk < mSnapshotChunks.count())
+        mSnapshotChunks.resize(chunk);
+}
+
+void Document::invalidateSnapshotLine(int index)
+{
+    mVersion++;
+    int chunk = index / SNAPSHOT_CHUNK_SIZE;
+    if (chunk < mSnapshotChunks.count())
+        mSnapshotChunks[chunk].reset();
+}
+
+void Document::publishSnapshot()
+{
+    int chunkCount = (mLines.count() + SNAPSHOT_CHUNK_SIZE - 1) / SNAPSHOT_CHUNK_SIZE;
+    mSnapshotChunks.resize(chunkCount);
+    for (int i=0;i<chunkCount;i++) {
+        if (mSnapshotChunks[i])
+            continue;
+        std::shared_ptr<QStringList> chunk = std::make_shared<QStringList>();
+        int end = std::min((i+1)*SNAPSHOT_CHUNK_SIZE, mLines.count());
+        chunk->reserve(end - i*SNAPSHOT_CHUNK_SIZE);
+        for (int j=i*SNAPSHOT_CHUNK_SIZE;j<end;j++)
+            chunk->append(mLines[j]->lineText);
+        mSnapshotChunks[i] = chunk;
+    }
+    std::shared_ptr<DocumentSnapshot> snapshot = std::make_shared<DocumentSnapshot>();
+    snapshot->mChunks = mSnapshotChunks;
+    snapshot->mCount = mLines.count();
+    snapshot->mVersion = mVersion;
+    std::atomic_store(&mSnapshot, PDocumentSnapshot(snapshot));
+}
+
 void Document::beginUpdate()
 {
     if (mUpdateCount == 0) {
@@ -280,6 +441,12 @@ void Document::endUpdate()
 {
     mUpdateCount--;
     if (mUpdateCount == 0) {
+        if (mSnapshotUsed.loadAcquire()) {
+            QMutexLocker locker(&mMutex);
+            PDocumentSnapshot snapshot = std::atomic_load(&mSnapshot);
+            if (!snapshot || snapshot->version()!=mVersion)
+                publishSnapshot();
+        }
         setUpdateState(false);
     }
 }
@@ -300,7 +467,6 @@ void Document::addLines(const QStringList &strings)
 {
     QMutexLocker locker(&mMutex);
     if (strings.count() > 0) {
-        mIndexOfLongestLine = -1;
         beginUpdate();
         auto action = finally([this]{
             endUpdate();
@@ -347,17 +513,13 @@ void Document::deleteLines(int index, int numLines)
     auto action = finally([this]{
         endUpdate();
     });
-    if (mIndexOfLongestLine>=index) {
-        if (mIndexOfLongestLine <index+numLines) {
-            mIndexOfLongestLine = -1;
-        } else {
-            mIndexOfLongestLine -= numLines;
-        }
-    }
     int LinesAfter = mLines.count() - (index + numLines);
     if (LinesAfter < 0) {
        numLines = mLines.count() - index;
     }
+    for (int i=index;i<index+numLines;i++)
+        uncountLineColumns(mLines[i]->columns);
+    invalidateSnapshot(index);
     mLines.remove(index,numLines);
     emit deleted(index,numLines);
 }
@@ -375,12 +537,9 @@ void Document::exchange(int index1, int index2)
     PDocumentLine temp = mLines[index1];
     mLines[index1]=mLines[index2];
     mLines[index2]=temp;
+    invalidateSnapshotLine(index1);
+    invalidateSnapshotLine(index2);
     //mList.swapItemsAt(Index1,Index2);
-    if (mIndexOfLongestLine == index1) {
-        mIndexOfLongestLine = index2;
-    } else if (mIndexOfLongestLine == index2) {
-        mIndexOfLongestLine = index1;
-    }
     endUpdate();
 }
 
@@ -403,10 +562,8 @@ void Document::deleteAt(int index)
         listIndexOutOfBounds(index);
     }
     beginUpdate();
-    if (mIndexOfLongestLine == index)
-        mIndexOfLongestLine = -1;
-    else if (mIndexOfLongestLine>index)
-        mIndexOfLongestLine -= 1;
+    uncountLineColumns(mLines[index]->columns);
+    invalidateSnapshot(index);
     mLines.removeAt(index);
     emit deleted(index,1);
     endUpdate();
@@ -435,15 +592,9 @@ void Document::putLine(int index, const QString &s, bool notify) {
             listIndexOutOfBounds(index);
         }
         beginUpdate();
-        int oldColumns = mLines[index]->columns;
         mLines[index]->lineText = s;
+        invalidateSnapshotLine(index);
         calculateLineColumns(index);
-        if (mIndexOfLongestLine == index && oldColumns>mLines[index]->columns )
-            mIndexOfLongestLine = -1;
-        else if (mIndexOfLongestLine>=0
-                 && mIndexOfLongestLine<mLines.count()
-                 && mLines[index]->columns > mLines[mIndexOfLongestLine]->columns)
-            mIndexOfLongestLine = index;
         if (notify)
             emit putted(index,1);
         endUpdate();
@@ -462,10 +613,25 @@ int Document::calculateLineColumns(int Index)
 {
     PDocumentLine line = mLines[Index];
 
+    uncountLineColumns(line->columns);
     line->columns = stringColumns(line->lineText,0);
+    mColumnsCount[line->columns]++;
     return line->columns;
 }
 
+void Document::uncountLineColumns(int columns)
+{
+    if (columns<0)
+        return;
+    auto it = mColumnsCount.find(columns);
+    if (it == mColumnsCount.end())
+        return;
+    if (it.value()<=1)
+        mColumnsCount.erase(it);
+    else
+        it.value()--;
+}
+
 void Document::insertLines(int index, int numLines)
 {
     QMutexLocker locker(&mMutex);
@@ -478,74 +644,78 @@ void Document::insertLines(int index, int numLines)
     auto action = finally([this]{
         endUpdate();
     });
-    mIndexOfLongestLine = -1;
     PDocumentLine line;
+    invalidateSnapshot(index);
     mLines.insert(index,numLines,line);
     for (int i=index;i<index+numLines;i++) {
         line = std::make_shared<DocumentLine>();
+        line->columns = 0;
         mLines[i]=line;
     }
+    mColumnsCount[0]+=numLines;
     emit inserted(index,numLines);
 }
 
 
-bool Document::tryLoadFileByEncoding(QByteArray encodingName, QFile& file) {
+bool Document::tryLoadFileByEncoding(QByteArray encodingName, const QByteArray& content,
+                                     const QVector<ContentLineRange>& lines) {
     QTextCodec* codec = QTextCodec::codecForName(encodingName);
     if (!codec)
         return false;
-    file.reset();
     internalClear();
+    mLines.reserve(lines.count());
     QTextCodec::ConverterState state;
-    while (true) {
-        if (file.atEnd()){
-            break;
-        }
-        QByteArray line = file.readLine();
-        if (line.endsWith("\r\n")) {
-            line.remove(line.length()-2,2);
-        } else if (line.endsWith("\r")) {
-            line.remove(line.length()-1,1);
-        } else if (line.endsWith("\n")){
-            line.remove(line.length()-1,1);
-        }
-        QString newLine = codec->toUnicode(line.constData(),line.length(),&state);
+    const char* data = content.constData();
+    foreach (const ContentLineRange& range, lines) {
+        PDocumentLine line = std::make_shared<DocumentLine>();
+        line->lineText = codec->toUnicode(data+range.start,range.length,&state);
         if (state.invalidChars>0) {
+            mLines.clear();
             return false;
-            break;
         }
-        addItem(newLine);
+        mLines.append(line);
     }
+    mColumnsDirty = true;
     return true;
 }
 
-void Document::loadUTF16BOMFile(QFile &file)
+void Document::loadUTF16BOMFile(const QByteArray& content)
 {
     QTextCodec* codec=QTextCodec::codecForName(ENCODING_UTF16);
     if (!codec)
         return;
-    file.reset();
     internalClear();
-    QByteArray buf = file.readAll();
-    if (buf.length()<2)
+    if (content.length()<2)
         return;
-    QString text = codec->toUnicode(buf.mid(2));
+    QString text = codec->toUnicode(content.constData()+2, content.length()-2);
     this->setText(text);
 }
 
-void Document::loadUTF32BOMFile(QFile &file)
+void Document::loadUTF32BOMFile(const QByteArray& content)
 {
     QTextCodec* codec=QTextCodec::codecForName(ENCODING_UTF32);
     if (!codec)
         return;
-    file.reset();
     internalClear();
-    QByteArray buf = file.readAll();
-    if (buf.length()<4)
+    if (content.length()<4)
         return;
-    QString text = codec->toUnicode(buf.mid(4));
+    QString text = codec->toUnicode(content.constData()+4, content.length()-4);
     this->setText(text);
 }
 
+void Document::loadUTF8Lines(const QByteArray &content, const QVector<ContentLineRange> &lines)
+{
+    internalClear();
+    mLines.reserve(lines.count());
+    const char* data = content.constData();
+    foreach (const ContentLineRange& range, lines) {
+        PDocumentLine line = std::make_shared<DocumentLine>();
+        line->lineText = QString::fromUtf8(data+range.start,range.length);
+        mLines.append(line);
+    }
+    mColumnsDirty = true;
+}
+
 void Document::saveUTF16File(QFile &file, QTextCodec* codec)
 {
     if (!codec)
@@ -572,6 +742,21 @@ void Document::setFontMetrics(const QFont &newFont, const QFont& newNonAsciiFont
     mFontMetrics = QFontMetrics(newFont);
     mCharWidth =  mFontMetrics.horizontalAdvance("M");
     mNonAsciiFontMetrics = QFontMetrics(newNonAsciiFont);
+    resetCharColumnsCache();
+}
+
+void Document::resetCharColumnsCache()
+{
+    mCharColumnsCache.fill(0, 0x10000);
+    mAsciiMonospace = false;
+    bool monospace = true;
+    for (ushort ch=33;ch<128;ch++) {
+        if (charColumns(QChar(ch))!=1) {
+            monospace = false;
+            break;
+        }
+    }
+    mAsciiMonospace = monospace;
 }
 
 void Document::setTabWidth(int newTabWidth)
@@ -588,6 +773,8 @@ void Document::loadFromFile(const QString& filename, const QByteArray& encoding,
     QFile file(filename);
     if (!file.open(QFile::ReadOnly))
         throw FileError(tr("Can't open file '%1' for read!").arg(file.fileName()));
+    if (file.size() > std::numeric_limits<int>::max())
+        throw FileError(tr("'%1' is too large to open!").arg(filename));
     beginUpdate();
     internalClear();
     auto action = finally([this]{
@@ -595,83 +782,76 @@ void Document::loadFromFile(const QString& filename, const QByteArray& encoding,
             emit inserted(0,mLines.count());
         endUpdate();
     });
-    mIndexOfLongestLine = -1;
+    // map the whole file instead of reading it line by line
+    int size = file.size();
+    uchar* mappedData = (size>0)?file.map(0,size):nullptr;
+    auto unmapAction = finally([&file,mappedData]{
+        if (mappedData)
+            file.unmap(mappedData);
+    });
+    QByteArray content;
+    if (mappedData)
+        content = QByteArray::fromRawData((const char*)mappedData, size);
+    else
+        content = file.readAll();
+    QVector<ContentLineRange> lines;
     //test for utf8 / utf 8 bom
     if (encoding == ENCODING_AUTO_DETECT) {
-        if (file.atEnd()) {
+        if (content.isEmpty()) {
             realEncoding = ENCODING_ASCII;
             return;
         }
-        QByteArray line = file.readLine();
-        QTextCodec* codec;
-        QTextCodec::ConverterState state;
-        bool needReread = false;
-        bool allAscii = true;
+        int start = 0;
         //test for BOM
-        if ((line.length()>=3) && ((unsigned char)line[0]==0xEF) && ((unsigned char)line[1]==0xBB) && ((unsigned char)line[2]==0xBF) ) {
+        if ((content.length()>=3) && ((unsigned char)content[0]==0xEF) && ((unsigned char)content[1]==0xBB) && ((unsigned char)content[2]==0xBF) ) {
             realEncoding = ENCODING_UTF8_BOM;
-            line = line.mid(3);
-            codec = QTextCodec::codecForName(ENCODING_UTF8);
-        } else if ((line.length()>=4) && ((unsigned char)line[0]==0xFF) && ((unsigned char)line[1]==0xFE)
-                   && ((unsigned char)line[2]==0x00)
-                   && ((unsigned char)line[3]==0x00)) {
+            start = 3;
+        } else if ((content.length()>=4) && ((unsigned char)content[0]==0xFF) && ((unsigned char)content[1]==0xFE)
+                   && ((unsigned char)content[2]==0x00)
+                   && ((unsigned char)content[3]==0x00)) {
             realEncoding = ENCODING_UTF32_BOM;
-            loadUTF32BOMFile(file);
+            loadUTF32BOMFile(content);
             return;
-        } else if ((line.length()>=2) && ((unsigned char)line[0]==0xFF) && ((unsigned char)line[1]==0xFE)) {
+        } else if ((content.length()>=2) && ((unsigned char)content[0]==0xFF) && ((unsigned char)content[1]==0xFE)) {
             realEncoding = ENCODING_UTF16_BOM;
-            loadUTF16BOMFile(file);
+            loadUTF16BOMFile(content);
             return;
         } else {
             realEncoding = ENCODING_UTF8;
-            codec = QTextCodec::codecForName(ENCODING_UTF8);
         }
-        if (!codec)
-            throw FileError(tr("Can't load codec '%1'!").arg(QString(realEncoding)));
-        if (line.endsWith("\r\n")) {
+        bool binary;
+        bool allAscii;
+        scanContent(content, start, lines, binary, allAscii);
+        if (binary)
+            throw BinaryFileError(tr("'%1' is a binaray File!").arg(filename));
+        int firstLineBreak = content.indexOf('\n', start);
+        if (firstLineBreak>start && content[firstLineBreak-1]=='\r') {
             mNewlineType = NewlineType::Windows;
-        } else if (line.endsWith("\n")) {
+        } else if (firstLineBreak>=0) {
             mNewlineType = NewlineType::Unix;
-        } else if (line.endsWith("\r")) {
+        } else if (content.endsWith('\r')) {
             mNewlineType = NewlineType::MacOld;
         }
 
-        internalClear();
-        while (true) {
-            if (line.endsWith("\r\n")) {
-                line.remove(line.length()-2,2);
-            } else if (line.endsWith("\r")) {
-                line.remove(line.length()-1,1);
-            } else if (line.endsWith("\n")){
-                line.remove(line.length()-1,1);
-            }
-            if (isBinaryContent(line))
-                throw BinaryFileError(tr("'%1' is a binaray File!").arg(filename));
-            if (allAscii) {
-                allAscii = isTextAllAscii(line);
-            }
-            if (allAscii) {
-                addItem(QString::fromLatin1(line));
-            } else {
-                QString newLine = codec->toUnicode(line.constData(),line.length(),&state);
-                if (state.invalidChars>0) {
-                    needReread = true;
-                    break;
-                }
-                addItem(newLine);
-            }
-            if (file.atEnd()){
-                break;
+        if (allAscii) {
+            internalClear();
+            mLines.reserve(lines.count());
+            const char* data = content.constData();
+            foreach (const ContentLineRange& range, lines) {
+                PDocumentLine line = std::make_shared<DocumentLine>();
+                line->lineText = QString::fromLatin1(data+range.start,range.length);
+                mLines.append(line);
             }
-            line = file.readLine();
+            mColumnsDirty = true;
+            realEncoding = ENCODING_ASCII;
+            return;
         }
-        if (!needReread) {
-            if (allAscii)
-                realEncoding = ENCODING_ASCII;
+        if (isValidUTF8(content.constData()+start, content.length()-start)) {
+            loadUTF8Lines(content, lines);
             return;
         }
         realEncoding = pCharsetInfoManager->getDefaultSystemEncoding();
-        if (tryLoadFileByEncoding(realEncoding,file)) {
+        if (tryLoadFileByEncoding(realEncoding,content,lines)) {
             return;
         }
         QList<PCharsetInfo> charsets = pCharsetInfoManager->findCharsetByLocale(pCharsetInfoManager->localeName());
@@ -685,7 +865,7 @@ void Document::loadFromFile(const QString& filename, const QByteArray& encoding,
             foreach (const QByteArray& encodingName,encodingSet) {
                 if (encodingName == ENCODING_UTF8)
                     continue;
-                if (tryLoadFileByEncoding(encodingName,file)) {
+                if (tryLoadFileByEncoding(encodingName,content,lines)) {
                     //qDebug()<<encodingName;
                     realEncoding = encodingName;
                     return;
@@ -699,8 +879,19 @@ void Document::loadFromFile(const QString& filename, const QByteArray& encoding,
     if (realEncoding == ENCODING_SYSTEM_DEFAULT) {
         realEncoding = pCharsetInfoManager->getDefaultSystemEncoding();
     }
-    file.reset();
-    QTextStream textStream(&file);
+    if (realEncoding == ENCODING_UTF8 || realEncoding == ENCODING_UTF8_BOM) {
+        int start = 0;
+        if (content.startsWith("\xEF\xBB\xBF"))
+            start = 3;
+        bool binary;
+        bool allAscii;
+        scanContent(content, start, lines, binary, allAscii);
+        if (!binary) {
+            loadUTF8Lines(content, lines);
+            return;
+        }
+    }
+    QTextStream textStream(content, QIODevice::ReadOnly);
     if (realEncoding == ENCODING_UTF8_BOM) {
         textStream.setAutoDetectUnicode(true);
         textStream.setCodec(ENCODING_UTF8);
@@ -792,15 +983,32 @@ void Document::saveToFile(QFile &file, const QByteArray& encoding,
 int Document::stringColumns(const QString &line, int colsBefore) const
 {
     int columns = std::max(0,colsBefore);
-    int charCols;
-    for (int i=0;i<line.length();i++) {
-        QChar ch = line[i];
+    const QChar* data = line.constData();
+    int len = line.length();
+    int i=0;
+    while (i<len) {
+        if (mAsciiMonospace && i+4<=len) {
+            // 4 utf-16 chars at a time: if all of them are ascii but not tab, they take 4 columns
+            quint64 word;
+            memcpy(&word, data+i, sizeof(word));
+            if ((word & 0xFF80FF80FF80FF80ULL)==0) {
+                quint64 tabs = word ^ 0x0009000900090009ULL;
+                if (((tabs - 0x0001000100010001ULL) & ~tabs & 0x8000800080008000ULL)==0) {
+                    columns+=4;
+                    i+=4;
+                    continue;
+                }
+            }
+        }
+        QChar ch = data[i];
         if (ch == '\t') {
-            charCols = mTabWidth - columns % mTabWidth;
+            columns += mTabWidth - columns % mTabWidth;
+        } else if (mAsciiMonospace && ch.unicode()<128) {
+            columns++;
         } else {
-            charCols = charColumns(ch);
+            columns += charColumns(ch);
         }
-        columns+=charCols;
+        i++;
     }
     return columns-colsBefore;
 }
@@ -809,13 +1017,19 @@ int Document::charColumns(QChar ch) const
 {
     if (ch.unicode()<=32)
         return 1;
+    quint8 cached = mCharColumnsCache.at(ch.unicode());
+    if (cached>0)
+        return cached-1;
     int width;
     if (ch.unicode()<0xFF)
         width = mFontMetrics.horizontalAdvance(ch);
     else
         width = mNonAsciiFontMetrics.horizontalAdvance(ch);
     //return std::ceil((int)(fontMetrics().horizontalAdvance(ch) * dpiFactor()) / (double)mCharWidth);
-    return std::ceil(width / (double)mCharWidth);
+    int columns = std::ceil(width / (double)mCharWidth);
+    if (columns>=0 && columns<255)
+        mCharColumnsCache[ch.unicode()] = columns+1;
+    return columns;
 }
 
 void Document::putTextStr(const QString &text)
@@ -847,11 +1061,14 @@ void Document::putTextStr(const QString &text)
 
 void Document::internalClear()
 {
+    // bulk loaders append to mLines after clearing it, even when it was empty
+    invalidateSnapshot(0);
     if (!mLines.isEmpty()) {
         beginUpdate();
         int oldCount = mLines.count();
-        mIndexOfLongestLine = -1;
         mLines.clear();
+        mColumnsCount.clear();
+        mColumnsDirty = false;
         emit deleted(0,oldCount);
         endUpdate();
     }
@@ -878,7 +1095,8 @@ bool Document::empty()
 void Document::resetColumns()
 {
     QMutexLocker locker(&mMutex);
-    mIndexOfLongestLine = -1;
+    mColumnsCount.clear();
+    mColumnsDirty = true;
     if (mLines.count() > 0 ) {
         for (int i=0;i<mLines.size();i++) {
             mLines[i]->columns = -1;
@@ -889,12 +1107,40 @@ void Document::resetColumns()
 void Document::invalidAllLineColumns()
 {
     QMutexLocker locker(&mMutex);
-    mIndexOfLongestLine = -1;
+    mColumnsCount.clear();
+    mColumnsDirty = true;
     for (PDocumentLine& line:mLines) {
         line->columns = -1;
     }
 }
 
+int DocumentSnapshot::version() const
+{
+    return mVersion;
+}
+
+int DocumentSnapshot::count() const
+{
+    return mCount;
+}
+
+QString DocumentSnapshot::getLine(int index) const
+{
+    if (index<0 || index>=mCount)
+        return QString();
+    return mChunks[index / SNAPSHOT_CHUNK_SIZE]->at(index % SNAPSHOT_CHUNK_SIZE);
+}
+
+QStringList DocumentSnapshot::contents() const
+{
+    QStringList result;
+    result.reserve(mCount);
+    foreach (const std::shared_ptr<const QStringList>& chunk, mChunks) {
+        result.append(*chunk);
+    }
+    return result;
+}
+
 DocumentLine::DocumentLine():
     lineText(),
     syntaxState(),
@@ -20,6 +20,8 @@
 #include <QStringList>
 #include "syntaxer/syntaxer.h"
 #include <QFontMetrics>
+#include <QAtomicInt>
+#include <QMap>
 #include <QMutex>
 #include <QVector>
 #include <memory>
@@ -50,11 +52,38 @@ class Document;
 
 typedef std::shared_ptr<Document> PDocument;
 
+// a line in the raw content of a file, without the line break
+struct ContentLineRange {
+    int start;
+    int length;
+};
+
 class BinaryFileError : public FileError {
 public:
     explicit BinaryFileError (const QString& reason);
 };
 
+/*
+ * An immutable copy of a document's text at some version.
+ * It can be read in any thread without locking the document.
+ * The lines are kept in chunks, so a new version shares the
+ * unchanged chunks with the old one.
+ */
+class DocumentSnapshot {
+public:
+    int version() const;
+    int count() const;
+    QString getLine(int index) const;
+    QStringList contents() const;
+private:
+    friend class Document;
+    QVector<std::shared_ptr<const QStringList>> mChunks;
+    int mCount;
+    int mVersion;
+};
+
+using PDocumentSnapshot = std::shared_ptr<const DocumentSnapshot>;
+
 class Document : public QObject
 {  
     Q_OBJECT
@@ -80,6 +109,8 @@ public:
     void setText(const QString& text);
     void setContents(const QStringList& text);
     QStringList contents();
+    // the text of the last finished update, it doesn't lock the document once published
+    PDocumentSnapshot snapshot();
 
     void putLine(int index, const QString& s, bool notify=true);
 
@@ -138,9 +169,11 @@ protected:
     void putTextStr(const QString& text);
     void internalClear();
 private:
-    bool tryLoadFileByEncoding(QByteArray encodingName, QFile& file);
-    void loadUTF16BOMFile(QFile& file);
-    void loadUTF32BOMFile(QFile& file);
+    bool tryLoadFileByEncoding(QByteArray encodingName, const QByteArray& content,
+                               const QVector<ContentLineRange>& lines);
+    void loadUTF16BOMFile(const QByteArray& content);
+    void loadUTF32BOMFile(const QByteArray& content);
+    void loadUTF8Lines(const QByteArray& content, const QVector<ContentLineRange>& lines);
     void saveUTF16File(QFile& file, QTextCodec* codec);
     void saveUTF32File(QFile& file, QTextCodec* codec);
 
@@ -157,8 +190,18 @@ private:
     //int mCapacity;
     NewlineType mNewlineType;
     bool mAppendNewLineAtEOF;
-    int mIndexOfLongestLine;
+    // number of lines for each line width, lines whose width is not calculated are not counted
+    QMap<int,int> mColumnsCount;
+    bool mColumnsDirty; // some lines' width are not calculated
+    // columns+1 of each utf-16 code unit, 0 if not measured yet
+    mutable QVector<quint8> mCharColumnsCache;
+    bool mAsciiMonospace; // all ascii chars take one column
     int mUpdateCount;
+    int mVersion;
+    // chunks of the last published snapshot, nullptr if changed since then
+    QVector<std::shared_ptr<const QStringList>> mSnapshotChunks;
+    PDocumentSnapshot mSnapshot; // only accessed with std::atomic_load/atomic_store
+    QAtomicInt mSnapshotUsed;
 #if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
     QRecursiveMutex mMutex;
 #else
@@ -166,6 +209,11 @@ private:
 #endif
 
     int calculateLineColumns(int Index);
+    void uncountLineColumns(int columns);
+    void invalidateSnapshot(int fromIndex);
+    void invalidateSnapshotLine(int index);
+    void publishSnapshot();
+    void resetCharColumnsCache();
 };
 
 enum class ChangeReason {
@@ -345,6 +345,20 @@ void QSynEditPainter::paintToken(const QString &token, int tokenCols, int column
 
     if (last >= first && rcToken.right() > rcToken.left()) {
 //        qDebug()<<"Paint Token"<<Token<<ColumnsBefore<<TokenCols<<First<<Last;
+        bool ligature = edit->mOptions.testFlag(eoLigatureSupport);
+        // chars drawn together in one run, instead of one by one
+        auto inRun = [ligature,showGlyphs](QChar ch) {
+            if (ligature)
+                return ch.unicode()<=0xFF && !ch.isSpace();
+            return ch.unicode()<0x80 && ch!='\t' && !(showGlyphs && ch==' ');
+        };
+        bool useRuns = edit->mGlyphRunCache.fitsGrid(font, edit->mCharWidth);
+        QFont tokenFont = font;
+        if (useRuns && !ligature) {
+            // runs must look the same as the chars drawn one by one
+            tokenFont.setStyleStrategy(QFont::StyleStrategy(tokenFont.styleStrategy() | QFont::PreferNoShaping));
+            painter->setFont(tokenFont);
+        }
         nX = columnToXValue(first);
         first -= columnsBefore;
         last -= columnsBefore;
@@ -374,7 +388,23 @@ void QSynEditPainter::paintToken(const QString &token, int tokenCols, int column
                 //painter->drawText(nX,rcToken.bottom()-painter->fontMetrics().descent()*edit->dpiFactor() , Token[i]);
                 if (startPaint) {
                     bool  drawed = false;
-                    if (painter->fontInfo().fixedPitch()
+                    if (useRuns && inRun(token[i])) {
+                        int runEnd = i+1;
+                        while (runEnd<token.length() && inRun(token[runEnd])) {
+                            int cols = edit->charColumns(token[runEnd]);
+                            if (tokenColLen+charCols+cols > last)
+                                break;
+                            charCols += cols;
+                            runEnd++;
+                        }
+                        textToPaint = token.mid(i,runEnd-i);
+                        i = runEnd-1;
+                        // static text is positioned by its top, not by the baseline
+                        painter->drawStaticText(nX,rcToken.bottom()-painter->fontMetrics().descent()-painter->fontMetrics().ascent(),
+                                                edit->mGlyphRunCache.get(textToPaint, tokenFont));
+                        drawed = true;
+                    }
+                    if (!drawed && painter->fontInfo().fixedPitch()
                              && edit->mOptions.testFlag(eoLigatureSupport)
                              && !token[i].isSpace()
                              && (token[i].unicode()<=0xFF)) {
@@ -411,7 +441,7 @@ void QSynEditPainter::paintToken(const QString &token, int tokenCols, int column
                         } else {
                             painter->setFont(fontForNonAscii);
                             painter->drawText(nX,rcToken.bottom()-painter->fontMetrics().descent() , token[i]);
-                            painter->setFont(font);
+                            painter->setFont(tokenFont);
                         }
                         drawed = true;
                     }
@@ -421,11 +451,56 @@ void QSynEditPainter::paintToken(const QString &token, int tokenCols, int column
                 tokenColLen += charCols;
             }
         }
+        if (useRuns && !ligature)
+            painter->setFont(font);
 
         rcToken.setLeft(rcToken.right());
     }
 }
 
+const QStaticText &GlyphRunCache::get(const QString &text, const QFont &font)
+{
+    // the key doesn't have the style strategy, which tells whether the run is shaped
+    QPair<QString,QString> key(QString("%1/%2").arg(font.key()).arg(font.styleStrategy()),text);
+    auto it = mRuns.find(key);
+    if (it != mRuns.end())
+        return it.value();
+    // a rough bound, most visible runs of a screen are reused when scrolling
+    if (mRuns.count() >= 10000)
+        mRuns.clear();
+    QStaticText run(text);
+    run.setTextFormat(Qt::PlainText);
+    run.prepare(QTransform(), font);
+    return mRuns.insert(key,run).value();
+}
+
+bool GlyphRunCache::fitsGrid(const QFont &font, int charWidth)
+{
+    QString key = QString("%1/%2").arg(font.key()).arg(charWidth);
+    auto it = mFitsGrid.constFind(key);
+    if (it != mFitsGrid.constEnd())
+        return it.value();
+    bool result = QFontInfo(font).fixedPitch();
+    if (result) {
+        // the advance may be fractional, and wouldn't add up to the columns
+        QFontMetricsF fm(font);
+        foreach (QChar ch, QString("Mi ")) {
+            if (fm.horizontalAdvance(ch) != charWidth) {
+                result = false;
+                break;
+            }
+        }
+    }
+    mFitsGrid.insert(key,result);
+    return result;
+}
+
+void GlyphRunCache::clear()
+{
+    mRuns.clear();
+    mFitsGrid.clear();
+}
+
 void QSynEditPainter::paintEditAreas(const EditingAreaList &areaList)
 {
     QRect rc;
@@ -18,7 +18,9 @@
 #define PAINTER_H
 
 #include <QColor>
+#include <QHash>
 #include <QPainter>
+#include <QStaticText>
 #include <QString>
 #include "types.h"
 #include "syntaxer/syntaxer.h"
@@ -26,6 +28,22 @@
 
 namespace QSynedit {
 class QSynEdit;
+
+/*
+ * Laid out runs of ascii text, reused by the following repaints.
+ * Runs are only drawn as a whole in fonts whose chars all have the
+ * width of a column, so they keep to the column grid.
+ */
+class GlyphRunCache {
+public:
+    const QStaticText& get(const QString& text, const QFont& font);
+    bool fitsGrid(const QFont& font, int charWidth);
+    void clear();
+private:
+    QHash<QPair<QString,QString>,QStaticText> mRuns; // (font key/style strategy, text) -> run
+    QHash<QString,bool> mFitsGrid;
+};
+
 class QSynEditPainter
 {
     struct SynTokenAccu {
@@ -38,6 +38,7 @@
 #include <QDrag>
 #include <QMimeData>
 #include <QDesktopWidget>
+#include <QElapsedTimer>
 #include <QTextEdit>
 #include <QMimeData>
 
@@ -49,6 +50,8 @@ QSynEdit::QSynEdit(QWidget *parent) : QAbstractScrollArea(parent),
     mWheelAccumulatedDeltaY{0}
 {
     mCharWidth=1;
+    // set QSYNEDIT_PAINT_TIMING to log the time of each repaint, for scrolling benchmarks
+    mLogPaintTime = qEnvironmentVariableIsSet("QSYNEDIT_PAINT_TIMING");
     mTextHeight = 1;
     mLastKey = 0;
     mLastKeyModifiers = Qt::NoModifier;
@@ -3177,6 +3180,7 @@ void QSynEdit::recalcCharExtent()
         hasStyles[3] = font().underline();
     }
 
+    mGlyphRunCache.clear();
     mTextHeight  = 0;
     mCharWidth = 0;
     QFontMetrics fm(font());
@@ -3274,15 +3278,25 @@ void QSynEdit::updateModifiedStatus()
         emit statusChanged(StatusChange::scModifyChanged);
 }
 
-void QSynEdit::scanFrom(int index)
+/*
+ * Rescan syntax states from line index. The count lines starting from index
+ * are changed and always rescanned. After them the scan stops at the first line
+ * whose state is the same as before, because the lines below it can't change.
+ * Returns the index of the last rescanned line, and sets blocksChanged if any
+ * rescanned line starts/ends different blocks.
+ */
+int QSynEdit::scanFrom(int index, int count, bool &blocksChanged)
 {
+    blocksChanged = false;
     if (mEditingCount>0)
-        return;
+        return -1;
 
     SyntaxState state;
+    SyntaxState oldState;
     int idx = std::max(0,index);
     if (idx >= mDocument->count())
-        return;
+        return -1;
+    int lastChangedLine = idx + count - 1;
 
     if (idx == 0) {
         mSyntaxer->resetState();
@@ -3293,12 +3307,16 @@ void QSynEdit::scanFrom(int index)
         mSyntaxer->setLine(mDocument->getLine(idx), idx);
         mSyntaxer->nextToEol();
         state = mSyntaxer->getState();
+        oldState = mDocument->getSyntaxState(idx);
         mDocument->setSyntaxState(idx,state);
+        if (oldState.blockStarted != state.blockStarted
+                || oldState.blockEnded != state.blockEnded)
+            blocksChanged = true;
+        if (idx >= lastChangedLine && oldState == state)
+            break;
         idx ++ ;
     } while (idx < mDocument->count());
-    if (mUseCodeFolding)
-        rescanFolds();
-    return ;
+    return std::min(idx, mDocument->count()-1);
 }
 
 void QSynEdit::reparseLine(int line)
@@ -3380,8 +3398,12 @@ void QSynEdit::foldOnListInserted(int Line, int Count)
         if (range->fromLine == Line - 1) {// insertion starts at fold line
             if (range->collapsed)
                 uncollapse(range);
+            if (range->toLine >= Line) // the inserted lines are inside the fold
+                range->toLine += Count;
         } else if (range->fromLine >= Line) // insertion of count lines above FromLine
             range->move(Count);
+        else if (range->toLine >= Line) // insertion inside the fold
+            range->toLine += Count;
     }
 }
 
@@ -3422,33 +3444,23 @@ void QSynEdit::rescanFolds()
 
 void QSynEdit::rescanForFoldRanges()
 {
-    // Delete all uncollapsed folds
-//    for (int i=mAllFoldRanges.count()-1;i>=0;i--) {
-//        PSynEditFoldRange range =mAllFoldRanges[i];
-//        if (!range->collapsed && !range->parentCollapsed())
-//            mAllFoldRanges.remove(i);
-//    }
-
     // Did we leave any collapsed folds and are we viewing a code file?
     if (mAllFoldRanges->count() > 0) {
-        QMap<QString,PCodeFoldingRange> rangeIndexes;
+        QHash<int,PCodeFoldingRange> collapsedRanges;
         foreach(const PCodeFoldingRange& r, mAllFoldRanges->ranges()) {
             if (r->collapsed)
-                rangeIndexes.insert(QString("%1-%2").arg(r->fromLine).arg(r->toLine),r);
+                collapsedRanges.insert(r->fromLine,r);
         }
         mAllFoldRanges->clear();
         // Add folds to a separate list
         PCodeFoldingRanges temporaryAllFoldRanges = std::make_shared<CodeFoldingRanges>();
         scanForFoldRanges(temporaryAllFoldRanges);
 
-        PCodeFoldingRange tempFoldRange;
-        PCodeFoldingRange r2;
         // Combine new with old folds, preserve parent order
         for (int i = 0; i< temporaryAllFoldRanges->count();i++) {
-            tempFoldRange=temporaryAllFoldRanges->range(i);
-            r2=rangeIndexes.value(QString("%1-%2").arg(tempFoldRange->fromLine).arg(tempFoldRange->toLine),
-                                  PCodeFoldingRange());
-            if (r2) {
+            PCodeFoldingRange tempFoldRange=temporaryAllFoldRanges->range(i);
+            PCodeFoldingRange r2=collapsedRanges.value(tempFoldRange->fromLine);
+            if (r2 && r2->toLine == tempFoldRange->toLine) {
                 tempFoldRange->collapsed=true;
                 tempFoldRange->linesCollapsed=r2->linesCollapsed;
             }
@@ -3461,6 +3473,139 @@ void QSynEdit::rescanForFoldRanges()
     }
 }
 
+/*
+ * Rebuild only the folds starting in lines first..last (0-based) from the
+ * block starts/ends saved in the syntax states, and leave the other folds alone.
+ * The range is first widened to the whole folds that begin or end in it, so
+ * the blocks inside it must balance; if they don't, the edit changed the
+ * nesting of the rest of the document and all folds are rescanned.
+ * Folds starting at the same line are reused, so their collapsed state survives.
+ */
+void QSynEdit::rescanFolds(int first, int last)
+{
+    if (!mUseCodeFolding || !mSyntaxer)
+        return;
+    first = std::max(0, first);
+    last = std::min(last, mDocument->count()-1);
+    if (first>last)
+        return;
+
+    // widen to the folds crossing the borders of the range
+    bool widened = true;
+    while (widened) {
+        widened = false;
+        foreach (const PCodeFoldingRange& range, mAllFoldRanges->ranges()) {
+            int startLine = range->fromLine - 1;
+            if (startLine > last)
+                break; // sorted by line
+            if (startLine >= first) {
+                if (range->toLine > last) {
+                    last = std::min(range->toLine, mDocument->count()-1);
+                    widened = true;
+                }
+            } else if (range->toLine >= first && range->toLine - 1 <= last) {
+                first = startLine;
+                widened = true;
+            }
+        }
+    }
+
+    // match the blocks in the range, without touching the current folds yet
+    struct NewFold {
+        int fromLine;
+        int toLine;
+        int parent; // index in newFolds, -1 if directly under the enclosing fold
+    };
+    QVector<NewFold> newFolds;
+    QVector<int> openFolds;
+    for (int line=first; line<=last; line++) {
+        int blockEnded=mDocument->blockEnded(line);
+        int blockStarted=mDocument->blockStarted(line);
+        for (int i=0; i<blockEnded;i++) {
+            if (openFolds.isEmpty()) {
+                // closes a fold outside of the range
+                rescanFolds();
+                return;
+            }
+            newFolds[openFolds.back()].toLine = (blockStarted>0)?line:line+1;
+            openFolds.pop_back();
+        }
+        for (int i=0; i<blockStarted;i++) {
+            newFolds.append(NewFold{line+1, line+1, openFolds.isEmpty()?-1:openFolds.back()});
+            openFolds.append(newFolds.count()-1);
+        }
+    }
+    if (!openFolds.isEmpty()) {
+        rescanFolds();
+        return;
+    }
+
+    // the innermost fold enclosing the range
+    PCodeFoldingRange enclosingFold;
+    foreach (const PCodeFoldingRange& range, mAllFoldRanges->ranges()) {
+        if (range->fromLine - 1 >= first)
+            break;
+        if (range->toLine - 1 > last)
+            enclosingFold = range;
+    }
+
+    // take out the old folds in the range
+    QHash<int,PCodeFoldingRange> oldFolds;
+    int insertPos = mAllFoldRanges->count();
+    for (int i=mAllFoldRanges->count()-1;i>=0;i--) {
+        PCodeFoldingRange range = (*mAllFoldRanges)[i];
+        int startLine = range->fromLine - 1;
+        if (startLine > last)
+            insertPos = i;
+        else if (startLine >= first) {
+            oldFolds.insert(range->fromLine, range);
+            mAllFoldRanges->remove(i);
+            insertPos = i;
+        } else
+            break;
+    }
+    PCodeFoldingRanges enclosingList;
+    int enclosingPos = 0;
+    if (enclosingFold) {
+        enclosingList = enclosingFold->subFoldRanges;
+        for (int i=enclosingList->count()-1;i>=0;i--) {
+            int startLine = (*enclosingList)[i]->fromLine - 1;
+            if (startLine < first) {
+                enclosingPos = i + 1;
+                break;
+            }
+            if (startLine <= last)
+                enclosingList->remove(i);
+        }
+    }
+
+    // put in the new ones
+    QVector<PCodeFoldingRange> folds;
+    folds.reserve(newFolds.count());
+    foreach (const NewFold& newFold, newFolds) {
+        PCodeFoldingRange parent = (newFold.parent>=0)?folds[newFold.parent]:enclosingFold;
+        PCodeFoldingRange range = oldFolds.value(newFold.fromLine);
+        if (range) {
+            if (range->toLine != newFold.toLine) {
+                range->toLine = newFold.toLine;
+                if (range->collapsed)
+                    uncollapse(range);
+            }
+            range->parent = parent;
+            range->subFoldRanges->clear();
+        } else {
+            range = std::make_shared<CodeFoldingRange>(parent, newFold.fromLine, newFold.toLine);
+        }
+        folds.append(range);
+        mAllFoldRanges->insert(insertPos++, range);
+        if (newFold.parent>=0)
+            parent->subFoldRanges->add(range);
+        else if (enclosingList)
+            enclosingList->insert(enclosingPos++, range);
+    }
+    invalidateGutter();
+}
+
 void QSynEdit::scanForFoldRanges(PCodeFoldingRanges topFoldRanges)
 {
     PCodeFoldingRanges parentFoldRanges = topFoldRanges;
@@ -4073,7 +4218,10 @@ void QSynEdit::setOptions(const EditorOptions &Value)
                 || !sameEditorOption(Value,mOptions,eoShowInnerSpaces)
                 || !sameEditorOption(Value,mOptions,eoShowTrailingSpaces)
                 || !sameEditorOption(Value,mOptions,eoShowLineBreaks)
-                || !sameEditorOption(Value,mOptions,eoShowRainbowColor);
+                || !sameEditorOption(Value,mOptions,eoShowRainbowColor)
+                || !sameEditorOption(Value,mOptions,eoLigatureSupport);
+        if (!sameEditorOption(Value,mOptions,eoLigatureSupport))
+            mGlyphRunCache.clear();
         //bool bUpdateScroll = (Options * ScrollOptions)<>(Value * ScrollOptions);
         bool bUpdateScroll = true;
         mOptions = Value;
@@ -6022,6 +6170,9 @@ void QSynEdit::paintEvent(QPaintEvent *event)
     //Get the invalidated rect.
     QRect rcClip = event->rect();
     QRect rcCaret = calculateCaretRect();
+    QElapsedTimer paintTimer;
+    if (mLogPaintTime)
+        paintTimer.start();
 
     if (rcCaret == rcClip) {
         // only update caret
@@ -6078,6 +6229,10 @@ void QSynEdit::paintEvent(QPaintEvent *event)
         cacheRC.setWidth(rcClip.width()*dpr);
         cacheRC.setHeight(rcClip.height()*dpr);
         painter.drawImage(rcClip,*mContentImage,cacheRC);
+        if (mLogPaintTime)
+            qDebug()<<QString("paint lines %1-%2: %3 ms")
+                      .arg(nL1).arg(nL2)
+                      .arg(paintTimer.nsecsElapsed()/1000000.0,0,'f',2);
     }
     paintCaret(painter, rcCaret);
 }
@@ -6674,7 +6829,10 @@ void QSynEdit::onLinesDeleted(int index, int count)
     if (mUseCodeFolding)
         foldOnListDeleted(index + 1, count);
     if (mSyntaxer && mDocument->count() > 0) {
-        scanFrom(index);
+        bool blocksChanged;
+        // folds containing the deleted lines must be shortened
+        if (scanFrom(index, 1, blocksChanged)>=0)
+            rescanFolds();
     }
     invalidateLines(index + 1, INT_MAX);
     invalidateGutterLines(index + 1, INT_MAX);
@@ -6685,16 +6843,22 @@ void QSynEdit::onLinesInserted(int index, int count)
     if (mUseCodeFolding)
         foldOnListInserted(index + 1, count);
     if (mSyntaxer && mDocument->count() > 0) {
-          scanFrom(index);
+        bool blocksChanged;
+        int lastLine = scanFrom(index, count, blocksChanged);
+        if (lastLine>=0)
+            rescanFolds(index, lastLine);
     }
     invalidateLines(index + 1, INT_MAX);
     invalidateGutterLines(index + 1, INT_MAX);
 }
 
-void QSynEdit::onLinesPutted(int index, int /*count*/)
+void QSynEdit::onLinesPutted(int index, int count)
 {
     if (mSyntaxer) {
-        scanFrom(index);
+        bool blocksChanged;
+        int lastLine = scanFrom(index, count, blocksChanged);
+        if (blocksChanged)
+            rescanFolds(index, lastLine);
     }
     invalidateLines(index + 1, INT_MAX);
 }
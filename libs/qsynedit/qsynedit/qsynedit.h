@@ -28,6 +28,7 @@
 #include "codefolding.h"
 #include "types.h"
 #include "document.h"
+#include "painter.h"
 #include "keystrokes.h"
 #include "searcher/baseseacher.h"
 #include "formatter/formatter.h"
@@ -508,7 +509,7 @@ private:
     void recalcCharExtent();
     QString expandAtWideGlyphs(const QString& S);
     void updateModifiedStatus();
-    void scanFrom(int index);
+    int scanFrom(int index, int count, bool &blocksChanged);
     void reparseLine(int line);
     void reparseDocument();
     void uncollapse(PCodeFoldingRange FoldRange);
@@ -518,6 +519,7 @@ private:
     void foldOnListDeleted(int Line, int Count);
     void foldOnListCleared();
     void rescanFolds(); // rescan for folds
+    void rescanFolds(int first, int last);
     void rescanForFoldRanges();
     void scanForFoldRanges(PCodeFoldingRanges topFoldRanges);
     int lineHasChar(int Line, int startChar, QChar character, const QString& tokenAttrName);
@@ -656,6 +658,8 @@ private:
     int mCaretY;
     int mCharsInWindow;
     int mCharWidth;
+    GlyphRunCache mGlyphRunCache;
+    bool mLogPaintTime;
     QFont mFontDummy;
     QFont mFontForNonAscii;
     bool mMouseMoved;
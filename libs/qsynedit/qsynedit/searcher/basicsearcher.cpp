@@ -18,7 +18,13 @@
 
 namespace QSynedit {
 
-BasicSearcher::BasicSearcher(QObject *parent):BaseSearcher(parent)
+// patterns up to this length are matched by testing their first and last chars
+// first, longer ones by Boyer-Moore-Horspool
+#define SHORT_PATTERN_LENGTH 8
+
+BasicSearcher::BasicSearcher(QObject *parent):BaseSearcher(parent),
+    mMatchCase(false),
+    mUseQtIndexOf(false)
 {
 
 }
@@ -45,21 +51,18 @@ int BasicSearcher::resultCount()
 int BasicSearcher::findAll(const QString &text)
 {
     mResults.clear();
-    if (pattern().isEmpty())
+    if (mSearchPattern.isEmpty())
         return 0;
+    bool wholeWord = options().testFlag(ssoWholeWord);
     int start=0;
     int next=-1;
     while (true) {
-        if (options().testFlag(ssoMatchCase)) {
-            next = text.indexOf(pattern(),start,Qt::CaseSensitive);
-        } else {
-            next = text.indexOf(pattern(),start,Qt::CaseInsensitive);
-        }
+        next = indexOf(text, start);
         if (next<0) {
             break;
         }
-        start = next + pattern().length();
-        if (options().testFlag(ssoWholeWord)) {
+        start = next + mSearchPattern.length();
+        if (wholeWord) {
             if (((next<=0) || isDelimitChar(text[next-1]))
                     &&
                     ( (start>=text.length()) || isDelimitChar(text[start]) )
@@ -79,4 +82,102 @@ QString BasicSearcher::replace(const QString &, const QString &aReplacement)
     return aReplacement;
 }
 
+void BasicSearcher::setPattern(const QString &value)
+{
+    BaseSearcher::setPattern(value);
+    prepare();
+}
+
+void BasicSearcher::setOptions(const SearchOptions &options)
+{
+    BaseSearcher::setOptions(options);
+    prepare();
+}
+
+void BasicSearcher::prepare()
+{
+    QString s = pattern();
+    mMatchCase = options().testFlag(ssoMatchCase);
+    mSearchPattern.resize(s.length());
+    mUseQtIndexOf = false;
+    for (int i=0;i<s.length();i++) {
+        // QString::indexOf folds surrogate pairs as a whole, leave them to it
+        if (s[i].isSurrogate())
+            mUseQtIndexOf = true;
+        mSearchPattern[i] = mMatchCase ? s[i].unicode() : QChar::toCaseFolded(s[i].unicode());
+    }
+    int m = mSearchPattern.length();
+    if (m > SHORT_PATTERN_LENGTH) {
+        // chars sharing a low byte share the smallest shift, so it's always safe
+        mShifts.fill(m, 256);
+        for (int i=0;i<m-1;i++)
+            mShifts[mSearchPattern[i] & 0xFF] = m-1-i;
+    } else {
+        mShifts.clear();
+    }
+}
+
+bool BasicSearcher::matchAt(const ushort *s, int pos) const
+{
+    const ushort* p = mSearchPattern.constData();
+    int m = mSearchPattern.length();
+    if (mMatchCase) {
+        for (int i=1;i<m-1;i++) {
+            if (s[pos+i]!=p[i])
+                return false;
+        }
+    } else {
+        for (int i=1;i<m-1;i++) {
+            if (QChar::toCaseFolded(s[pos+i])!=p[i])
+                return false;
+        }
+    }
+    return true;
+}
+
+int BasicSearcher::indexOf(const QString &text, int from) const
+{
+    if (mUseQtIndexOf)
+        return text.indexOf(pattern(), from, mMatchCase?Qt::CaseSensitive:Qt::CaseInsensitive);
+    const ushort* s = text.utf16();
+    const ushort* p = mSearchPattern.constData();
+    int n = text.length();
+    int m = mSearchPattern.length();
+    if (from<0 || m > n - from)
+        return -1;
+    int last = n - m;
+    ushort firstChar = p[0];
+    ushort lastChar = p[m-1];
+    if (m <= SHORT_PATTERN_LENGTH) {
+        // a plain loop on the first and last chars, which the compiler can vectorize
+        if (mMatchCase) {
+            for (int i=from;i<=last;i++) {
+                if (s[i]==firstChar && s[i+m-1]==lastChar && matchAt(s,i))
+                    return i;
+            }
+        } else {
+            for (int i=from;i<=last;i++) {
+                if (QChar::toCaseFolded(s[i])==firstChar
+                        && QChar::toCaseFolded(s[i+m-1])==lastChar
+                        && matchAt(s,i))
+                    return i;
+            }
+        }
+        return -1;
+    }
+    int i = from;
+    while (i<=last) {
+        ushort ch = s[i+m-1];
+        if (!mMatchCase)
+            ch = QChar::toCaseFolded(ch);
+        if (ch == lastChar) {
+            ushort ch0 = mMatchCase ? s[i] : QChar::toCaseFolded(s[i]);
+            if (ch0 == firstChar && matchAt(s,i))
+                return i;
+        }
+        i += mShifts[ch & 0xFF];
+    }
+    return -1;
+}
+
 }
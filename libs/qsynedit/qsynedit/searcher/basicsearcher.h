@@ -17,6 +17,7 @@
 #ifndef SYNSEARCH_H
 #define SYNSEARCH_H
 #include "baseseacher.h"
+#include <QVector>
 
 namespace  QSynedit {
 
@@ -33,8 +34,18 @@ public:
     int resultCount() override;
     int findAll(const QString &text) override;
     QString replace(const QString &aOccurrence, const QString &aReplacement) override;
+    void setPattern(const QString &value) override;
+    void setOptions(const SearchOptions &options) override;
+private:
+    void prepare();
+    int indexOf(const QString& text, int from) const;
+    bool matchAt(const ushort* s, int pos) const;
 private:
     QList<int> mResults;
+    QVector<ushort> mSearchPattern; // case folded if not matching case
+    QVector<int> mShifts; // Horspool shifts, indexed by the low byte of a char
+    bool mMatchCase;
+    bool mUseQtIndexOf;
 };
 }
 